@@ -67,6 +67,7 @@ buildfile 'src/zlib/zlib.forge';
 cc:all {
     'src/lalr/all',
     'src/reyes/all',
+    'src/reyes/reyes_benchmarks/all',
     'src/reyes/reyes_examples/all',
     'src/reyes/reyes_test/all'
 };
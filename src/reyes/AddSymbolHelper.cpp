@@ -204,13 +204,13 @@ AddSymbolHelper& AddSymbolHelper::add_default_symbols()
             ( TYPE_POINT )
         ( "Du", &du_vec3, TYPE_VECTOR, STORAGE_VARYING )
             ( TYPE_VECTOR )
-        ( "Dv", &du_float, TYPE_FLOAT, STORAGE_VARYING )
+        ( "Dv", &dv_float, TYPE_FLOAT, STORAGE_VARYING )
             ( TYPE_FLOAT )
-        ( "Dv", &du_vec3, TYPE_COLOR, STORAGE_VARYING )
+        ( "Dv", &dv_vec3, TYPE_COLOR, STORAGE_VARYING )
             ( TYPE_COLOR )
-        ( "Dv", &du_vec3, TYPE_VECTOR, STORAGE_VARYING )
+        ( "Dv", &dv_vec3, TYPE_VECTOR, STORAGE_VARYING )
             ( TYPE_POINT )
-        ( "Dv", &du_vec3, TYPE_VECTOR, STORAGE_VARYING )
+        ( "Dv", &dv_vec3, TYPE_VECTOR, STORAGE_VARYING )
             ( TYPE_VECTOR )
         ( "Deriv", &deriv_float, TYPE_FLOAT, STORAGE_VARYING )
             ( TYPE_FLOAT )( TYPE_FLOAT )
@@ -41,7 +41,10 @@ Attributes::Attributes( VirtualMachine* virtual_machine )
 , light_shaders_()
 , active_light_shaders_()
 , transforms_()
+, motion_transforms_()
+, moving_()
 , named_transforms_()
+, revision_( 0 )
 {
     REYES_ASSERT( virtual_machine_ );
     displacement_grid_ = new Grid();
@@ -53,6 +56,10 @@ Attributes::Attributes( VirtualMachine* virtual_machine )
     const unsigned int TRANSFORMS_RESERVE = 32;
     transforms_.reserve( TRANSFORMS_RESERVE );
     transforms_.push_back( math::identity() );
+    motion_transforms_.reserve( TRANSFORMS_RESERVE );
+    motion_transforms_.push_back( math::identity() );
+    moving_.reserve( TRANSFORMS_RESERVE );
+    moving_.push_back( false );
 }
 
 Attributes::Attributes( const Attributes& attributes )
@@ -73,7 +80,10 @@ Attributes::Attributes( const Attributes& attributes )
 , light_shaders_( attributes.light_shaders_ )
 , active_light_shaders_( attributes.active_light_shaders_ )
 , transforms_( attributes.transforms_ )
+, motion_transforms_( attributes.motion_transforms_ )
+, moving_( attributes.moving_ )
 , named_transforms_( attributes.named_transforms_ )
+, revision_( attributes.revision_ )
 {
     REYES_ASSERT( virtual_machine_ );
     displacement_grid_ = new Grid( *attributes.displacement_grid_ );
@@ -89,6 +99,21 @@ Attributes::~Attributes()
     displacement_grid_ = nullptr;
 }
 
+int Attributes::revision() const
+{
+    int revision = revision_ + displacement_grid_->revision() + surface_grid_->revision();
+    for ( vector<pair<Shader*, shared_ptr<Grid>>>::const_iterator i = light_shaders_.begin(); i != light_shaders_.end(); ++i )
+    {
+        revision += i->second->revision();
+    }
+    return revision;
+}
+
+VirtualMachine* Attributes::virtual_machine() const
+{
+    return virtual_machine_;
+}
+
 float Attributes::shading_rate() const
 {
     return shading_rate_;
@@ -134,51 +159,66 @@ const math::vec4* Attributes::v_basis() const
     return v_basis_;
 }
 
+void Attributes::set_virtual_machine( VirtualMachine* virtual_machine )
+{
+    REYES_ASSERT( virtual_machine );
+    virtual_machine_ = virtual_machine;
+}
+
 void Attributes::set_shading_rate( float shading_rate )
 {
     REYES_ASSERT( shading_rate > 0.0f );
+    ++revision_;
     shading_rate_ = shading_rate > 0.0f ? shading_rate : 1.0f;
 }
 
 void Attributes::set_matte( bool matte )
 {
+    ++revision_;
     matte_ = matte;
 }
 
 void Attributes::set_two_sided( bool two_sided )
 {
+    ++revision_;
     two_sided_ = two_sided;
 }
 
 void Attributes::set_transform_left_handed( bool transform_left_handed )
 {
+    ++revision_;
     transform_left_handed_ = transform_left_handed;
 }
 
 void Attributes::set_geometry_left_handed( bool geometry_left_handed )
 {
+    ++revision_;
     geometry_left_handed_ = geometry_left_handed;
 }
 
 void Attributes::set_color( const math::vec3& color )
 {
+    ++revision_;
     color_ = color;
 }
 
 void Attributes::set_opacity( const math::vec3& opacity )
 {
+    ++revision_;
     opacity_ = opacity;
 }
 
 void Attributes::set_u_basis( const math::vec4* u_basis )
 {
     REYES_ASSERT( u_basis );
+    ++revision_;
     u_basis_ = u_basis;
 }
 
 void Attributes::set_v_basis( const math::vec4* v_basis )
 {
     REYES_ASSERT( v_basis );
+    ++revision_;
     v_basis_ = v_basis;
 }
 
@@ -208,6 +248,7 @@ void Attributes::displacement_shade( Grid& grid )
 
 void Attributes::set_displacement_shader( Shader* displacement_shader, const math::mat4x4& camera_transform )
 {
+    ++revision_;
     displacement_grid_->clear();
     displacement_shader_ = displacement_shader;
     if ( displacement_shader_ )
@@ -273,6 +314,7 @@ void Attributes::surface_shade( Grid& grid )
 
 void Attributes::set_surface_shader( Shader* surface_shader, const math::mat4x4& camera_transform )
 {
+    ++revision_;
     surface_grid_->clear();
     surface_shader_ = surface_shader;
     if ( surface_shader_ )
@@ -332,9 +374,31 @@ void Attributes::light_shade( Grid& grid )
     }
 }
 
+void Attributes::detach_light_shaders()
+{
+    for ( vector<pair<Shader*, shared_ptr<Grid>>>::iterator i = light_shaders_.begin(); i != light_shaders_.end(); ++i )
+    {
+        shared_ptr<Grid> light_parameters( new Grid(*i->second) );
+        vector<Grid*>::iterator active_light_shader = find_active_light_shader_by_grid( *i->second );
+        if ( active_light_shader != active_light_shaders_.end() )
+        {
+            *active_light_shader = light_parameters.get();
+        }
+        i->second = light_parameters;
+    }
+}
+
+void Attributes::copy_light_shaders( const Attributes& attributes )
+{
+    ++revision_;
+    light_shaders_ = attributes.light_shaders_;
+    active_light_shaders_ = attributes.active_light_shaders_;
+}
+
 Grid& Attributes::add_light_shader( Shader* light_shader, const math::mat4x4& camera_transform )
 {
     REYES_ASSERT( light_shader );
+    ++revision_;
     
     shared_ptr<Grid> light_parameters( new Grid(light_shader) );
     light_shaders_.push_back( make_pair(light_shader, light_parameters) );
@@ -352,6 +416,7 @@ Grid& Attributes::add_light_shader( Shader* light_shader, const math::mat4x4& ca
 
 void Attributes::activate_light_shader( Grid& grid )
 {
+    ++revision_;
     vector<Grid*>::iterator i = find_active_light_shader_by_grid( grid );
     if ( i == active_light_shaders_.end() )
     {  
@@ -362,6 +427,7 @@ void Attributes::activate_light_shader( Grid& grid )
 
 void Attributes::deactivate_light_shader( Grid& grid )
 {
+    ++revision_;
     vector<Grid*>::iterator i = find_active_light_shader_by_grid( grid );
     if ( i != active_light_shaders_.end() )
     {
@@ -385,6 +451,8 @@ std::vector<Grid*>::iterator Attributes::find_active_light_shader_by_grid( const
 void Attributes::push_transform()
 {
     transforms_.push_back( transforms_.back() );
+    motion_transforms_.push_back( motion_transforms_.back() );
+    moving_.push_back( moving_.back() );
 }
 
 void Attributes::pop_transform()
@@ -393,33 +461,34 @@ void Attributes::pop_transform()
     if ( transforms_.size() > 1 )
     {
         transforms_.pop_back();
+        motion_transforms_.pop_back();
+        moving_.pop_back();
     }
 }
 
 void Attributes::identity()
 {
     transforms_.back() = math::identity();
+    motion_transforms_.back() = math::identity();
+    moving_.back() = false;
 }
 
 void Attributes::transform( const math::mat4x4& transform )
 {
-    transforms_.back() = transform;
-
-    if ( determinant(transform) < 0.0f )
-    {
-        transform_left_handed_ = !transform_left_handed_;
-        geometry_left_handed_ = !geometry_left_handed_;
-    }
+    set_transform( transform );
+    motion_transforms_.back() = transform;
+    moving_.back() = false;
 }
 
 void Attributes::concat_transform( const math::mat4x4& transform )
 {
-    Attributes::transform( transforms_.back() * transform );
+    set_transform( transforms_.back() * transform );
+    motion_transforms_.back() = motion_transforms_.back() * transform;
 }
 
 void Attributes::perspective( float fov, float aspect_ratio, float near_clip_distance, float far_clip_distance )
 {
-    Attributes::transform( transforms_.back() * renderman_perspective(fov, aspect_ratio, near_clip_distance, far_clip_distance) );
+    concat_transform( renderman_perspective(fov, aspect_ratio, near_clip_distance, far_clip_distance) );
 }
 
 const math::mat4x4& Attributes::transform() const
@@ -428,10 +497,42 @@ const math::mat4x4& Attributes::transform() const
     return transforms_.back();
 }
 
+bool Attributes::moving() const
+{
+    REYES_ASSERT( !moving_.empty() );
+    return moving_.back();
+}
+
+void Attributes::set_motion_transform( const math::mat4x4& transform )
+{
+    REYES_ASSERT( !motion_transforms_.empty() );
+    motion_transforms_.back() = transform;
+    moving_.back() = true;
+}
+
+const math::mat4x4& Attributes::motion_transform() const
+{
+    REYES_ASSERT( !motion_transforms_.empty() );
+    return motion_transforms_.back();
+}
+
+void Attributes::set_transform( const math::mat4x4& transform )
+{
+    transforms_.back() = transform;
+
+    if ( determinant(transform) < 0.0f )
+    {
+        ++revision_;
+        transform_left_handed_ = !transform_left_handed_;
+        geometry_left_handed_ = !geometry_left_handed_;
+    }
+}
+
 void Attributes::add_coordinate_system( const char* name, const math::mat4x4& transform )
 {
     REYES_ASSERT( name );
     REYES_ASSERT( !transforms_.empty() );
+    ++revision_;
     named_transforms_[name] = transform;
 }
 
@@ -439,6 +540,7 @@ void Attributes::remove_coordinate_system( const char* name )
 {
     REYES_ASSERT( name );
     REYES_ASSERT( named_transforms_.find(name) != named_transforms_.end() );
+    ++revision_;
     named_transforms_.erase( name );
 }
 
@@ -448,3 +550,22 @@ math::mat4x4 Attributes::transform_from( const std::string& name ) const
     map<string, math::mat4x4>::const_iterator i = named_transforms_.find( name );
     return i != named_transforms_.end() ? i->second : math::identity();    
 }
+
+void Attributes::copy_coordinate_systems( const Attributes& attributes )
+{
+    for ( map<string, math::mat4x4>::const_iterator i = attributes.named_transforms_.begin(); i != attributes.named_transforms_.end(); ++i )
+    {
+        named_transforms_[i->first] = i->second;
+    }
+}
+
+void Attributes::transform_spaces( const math::mat4x4& transform )
+{
+    ++revision_;
+    displacement_grid_->set_transform( transform * displacement_grid_->get_transform() );
+    surface_grid_->set_transform( transform * surface_grid_->get_transform() );
+    for ( map<string, math::mat4x4>::iterator i = named_transforms_.begin(); i != named_transforms_.end(); ++i )
+    {
+        i->second = transform * i->second;
+    }
+}
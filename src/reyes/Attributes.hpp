@@ -38,13 +38,18 @@ class Attributes
     std::vector<std::pair<Shader*, std::shared_ptr<Grid> > > light_shaders_; ///< The currently allocated light shaders.
     std::vector<Grid*> active_light_shaders_; ///< The currently active light shaders.
     std::vector<math::mat4x4> transforms_; ///< The transform stack.
+    std::vector<math::mat4x4> motion_transforms_; ///< The transform stack at shutter close (the same as the transform stack for transforms that don't move).
+    std::vector<bool> moving_; ///< True for each transform on the transform stack that moves while the shutter is open.
     std::map<std::string, math::mat4x4> named_transforms_; ///< Transform from camera space to the named space.
+    int revision_; ///< Incremented each time these attributes are changed.
     
 public:
     Attributes( VirtualMachine* virtual_machine );
     Attributes( const Attributes& attributes );
     ~Attributes();
 
+    int revision() const;
+    VirtualMachine* virtual_machine() const;
     float shading_rate() const;
     bool matte() const;
     bool two_sided() const;
@@ -57,6 +62,7 @@ public:
     const std::vector<math::mat4x4>& transforms() const;
     const std::map<std::string, math::mat4x4>& named_transforms() const;
 
+    void set_virtual_machine( VirtualMachine* virtual_machine );
     void set_shading_rate( float shading_rate );
     void set_matte( bool matte );
     void set_transform_left_handed( bool transform_left_handed );
@@ -78,6 +84,8 @@ public:
     Grid& surface_parameters() const;
 
     void light_shade( Grid& grid );
+    void detach_light_shaders();
+    void copy_light_shaders( const Attributes& attributes );
     Grid& add_light_shader( Shader* light_shader, const math::mat4x4& camera_transform );
     void activate_light_shader( Grid& grid );
     void deactivate_light_shader( Grid& grid );
@@ -90,10 +98,18 @@ public:
     void concat_transform( const math::mat4x4& transform );
     void perspective( float fov, float aspect_ratio, float near_clip_distance, float far_clip_distance );
     const math::mat4x4& transform() const;
+    bool moving() const;
+    void set_motion_transform( const math::mat4x4& transform );
+    const math::mat4x4& motion_transform() const;
 
     void add_coordinate_system( const char* name, const math::mat4x4& transform );
     void remove_coordinate_system( const char* name );
     math::mat4x4 transform_from( const std::string& name ) const;
+    void copy_coordinate_systems( const Attributes& attributes );
+    void transform_spaces( const math::mat4x4& transform );
+
+private:
+    void set_transform( const math::mat4x4& transform );
 };
 
 }
@@ -0,0 +1,197 @@
+//
+// BlueNoise.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "BlueNoise.hpp"
+#include "hash.hpp"
+#include "assert.hpp"
+#include <algorithm>
+#include <math.h>
+
+using std::vector;
+using namespace reyes;
+
+static const int TILE_SIZE = BlueNoise::TILE_SIZE;
+static const int PADDING = BlueNoise::PADDING;
+static const int ELEMENTS = 4;
+static const int INITIAL_DENSITY = 10;
+static const float SIGMA = 1.5f;
+
+// Offsets of the pattern read by each element of a pixel.
+static const int ELEMENT_OFFSETS [ELEMENTS][2] = 
+{
+    { 0, 0 },
+    { 32, 16 },
+    { 16, 48 },
+    { 48, 32 }
+};
+
+/**
+// Constructor.
+*/
+BlueNoise::BlueNoise()
+: values_()
+{
+    vector<int> ranks;
+    generate( &ranks );
+
+    const int texels = TILE_SIZE * TILE_SIZE;
+    const int stride = (TILE_SIZE + PADDING) * ELEMENTS;
+    values_.resize( TILE_SIZE * stride );
+    for ( int y = 0; y < TILE_SIZE; ++y )
+    {
+        for ( int x = 0; x < TILE_SIZE + PADDING; ++x )
+        {
+            for ( int element = 0; element < ELEMENTS; ++element )
+            {
+                const int xx = (x + ELEMENT_OFFSETS[element][0]) % TILE_SIZE;
+                const int yy = (y + ELEMENT_OFFSETS[element][1]) % TILE_SIZE;
+                const int rank = ranks[yy * TILE_SIZE + xx];
+                values_[y * stride + x * ELEMENTS + element] = 2.0f * (float(rank) + 0.5f) / float(texels) - 1.0f;
+            }
+        }
+    }
+}
+
+/**
+// Get the dither for the elements of a pixel.
+//
+// @param x, y
+//  The position of the pixel (any non-negative value, the pattern tiles).
+//
+// @return
+//  The dither for each element of the pixel followed by the dither for
+//  each element of the next PADDING - 1 pixels across.
+*/
+const float* BlueNoise::values( int x, int y ) const
+{
+    REYES_ASSERT( x >= 0 && y >= 0 );
+    const int stride = (TILE_SIZE + PADDING) * ELEMENTS;
+    return &values_[(y % TILE_SIZE) * stride + (x % TILE_SIZE) * ELEMENTS];
+}
+
+/**
+// Get the blue noise pattern shared by everything that dithers.
+//
+// The pattern is generated the first time that it is needed.
+*/
+const BlueNoise& BlueNoise::pattern()
+{
+    static const BlueNoise blue_noise;
+    return blue_noise;
+}
+
+/**
+// Rank every texel in the tile with the void-and-cluster method.
+//
+// An initial pattern of one in every INITIAL_DENSITY texels is relaxed by 
+// repeatedly moving its most tightly clustered texel into its largest void.
+// The texels in that pattern are then ranked by removing the tightest 
+// cluster and the remaining texels by filling the largest void.  Clusters 
+// and voids are found from the sum of a Gaussian of the distance, wrapping
+// around the tile, to every texel in the pattern.
+*/
+void BlueNoise::generate( vector<int>* ranks )
+{
+    REYES_ASSERT( ranks );
+
+    const int texels = TILE_SIZE * TILE_SIZE;
+    vector<float> kernel( texels );
+    for ( int y = 0; y < TILE_SIZE; ++y )
+    {
+        const int dy = std::min( y, TILE_SIZE - y );
+        for ( int x = 0; x < TILE_SIZE; ++x )
+        {
+            const int dx = std::min( x, TILE_SIZE - x );
+            kernel[y * TILE_SIZE + x] = expf( -float(dx * dx + dy * dy) / (2.0f * SIGMA * SIGMA) );
+        }
+    }
+
+    vector<unsigned char> pattern( texels, 0 );
+    vector<float> energies( texels, 0.0f );
+    auto toggle = [&]( int texel, bool set )
+    {
+        pattern[texel] = set ? 1 : 0;
+        const float sign = set ? 1.0f : -1.0f;
+        const int tx = texel % TILE_SIZE;
+        const int ty = texel / TILE_SIZE;
+        for ( int y = 0; y < TILE_SIZE; ++y )
+        {
+            const float* row = &kernel[((y - ty) & (TILE_SIZE - 1)) * TILE_SIZE];
+            float* energy = &energies[y * TILE_SIZE];
+            for ( int x = 0; x < TILE_SIZE; ++x )
+            {
+                energy[x] += sign * row[(x - tx) & (TILE_SIZE - 1)];
+            }
+        }
+    };
+
+    auto tightest_cluster = [&]()
+    {
+        int texel = -1;
+        for ( int i = 0; i < texels; ++i )
+        {
+            if ( pattern[i] && (texel < 0 || energies[i] > energies[texel]) )
+            {
+                texel = i;
+            }
+        }
+        return texel;
+    };
+
+    auto largest_void = [&]()
+    {
+        int texel = -1;
+        for ( int i = 0; i < texels; ++i )
+        {
+            if ( !pattern[i] && (texel < 0 || energies[i] < energies[texel]) )
+            {
+                texel = i;
+            }
+        }
+        return texel;
+    };
+
+    const int initial_texels = texels / INITIAL_DENSITY;
+    for ( int i = 0; i < initial_texels; ++i )
+    {
+        int texel = int(hash(unsigned(i)) % unsigned(texels));
+        while ( pattern[texel] )
+        {
+            texel = (texel + 1) % texels;
+        }
+        toggle( texel, true );
+    }
+
+    for ( int i = 0; i < texels; ++i )
+    {
+        const int cluster = tightest_cluster();
+        toggle( cluster, false );
+        const int void_ = largest_void();
+        toggle( void_, true );
+        if ( void_ == cluster )
+        {
+            break;
+        }
+    }
+
+    const vector<unsigned char> initial_pattern = pattern;
+    const vector<float> initial_energies = energies;
+    ranks->assign( texels, 0 );
+    for ( int rank = initial_texels - 1; rank >= 0; --rank )
+    {
+        const int cluster = tightest_cluster();
+        toggle( cluster, false );
+        (*ranks)[cluster] = rank;
+    }
+
+    pattern = initial_pattern;
+    energies = initial_energies;
+    for ( int rank = initial_texels; rank < texels; ++rank )
+    {
+        const int void_ = largest_void();
+        toggle( void_, true );
+        (*ranks)[void_] = rank;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+namespace reyes
+{
+
+/**
+// A tileable 64x64 pattern of blue noise used to dither quantized pixels.
+//
+// The pattern is generated once with the void-and-cluster method so that 
+// the same pixel is always dithered by the same amount regardless of the
+// order or the thread that it is quantized on.  Each of the four elements 
+// of a pixel reads the pattern at a different offset so that color 
+// channels aren't dithered in lockstep.
+*/
+class BlueNoise
+{
+    std::vector<float> values_; ///< The dither for each element of each pixel in [-1, 1) with each row padded by repeating its first pixels.
+
+public:
+    static const int TILE_SIZE = 64;
+    static const int PADDING = 4;
+
+    BlueNoise();
+    const float* values( int x, int y ) const;
+    static const BlueNoise& pattern();
+
+private:
+    static void generate( std::vector<int>* ranks );
+};
+
+}
@@ -18,6 +18,7 @@
 #include <math/vec3.ipp>
 #include <algorithm>
 #include <iterator>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -56,9 +57,9 @@ CodeGenerator::Loop::Loop( int begin )
     jumps_to_end_.reserve( JUMPS_TO_END_RESERVE );
 }
 
-CodeGenerator::CodeGenerator( ErrorPolicy* error_policy )
+CodeGenerator::CodeGenerator( ErrorPolicy* error_policy, int maximum_vertices )
 : error_policy_( error_policy )
-, maximum_vertices_( 64 * 64 )
+, maximum_vertices_( maximum_vertices )
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , grid_memory_size_( 0 )
@@ -70,6 +71,7 @@ CodeGenerator::CodeGenerator( ErrorPolicy* error_policy )
 , constant_data_()
 , temporary_addresses_()
 , offset_( 0 )
+, overlap_rows_( 0 )
 {
     REYES_ASSERT( symbol_table_ );
 
@@ -96,6 +98,7 @@ void CodeGenerator::generate( SyntaxNode* node, const char* name )
     constant_data_.clear();
     temporary_addresses_.clear();
     offset_ = 0;
+    overlap_rows_ = 0;
 
     if ( node && error_policy_->total_errors() == 0 )
     {
@@ -159,6 +162,11 @@ int CodeGenerator::maximum_vertices() const
     return maximum_vertices_;
 }
 
+int CodeGenerator::overlap_rows() const
+{
+    return overlap_rows_;
+}
+
 int CodeGenerator::constant_memory_size() const
 {
     return int(constant_data_.size());
@@ -755,6 +763,8 @@ void CodeGenerator::generate_ambient_statement( const SyntaxNode& node )
 {
     REYES_ASSERT( node.node_type() == SHADER_NODE_AMBIENT );
 
+    overlap_rows_ = INT_MAX;
+
     int default_base_address = offset_;
     Scope* scope = node.scope();
     if ( scope )
@@ -778,6 +788,8 @@ void CodeGenerator::generate_solar_statement( const SyntaxNode& node )
 {
     REYES_ASSERT( node.node_type() == SHADER_NODE_SOLAR );
 
+    overlap_rows_ = INT_MAX;
+
     int default_base_address = offset_;
     Scope* scope = node.scope();
     if ( scope )
@@ -815,6 +827,8 @@ void CodeGenerator::generate_illuminate_statement( const SyntaxNode& node )
 {
     REYES_ASSERT( node.node_type() == SHADER_NODE_ILLUMINATE );
 
+    overlap_rows_ = INT_MAX;
+
     int default_base_address = offset_;
     Scope* scope = node.scope();
     if ( scope )
@@ -1091,6 +1105,10 @@ Address CodeGenerator::generate_call_expression( const SyntaxNode& call_node )
     }
     
     const shared_ptr<Symbol>& symbol = call_node.symbol();
+    if ( reads_neighbouring_rows(symbol->identifier()) )
+    {
+        overlap_rows_ = loops_.empty() && overlap_rows_ < INT_MAX ? overlap_rows_ + 1 : INT_MAX;
+    }
     instruction( INSTRUCTION_CALL, symbol->type(), symbol->storage() );
     argument( call_node.symbol()->index() );
     argument( call_node.nodes().size() );
@@ -1103,6 +1121,17 @@ Address CodeGenerator::generate_call_expression( const SyntaxNode& call_node )
     return result;
 }
 
+bool CodeGenerator::reads_neighbouring_rows( const std::string& identifier ) const
+{
+    return 
+        identifier == "Du" || 
+        identifier == "Dv" || 
+        identifier == "Deriv" || 
+        identifier == "area" || 
+        identifier == "calculatenormal"
+    ;
+}
+
 Address CodeGenerator::generate_divide_expression( const SyntaxNode& divide_node )
 {
     REYES_ASSERT( divide_node.node(0) );
@@ -53,9 +53,10 @@ class CodeGenerator
     std::vector<unsigned char> constant_data_; ///< Constants.
     std::vector<int> temporary_addresses_; ///< The stack of addresses that are being used to store temporaries that are still in use.
     int offset_; ///< The offset of the next available temporary memory.
+    int overlap_rows_; ///< The number of neighbouring grid rows read by shading each vertex (INT_MAX if unbounded).
 
 public:
-    CodeGenerator( ErrorPolicy* error_policy = nullptr );
+    CodeGenerator( ErrorPolicy* error_policy = nullptr, int maximum_vertices = 64 * 64 );
     ~CodeGenerator();
     void generate( SyntaxNode* node, const char* name );
 
@@ -64,6 +65,7 @@ public:
     int initialize_address() const;
     int shade_address() const;
     int maximum_vertices() const;
+    int overlap_rows() const;
     int constant_memory_size() const;
     int grid_memory_size() const;
     int temporary_memory_size() const;
@@ -120,6 +122,7 @@ private:
     Address generate_vec3_environment_expression( const SyntaxNode& node );
     Address generate_constant_expression( const SyntaxNode& node );
     Address generate_identifier_expression( const SyntaxNode& node );
+    bool reads_neighbouring_rows( const std::string& identifier ) const;
     
     void instruction( int instruction );
     void instruction( int instruction, ValueType type, ValueStorage storage );
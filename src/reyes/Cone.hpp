@@ -4,8 +4,6 @@
 #include <math/vec2.hpp>
 #include <math/vec3.hpp>
 #include <math/mat4x4.hpp>
-#include <list>
-#include <memory>
 
 namespace reyes
 {
@@ -22,12 +20,13 @@ public:
     Cone( float height, float radius, float thetamax );
     Cone( const Cone& cone, const math::vec2& u_range, const math::vec2& v_range );
 
-    bool boundable() const;
-    void bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum ) const;
-    bool splittable() const;
-    void split( std::list<std::shared_ptr<Geometry>>* primitives ) const;
-    bool diceable() const;
-    void dice( const math::mat4x4& transform, int width, int height, Grid* grid ) const;
+    Geometry* clone() const override;
+    bool boundable() const override;
+    void bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const override;
+    bool splittable() const override;
+    void split( SplitStack* split_stack ) const override;
+    bool diceable() const override;
+    void dice( const math::mat4x4& transform, int width, int height, Grid* grid ) const override;
 
 private:
     math::vec3 position( float u, float v ) const;
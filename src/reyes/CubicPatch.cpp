@@ -5,6 +5,7 @@
 
 #include "CubicPatch.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -16,27 +17,37 @@
 using std::min;
 using std::max;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
 CubicPatch::CubicPatch( const math::vec3* p, const math::vec4* u_basis, const math::vec4* v_basis )
 : Geometry(vec2(0.0f, 1.0f), vec2(0.0f, 1.0f))
-, p_( p )
 , u_basis_( u_basis )
 , v_basis_( v_basis )
 {
-    REYES_ASSERT( p_ );
+    REYES_ASSERT( p );
     REYES_ASSERT( u_basis_ );
     REYES_ASSERT( v_basis_ );
+    for ( int i = 0; i < 16; ++i )
+    {
+        p_[i] = p[i];
+    }
 }
 
 CubicPatch::CubicPatch( const CubicPatch& patch, const math::vec2& u_range, const math::vec2& v_range )
 : Geometry(u_range, v_range)
-, p_( patch.p_ )
 , u_basis_( patch.u_basis_ )
 , v_basis_( patch.v_basis_ )
 {
+    for ( int i = 0; i < 16; ++i )
+    {
+        p_[i] = patch.p_[i];
+    }
+}
+
+Geometry* CubicPatch::clone() const
+{
+    return new CubicPatch( *this );
 }
 
 bool CubicPatch::boundable() const
@@ -44,27 +55,36 @@ bool CubicPatch::boundable() const
     return true;
 }
 
-void CubicPatch::bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const
+void CubicPatch::bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
+
+    // The piece of the patch over its u and v ranges is re-expressed as a 
+    // bicubic Bezier patch whose control points contain it in their convex
+    // hull.
+    float u_bezier [16];
+    float v_bezier [16];
+    bezier_coefficients( u_basis_, u_range(), u_bezier );
+    bezier_coefficients( v_basis_, v_range(), v_bezier );
+
+    vec3 control_points [16];
+    for ( int l = 0; l < 4; ++l )
     {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
+        for ( int k = 0; k < 4; ++k )
+        {
+            vec3 control_point( 0.0f, 0.0f, 0.0f );
+            for ( int j = 0; j < 4; ++j )
+            {
+                for ( int i = 0; i < 4; ++i )
+                {
+                    control_point = control_point + (u_bezier[i * 4 + k] * v_bezier[j * 4 + l]) * p_[j * 4 + i];
+                }
+            }
+            control_points[l * 4 + k] = control_point;
+        }
     }
+    bound_points( transform, control_points, 16, minimum, maximum );
 }
 
 bool CubicPatch::splittable() const
@@ -72,9 +92,9 @@ bool CubicPatch::splittable() const
     return true;
 }
 
-void CubicPatch::split( std::list<std::shared_ptr<Geometry> >* primitives ) const
+void CubicPatch::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -88,15 +108,10 @@ void CubicPatch::split( std::list<std::shared_ptr<Geometry> >* primitives ) cons
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> cubic_patch;
-    cubic_patch.reset( new CubicPatch(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( cubic_patch );
-    cubic_patch.reset( new CubicPatch(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( cubic_patch );
-    cubic_patch.reset( new CubicPatch(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( cubic_patch );
-    cubic_patch.reset( new CubicPatch(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( cubic_patch );
+    split_stack->emplace<CubicPatch>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<CubicPatch>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<CubicPatch>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<CubicPatch>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool CubicPatch::diceable() const
@@ -177,6 +192,31 @@ math::vec3 CubicPatch::position( float u, float v ) const
     ;
 }
 
+void CubicPatch::bezier_coefficients( const math::vec4* basis, const math::vec2& range, float* coefficients ) const
+{
+    REYES_ASSERT( basis );
+    REYES_ASSERT( coefficients );
+
+    // Each cubic basis function restricted to the range is converted to 
+    // Bernstein form from its values and derivatives at either end.
+    const float u0 = range.x;
+    const float u1 = range.y;
+    const float h = (u1 - u0) / 3.0f;
+    const vec4 value0( u0 * u0 * u0, u0 * u0, u0, 1.0f );
+    const vec4 value1( u1 * u1 * u1, u1 * u1, u1, 1.0f );
+    const vec4 derivative0( 3.0f * u0 * u0, 2.0f * u0, 1.0f, 0.0f );
+    const vec4 derivative1( 3.0f * u1 * u1, 2.0f * u1, 1.0f, 0.0f );
+    for ( int i = 0; i < 4; ++i )
+    {
+        float b0 = dot( basis[i], value0 );
+        float b1 = dot( basis[i], value1 );
+        coefficients[i * 4 + 0] = b0;
+        coefficients[i * 4 + 1] = b0 + h * dot( basis[i], derivative0 );
+        coefficients[i * 4 + 2] = b1 - h * dot( basis[i], derivative1 );
+        coefficients[i * 4 + 3] = b1;
+    }
+}
+
 math::vec3 CubicPatch::normal( float u, float v ) const
 {
     REYES_ASSERT( u >= 0.0f && u <= 1.0f );
@@ -4,8 +4,6 @@
 #include <math/vec2.hpp>
 #include <math/vec3.hpp>
 #include <math/mat4x4.hpp>
-#include <list>
-#include <memory>
 
 namespace reyes
 {
@@ -23,10 +21,11 @@ public:
     Cylinder( float radius, float zmin, float zmax, float thetamax );
     Cylinder( const Cylinder& cylinder, const math::vec2& u_range, const math::vec2& v_range );
 
+    Geometry* clone() const override;
     bool boundable() const override;
     void bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const override;
     bool splittable() const override;
-    void split( std::list<std::shared_ptr<Geometry>>* primitives ) const override;
+    void split( SplitStack* split_stack ) const override;
     bool diceable() const override;
     void dice( const math::mat4x4& transform, int width, int height, Grid* grid ) const override;
 
@@ -11,6 +11,7 @@
 #include "Shader.hpp"
 #include "ValueStorage.hpp"
 #include <reyes/reyes_virtual_machine/Instruction.hpp>
+#include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
 #include "assert.hpp"
@@ -408,28 +409,28 @@ void Debugger::dump_sample_buffer( const SampleBuffer& sample_buffer, const math
     
     for ( int y = y0; y < y1; ++y )
     {
-        const float* left = sample_buffer.position( x0, y );
-        vec3 xx0 = unproject( left, inverse_screen_transform, float(width), float(height) ) - vec3( dx, 0.0f, 0.0f );
+        const vec2 left = sample_buffer.position( x0, y );
+        vec3 xx0 = unproject( &left.x, inverse_screen_transform, float(width), float(height) ) - vec3( dx, 0.0f, 0.0f );
         fprintf( stream, "       // y=%d\n", y );
         fprintf( stream, "       %f %f %f\n", xx0.x, xx0.y, xx0.z );
         fprintf( stream, "       %f %f %f %f\n", color.x, color.y, color.z, color.w );
 
-        const float* right = sample_buffer.position( x1 - 1, y );
-        vec3 xx1 = unproject( right, inverse_screen_transform, float(width), float(height) ) + vec3( dx, 0.0f, 0.0f );
+        const vec2 right = sample_buffer.position( x1 - 1, y );
+        vec3 xx1 = unproject( &right.x, inverse_screen_transform, float(width), float(height) ) + vec3( dx, 0.0f, 0.0f );
         fprintf( stream, "       %f %f %f\n", xx1.x, xx1.y, xx1.z );
         fprintf( stream, "       %f %f %f %f\n", color.x, color.y, color.z, color.w );
     }
 
     for ( int x = x0; x < x1; ++x )
     {        
-        const float* bottom = sample_buffer.position( x, y1 - 1 );
-        vec3 yy0 = unproject( bottom, inverse_screen_transform, float(width), float(height) ) - vec3( 0.0f, dy, 0.0f );
+        const vec2 bottom = sample_buffer.position( x, y1 - 1 );
+        vec3 yy0 = unproject( &bottom.x, inverse_screen_transform, float(width), float(height) ) - vec3( 0.0f, dy, 0.0f );
         fprintf( stream, "       // x=%d\n", x );
         fprintf( stream, "       %f %f %f\n", yy0.x, yy0.y, yy0.z );
         fprintf( stream, "       %f %f %f %f\n", color.x, color.y, color.z, color.w );
 
-        const float* top = sample_buffer.position( x, y0 );
-        vec3 yy1 = unproject( top, inverse_screen_transform, float(width), float(height) ) + vec3( 0.0f, dy, 0.0f );
+        const vec2 top = sample_buffer.position( x, y0 );
+        vec3 yy1 = unproject( &top.x, inverse_screen_transform, float(width), float(height) ) + vec3( 0.0f, dy, 0.0f );
         fprintf( stream, "       %f %f %f\n", yy1.x, yy1.y, yy1.z );
         fprintf( stream, "       %f %f %f %f\n", color.x, color.y, color.z, color.w );
     }
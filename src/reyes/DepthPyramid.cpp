@@ -0,0 +1,237 @@
+//
+// DepthPyramid.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "DepthPyramid.hpp"
+#include "assert.hpp"
+#include <algorithm>
+#include <float.h>
+
+using std::min;
+using std::max;
+using namespace reyes;
+
+static const int TILE_SIZE = 4;
+
+DepthPyramid::DepthPyramid()
+: width_( 0 )
+, height_( 0 )
+, levels_()
+{
+}
+
+int DepthPyramid::width() const
+{
+    return width_;
+}
+
+int DepthPyramid::height() const
+{
+    return height_;
+}
+
+int DepthPyramid::levels() const
+{
+    return int(levels_.size());
+}
+
+/**
+// Resize this pyramid to cover a \e width by \e height window of samples
+// and mark every tile as empty.
+//
+// @param width
+//  The number of samples across.
+//
+// @param height
+//  The number of samples down.
+*/
+void DepthPyramid::reset( int width, int height )
+{
+    REYES_ASSERT( width > 0 );
+    REYES_ASSERT( height > 0 );
+
+    width_ = width;
+    height_ = height;
+
+    int levels = 1;
+    int tiles_across = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_down = (height + TILE_SIZE - 1) / TILE_SIZE;
+    while ( tiles_across > 1 || tiles_down > 1 )
+    {
+        tiles_across = (tiles_across + 1) / 2;
+        tiles_down = (tiles_down + 1) / 2;
+        ++levels;
+    }
+
+    levels_.resize( levels );
+    tiles_across = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_down = (height + TILE_SIZE - 1) / TILE_SIZE;
+    for ( Level& level : levels_ )
+    {
+        level.width_ = tiles_across;
+        level.height_ = tiles_down;
+        level.minimums_.assign( tiles_across * tiles_down, FLT_MAX );
+        level.maximums_.assign( tiles_across * tiles_down, FLT_MAX );
+        tiles_across = (tiles_across + 1) / 2;
+        tiles_down = (tiles_down + 1) / 2;
+    }
+}
+
+/**
+// Update the tiles that cover a rectangle of samples after depths have
+// been written there.
+//
+// @param depths
+//  The depths of the samples covered by this pyramid (assumed not null).
+//
+// @param stride
+//  The number of depths between vertically adjacent samples in \e depths.
+//
+// @param x0, y0
+//  The first sample across and down that may have changed.
+//
+// @param x1, y1
+//  One past the last sample across and down that may have changed.
+*/
+void DepthPyramid::update( const float* depths, int stride, int x0, int y0, int x1, int y1 )
+{
+    REYES_ASSERT( depths );
+    REYES_ASSERT( stride >= width_ );
+
+    x0 = max( x0, 0 );
+    y0 = max( y0, 0 );
+    x1 = min( x1, width_ );
+    y1 = min( y1, height_ );
+    if ( levels_.empty() || x0 >= x1 || y0 >= y1 )
+    {
+        return;
+    }
+
+    int tx0 = x0 / TILE_SIZE;
+    int tx1 = (x1 - 1) / TILE_SIZE + 1;
+    int ty0 = y0 / TILE_SIZE;
+    int ty1 = (y1 - 1) / TILE_SIZE + 1;
+
+    Level& finest = levels_.front();
+    for ( int ty = ty0; ty < ty1; ++ty )
+    {
+        for ( int tx = tx0; tx < tx1; ++tx )
+        {
+            float minimum = FLT_MAX;
+            float maximum = -FLT_MAX;
+            int sx1 = min( (tx + 1) * TILE_SIZE, width_ );
+            int sy1 = min( (ty + 1) * TILE_SIZE, height_ );
+            for ( int y = ty * TILE_SIZE; y < sy1; ++y )
+            {
+                for ( int x = tx * TILE_SIZE; x < sx1; ++x )
+                {
+                    float depth = depths[y * stride + x];
+                    minimum = min( minimum, depth );
+                    maximum = max( maximum, depth );
+                }
+            }
+            finest.minimums_[ty * finest.width_ + tx] = minimum;
+            finest.maximums_[ty * finest.width_ + tx] = maximum;
+        }
+    }
+
+    for ( int i = 1; i < int(levels_.size()); ++i )
+    {
+        const Level& finer = levels_[i - 1];
+        Level& level = levels_[i];
+        tx0 = tx0 / 2;
+        tx1 = (tx1 + 1) / 2;
+        ty0 = ty0 / 2;
+        ty1 = (ty1 + 1) / 2;
+        for ( int ty = ty0; ty < ty1; ++ty )
+        {
+            for ( int tx = tx0; tx < tx1; ++tx )
+            {
+                float minimum = FLT_MAX;
+                float maximum = -FLT_MAX;
+                int cx1 = min( tx * 2 + 2, finer.width_ );
+                int cy1 = min( ty * 2 + 2, finer.height_ );
+                for ( int y = ty * 2; y < cy1; ++y )
+                {
+                    for ( int x = tx * 2; x < cx1; ++x )
+                    {
+                        minimum = min( minimum, finer.minimums_[y * finer.width_ + x] );
+                        maximum = max( maximum, finer.maximums_[y * finer.width_ + x] );
+                    }
+                }
+                level.minimums_[ty * level.width_ + tx] = minimum;
+                level.maximums_[ty * level.width_ + tx] = maximum;
+            }
+        }
+    }
+}
+
+/**
+// Is geometry no nearer than \e depth hidden at every sample in a
+// rectangle?
+//
+// @param x0, y0
+//  The first sample across and down.
+//
+// @param x1, y1
+//  One past the last sample across and down.
+//
+// @param depth
+//  The nearest depth of the geometry.
+//
+// @return
+//  True if no sample in the rectangle could be written by geometry at
+//  \e depth or farther otherwise false.
+*/
+bool DepthPyramid::occluded( int x0, int y0, int x1, int y1, float depth ) const
+{
+    x0 = max( x0, 0 );
+    y0 = max( y0, 0 );
+    x1 = min( x1, width_ );
+    y1 = min( y1, height_ );
+    if ( levels_.empty() )
+    {
+        return false;
+    }
+    if ( x0 >= x1 || y0 >= y1 )
+    {
+        return true;
+    }
+    return occluded( int(levels_.size()) - 1, 0, 0, x0, y0, x1, y1, depth );
+}
+
+bool DepthPyramid::occluded( int level, int x, int y, int x0, int y0, int x1, int y1, float depth ) const
+{
+    const int size = TILE_SIZE << level;
+    if ( (x + 1) * size <= x0 || x * size >= x1 || (y + 1) * size <= y0 || y * size >= y1 )
+    {
+        return true;
+    }
+
+    const Level& tiles = levels_[level];
+    const int index = y * tiles.width_ + x;
+    if ( depth >= tiles.maximums_[index] )
+    {
+        return true;
+    }
+    if ( depth < tiles.minimums_[index] || level == 0 )
+    {
+        return false;
+    }
+
+    const Level& finer = levels_[level - 1];
+    const int cx1 = min( x * 2 + 2, finer.width_ );
+    const int cy1 = min( y * 2 + 2, finer.height_ );
+    for ( int cy = y * 2; cy < cy1; ++cy )
+    {
+        for ( int cx = x * 2; cx < cx1; ++cx )
+        {
+            if ( !occluded(level - 1, cx, cy, x0, y0, x1, y1, depth) )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
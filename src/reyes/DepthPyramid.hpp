@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+namespace reyes
+{
+
+/**
+// A hierarchy of the minimum and maximum depths of tiles of samples in a
+// sample buffer.
+//
+// The finest level stores the nearest and farthest depths of each 4x4 tile
+// of samples.  Each coarser level halves the number of tiles across and down
+// until a single tile covers every sample.  Geometry whose nearest depth is
+// at or beyond the farthest depth of every sample that it overlaps can't
+// write any sample and can be culled without being diced or shaded.
+*/
+class DepthPyramid
+{
+    struct Level
+    {
+        int width_; ///< The number of tiles across this level.
+        int height_; ///< The number of tiles down this level.
+        std::vector<float> minimums_; ///< The nearest depth in each tile.
+        std::vector<float> maximums_; ///< The farthest depth in each tile.
+    };
+
+    int width_; ///< The number of samples across.
+    int height_; ///< The number of samples down.
+    std::vector<Level> levels_; ///< The levels from finest to coarsest.
+
+public:
+    DepthPyramid();
+    int width() const;
+    int height() const;
+    int levels() const;
+    void reset( int width, int height );
+    void update( const float* depths, int stride, int x0, int y0, int x1, int y1 );
+    bool occluded( int x0, int y0, int x1, int y1, float depth ) const;
+
+private:
+    bool occluded( int level, int x, int y, int x0, int y0, int x1, int y1, float depth ) const;
+};
+
+}
@@ -0,0 +1,16 @@
+//
+// Display.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Display.hpp"
+
+using namespace reyes;
+
+Display::Display()
+{
+}
+
+Display::~Display()
+{
+}
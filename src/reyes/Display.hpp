@@ -0,0 +1,27 @@
+#pragma once
+
+namespace reyes
+{
+
+class ErrorPolicy;
+
+/**
+// An interface to be implemented by objects that receive the final image
+// a few rows at a time while it is being rendered.
+//
+// Rows are written in order from top to bottom as soon as every pixel in 
+// them has been filtered, exposed, and quantized.  Displays are called from
+// whichever thread completes the rows but never from more than one thread
+// at a time.
+*/
+class Display
+{
+public:
+    Display();
+    virtual ~Display();
+    virtual void begin( int width, int height, int elements, ErrorPolicy* error_policy ) = 0;
+    virtual void write( int y0, int y1, const unsigned char* pixels ) = 0;
+    virtual void end() = 0;
+};
+
+}
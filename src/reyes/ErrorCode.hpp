@@ -22,6 +22,9 @@ enum ErrorCode
     RENDER_ERROR_OUT_OF_MEMORY, ///< A memory allocation failed.
     RENDER_ERROR_UNKNOWN_COLOR_SPACE, ///< An unknown color space was passed to ctransform() or used in a typecast expression.
     RENDER_ERROR_INVALID_DISPLAY_MODE, ///< A display mode was requested for a device or file format that doesn't support it.
+    RENDER_ERROR_SAMPLES_UNAVAILABLE, ///< The samples for the whole frame were requested but only the last bucket rendered is available.
+    RENDER_ERROR_INCOMPATIBLE_SCENE, ///< A scene was recorded or rendered with a different maximum grid size than it was first recorded with.
+    RENDER_ERROR_WRITING_FILE_FAILED, ///< Writing to a file that was opened successfully failed.
     RENDER_ERROR_COUNT
 };
 
@@ -0,0 +1,147 @@
+//
+// Exposure.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Exposure.hpp"
+#include "BlueNoise.hpp"
+#include <math/vec4.ipp>
+#include <math/scalar.ipp>
+#include "assert.hpp"
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define REYES_EXPOSURE_SIMD
+#include <emmintrin.h>
+#endif
+
+using namespace math;
+using namespace reyes;
+
+static const uint32_t GAMMA_TABLE_MINIMUM = 0x37800000u; // 2^-16
+static const uint32_t GAMMA_TABLE_MAXIMUM = 0x43800000u; // 2^8
+static const int GAMMA_TABLE_SHIFT = 13;
+static const int GAMMA_TABLE_SEGMENTS = int((GAMMA_TABLE_MAXIMUM - GAMMA_TABLE_MINIMUM) >> GAMMA_TABLE_SHIFT);
+
+static inline uint32_t float_bits( float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    return bits;
+}
+
+static inline float bits_float( uint32_t bits )
+{
+    float value;
+    memcpy( &value, &bits, sizeof(value) );
+    return value;
+}
+
+Exposure::Exposure( float gain, float gamma, float one, int minimum, int maximum, float dither )
+: gain_( gain )
+, gamma_( gamma )
+, one_( one )
+, minimum_( clamp(minimum, 0, 255) )
+, maximum_( clamp(maximum, 0, 255) )
+, dither_( dither )
+, gammas_()
+{
+    if ( gamma_ != 1.0f )
+    {
+        gammas_.resize( GAMMA_TABLE_SEGMENTS + 1 );
+        for ( int i = 0; i <= GAMMA_TABLE_SEGMENTS; ++i )
+        {
+            gammas_[i] = powf( bits_float(GAMMA_TABLE_MINIMUM + (uint32_t(i) << GAMMA_TABLE_SHIFT)), gamma_ );
+        }
+    }
+}
+
+/**
+// Expose and quantize pixels.
+//
+// @param pixels
+//  The filtered pixels to expose and quantize (assumed not null).
+//
+// @param x, y
+//  The position of the first pixel in the image (used to look up dither).
+//
+// @param count
+//  The number of pixels to expose and quantize, across from (x, y).
+//
+// @param quantized_pixels
+//  The 8 bit elements to write the quantized pixels to, four per pixel 
+//  (assumed not null).
+*/
+void Exposure::quantize( const math::vec4* pixels, int x, int y, int count, unsigned char* quantized_pixels ) const
+{
+    REYES_ASSERT( pixels || count == 0 );
+    REYES_ASSERT( quantized_pixels || count == 0 );
+    REYES_ASSERT( BlueNoise::PADDING == 4 );
+
+    const BlueNoise& blue_noise = BlueNoise::pattern();
+    const float* elements = &pixels[0].x;
+    const int size = count * 4;
+    int i = 0;
+
+#ifdef REYES_EXPOSURE_SIMD
+    // Round by truncating after adding a half; values are clamped first so
+    // that they convert exactly and anything below zero truncates to at 
+    // most the minimum.
+    const __m128 one = _mm_set1_ps( one_ );
+    const __m128 dither = _mm_set1_ps( dither_ );
+    const __m128 lower = _mm_set1_ps( -1.0f );
+    const __m128 upper = _mm_set1_ps( 256.0f );
+    const __m128 half = _mm_set1_ps( 0.5f );
+    const __m128i minimum = _mm_set1_epi8( char(minimum_) );
+    const __m128i maximum = _mm_set1_epi8( char(maximum_) );
+    for ( ; i + 16 <= size; i += 16 )
+    {
+        float exposed [16];
+        for ( int j = 0; j < 16; ++j )
+        {
+            exposed[j] = expose( elements[i + j] );
+        }
+
+        // The blue noise rows are padded so that the dither for four 
+        // pixels is always contiguous.
+        const float* noise = blue_noise.values( x + i / 4, y );
+        __m128i quantized [4];
+        for ( int j = 0; j < 4; ++j )
+        {
+            __m128 value = _mm_add_ps( _mm_mul_ps(one, _mm_loadu_ps(&exposed[j * 4])), _mm_mul_ps(dither, _mm_loadu_ps(&noise[j * 4])) );
+            value = _mm_add_ps( _mm_min_ps(_mm_max_ps(value, lower), upper), half );
+            quantized[j] = _mm_cvttps_epi32( value );
+        }
+        __m128i bytes = _mm_packus_epi16( _mm_packs_epi32(quantized[0], quantized[1]), _mm_packs_epi32(quantized[2], quantized[3]) );
+        bytes = _mm_min_epu8( _mm_max_epu8(bytes, minimum), maximum );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(&quantized_pixels[i]), bytes );
+    }
+#endif
+
+    for ( ; i < size; ++i )
+    {
+        const float noise = blue_noise.values( x + i / 4, y )[i % 4];
+        quantized_pixels[i] = (unsigned char) clamp( int(math::round(one_ * expose(elements[i]) + dither_ * noise)), minimum_, maximum_ );
+    }
+}
+
+inline float Exposure::expose( float value ) const
+{
+    const float exposed = value * gain_;
+    if ( gammas_.empty() )
+    {
+        return exposed;
+    }
+
+    const uint32_t bits = float_bits( exposed );
+    if ( bits >= GAMMA_TABLE_MINIMUM && bits < GAMMA_TABLE_MAXIMUM )
+    {
+        const uint32_t offset = bits - GAMMA_TABLE_MINIMUM;
+        const int index = int(offset >> GAMMA_TABLE_SHIFT);
+        const float t = float(offset & ((1u << GAMMA_TABLE_SHIFT) - 1)) * (1.0f / float(1u << GAMMA_TABLE_SHIFT));
+        return gammas_[index] + t * (gammas_[index + 1] - gammas_[index]);
+    }
+    return powf( exposed > 0.0f ? exposed : 0.0f, gamma_ );
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <math/vec4.hpp>
+#include <vector>
+
+namespace reyes
+{
+
+/**
+// Exposes filtered pixels with a gain and gamma and quantizes them into 
+// 8 bit elements.
+//
+// Gamma is looked up from a table with one linearly interpolated segment 
+// for each of the top 10 bits of the mantissa of every power of two that 
+// the table covers so the relative error is the same for dark and bright 
+// values.  Values outside the table fall back to powf().
+//
+// Dither comes from a blue noise pattern indexed by pixel position so that
+// quantized pixels are the same no matter which thread quantizes them.
+*/
+class Exposure
+{
+    float gain_; ///< The gain to multiply elements by before gamma.
+    float gamma_; ///< The gamma to raise elements to.
+    float one_; ///< The quantized value that one maps to.
+    int minimum_; ///< The minimum quantized value.
+    int maximum_; ///< The maximum quantized value.
+    float dither_; ///< The amplitude of the dither added before rounding.
+    std::vector<float> gammas_; ///< Gamma at the start of each segment of the table (empty when gamma is one).
+
+public:
+    Exposure( float gain, float gamma, float one, int minimum, int maximum, float dither );
+    void quantize( const math::vec4* pixels, int x, int y, int count, unsigned char* quantized_pixels ) const;
+
+private:
+    float expose( float value ) const;
+};
+
+}
@@ -10,12 +10,13 @@
 #include "assert.hpp"
 #include <algorithm>
 #include <vector>
+#include <float.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
 
 using std::min;
 using std::max;
-using std::list;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -39,6 +40,12 @@ const math::vec2& Geometry::v_range() const
     return v_range_;
 }
 
+Geometry* Geometry::clone() const
+{
+    REYES_ASSERT( false );
+    return nullptr;
+}
+
 bool Geometry::boundable() const
 {
     return false;
@@ -53,7 +60,7 @@ bool Geometry::splittable() const
     return false;
 }
 
-void Geometry::split( std::list<std::shared_ptr<Geometry>>* /*primitives*/ ) const
+void Geometry::split( SplitStack* /*split_stack*/ ) const
 {
     REYES_ASSERT( false );
 }
@@ -66,3 +73,99 @@ bool Geometry::diceable() const
 void Geometry::dice( const math::mat4x4& /*transform*/, int /*width*/, int /*height*/, Grid* /*grid*/ ) const
 {
 }
+
+void Geometry::bound_points( const math::mat4x4& transform, const math::vec3* points, int count, math::vec3* minimum, math::vec3* maximum ) const
+{
+    REYES_ASSERT( points );
+    REYES_ASSERT( count > 0 );
+    REYES_ASSERT( minimum );
+    REYES_ASSERT( maximum );
+
+    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
+    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    for ( const vec3* i = points; i != points + count; ++i )
+    {
+        vec3 position = vec3( transform * vec4(*i, 1.0f) );
+        minimum->x = min( minimum->x, position.x );
+        minimum->y = min( minimum->y, position.y );
+        minimum->z = min( minimum->z, position.z );        
+        maximum->x = max( maximum->x, position.x );
+        maximum->y = max( maximum->y, position.y );
+        maximum->z = max( maximum->z, position.z );
+    }
+}
+
+void Geometry::bound_revolution( const math::mat4x4& transform, const math::vec2& radius_range, const math::vec2& angle_range, const math::vec2& z_range, math::vec3* minimum, math::vec3* maximum ) const
+{
+    // The angle range is cut into arcs of at most a quarter turn.  Each arc
+    // lies within the triangle formed by its ends and the intersection of
+    // the tangents at its ends so the swept surface lies within the convex 
+    // hull of those points at the inner and outer radii and at either end 
+    // of the z range.
+    const float HALF_PI = 0.5f * float(M_PI);
+    const float TWO_PI = 2.0f * float(M_PI);
+    const int MAXIMUM_POINTS = 2 * (2 * 5 + 2 * 4);
+    float a0 = min( angle_range.x, angle_range.y );
+    float a1 = min( max(angle_range.x, angle_range.y), a0 + TWO_PI );
+    int arcs = max( 1, min(int(ceilf((a1 - a0) / HALF_PI)), 4) );
+    float arc = (a1 - a0) / float(arcs);
+    float tangent_scale = 1.0f / cosf( 0.5f * arc );
+
+    vec3 points [MAXIMUM_POINTS];
+    int count = 0;
+    for ( int i = 0; i < 2; ++i )
+    {
+        float z = i == 0 ? z_range.x : z_range.y;
+        for ( int j = 0; j <= arcs; ++j )
+        {
+            float angle = a0 + arc * float(j);
+            float c = cosf( angle );
+            float s = sinf( angle );
+            points[count++] = vec3( radius_range.x * c, radius_range.x * s, z );
+            points[count++] = vec3( radius_range.y * c, radius_range.y * s, z );
+            if ( j < arcs )
+            {
+                float tangent_c = cosf( angle + 0.5f * arc ) * tangent_scale;
+                float tangent_s = sinf( angle + 0.5f * arc ) * tangent_scale;
+                points[count++] = vec3( radius_range.x * tangent_c, radius_range.x * tangent_s, z );
+                points[count++] = vec3( radius_range.y * tangent_c, radius_range.y * tangent_s, z );
+            }
+        }
+    }
+    REYES_ASSERT( count <= MAXIMUM_POINTS );
+    bound_points( transform, points, count, minimum, maximum );
+}
+
+math::vec2 Geometry::cos_range( float angle0, float angle1 )
+{
+    const float PI = float(M_PI);
+    const float TWO_PI = 2.0f * float(M_PI);
+    float a0 = min( angle0, angle1 );
+    float a1 = max( angle0, angle1 );
+    if ( a1 - a0 >= TWO_PI )
+    {
+        return vec2( -1.0f, 1.0f );
+    }
+
+    vec2 range = ordered( cosf(a0), cosf(a1) );
+    if ( ceilf(a0 / TWO_PI) * TWO_PI <= a1 )
+    {
+        range.y = 1.0f;
+    }
+    if ( ceilf((a0 - PI) / TWO_PI) * TWO_PI + PI <= a1 )
+    {
+        range.x = -1.0f;
+    }
+    return range;
+}
+
+math::vec2 Geometry::sin_range( float angle0, float angle1 )
+{
+    const float HALF_PI = 0.5f * float(M_PI);
+    return cos_range( angle0 - HALF_PI, angle1 - HALF_PI );
+}
+
+math::vec2 Geometry::ordered( float a, float b )
+{
+    return vec2( min(a, b), max(a, b) );
+}
@@ -3,13 +3,12 @@
 #include <math/vec2.hpp>
 #include <math/vec3.hpp>
 #include <math/mat4x4.hpp>
-#include <list>
-#include <memory>
 
 namespace reyes
 {
 
 class Grid;
+class SplitStack;
 
 /**
 // The base class for geometry types supported by the renderer.
@@ -26,12 +25,20 @@ public:
     const math::vec2& u_range() const;
     const math::vec2& v_range() const;
     
+    virtual Geometry* clone() const;
     virtual bool boundable() const;
     virtual void bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const;
     virtual bool splittable() const;
-    virtual void split( std::list<std::shared_ptr<Geometry>>* primitives ) const;
+    virtual void split( SplitStack* split_stack ) const;
     virtual bool diceable() const;
     virtual void dice( const math::mat4x4& transform, int width, int height, Grid* grid ) const;
+
+protected:
+    void bound_points( const math::mat4x4& transform, const math::vec3* points, int count, math::vec3* minimum, math::vec3* maximum ) const;
+    void bound_revolution( const math::mat4x4& transform, const math::vec2& radius_range, const math::vec2& angle_range, const math::vec2& z_range, math::vec3* minimum, math::vec3* maximum ) const;
+    static math::vec2 cos_range( float angle0, float angle1 );
+    static math::vec2 sin_range( float angle0, float angle1 );
+    static math::vec2 ordered( float a, float b );
 };
 
 }
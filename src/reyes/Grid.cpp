@@ -34,6 +34,7 @@ Grid::Grid()
 , transform_( math::identity() )
 , shader_( nullptr )
 , normals_generated_( false )
+, revision_( 0 )
 {
 }
 
@@ -49,6 +50,7 @@ Grid::Grid( Shader* shader )
 , transform_( math::identity() )
 , shader_( nullptr )
 , normals_generated_( false )
+, revision_( 0 )
 {
     set_shader( shader );
 }
@@ -61,10 +63,12 @@ Grid::Grid( const Grid& grid )
 , symbols_( grid.symbols_ )
 , memory_size_( 0 )
 , memory_( nullptr )
+, strings_( grid.strings_ )
 , lights_()
 , transform_( grid.transform_ )
 , shader_( grid.shader_ )
 , normals_generated_( grid.normals_generated_ )
+, revision_( grid.revision_ )
 {
     reserve();
     memcpy( memory_, grid.memory_, memory_size_ );
@@ -79,9 +83,11 @@ Grid& Grid::operator=( const Grid& grid )
         du_ = grid.du_;
         dv_ = grid.dv_;
         symbols_ = grid.symbols_;
+        strings_ = grid.strings_;
         transform_ = grid.transform_;
         shader_ = grid.shader_;
         normals_generated_ = grid.normals_generated_;
+        revision_ = grid.revision_;
         lights_.clear();        
         reserve();
         memcpy( memory_, grid.memory_, memory_size_ );
@@ -134,6 +140,11 @@ Shader* Grid::shader() const
     return shader_;
 }
 
+int Grid::revision() const
+{
+    return revision_;
+}
+
 const Symbol* Grid::find_symbol( const char* identifier ) const
 {
     vector<shared_ptr<Symbol>>::const_iterator i = symbols_.begin();
@@ -341,6 +352,7 @@ void Grid::set_string( int index, const std::string& value )
 
 SetValueHelper Grid::operator[]( const std::string& identifier )
 {
+    ++revision_;
     const Symbol* symbol = find_symbol( identifier.c_str() );
     if ( symbol )
     {
@@ -379,6 +391,40 @@ void Grid::zero()
     }
 }
 
+void Grid::copy_uniforms( const Grid& grid )
+{
+    REYES_ASSERT( shader_ && shader_ == grid.shader_ );
+    du_ = grid.du_;
+    dv_ = grid.dv_;
+    strings_ = grid.strings_;
+    transform_ = grid.transform_;
+    for ( const shared_ptr<Symbol>& symbol : symbols_ )
+    {
+        if ( symbol->segment() == SEGMENT_GRID && symbol->storage() != STORAGE_VARYING )
+        {
+            memcpy( lookup(symbol->offset()), grid.lookup(symbol->offset()), symbol->size_by_type_and_storage(1) );
+        }
+    }
+}
+
+void Grid::copy_rows( const Grid& grid, int from_row, int to_row, int rows )
+{
+    REYES_ASSERT( shader_ && shader_ == grid.shader_ );
+    REYES_ASSERT( width_ == grid.width_ );
+    REYES_ASSERT( from_row >= 0 && from_row + rows <= grid.height_ );
+    REYES_ASSERT( to_row >= 0 && to_row + rows <= height_ );
+    for ( const shared_ptr<Symbol>& symbol : symbols_ )
+    {
+        if ( symbol->segment() == SEGMENT_GRID && symbol->storage() == STORAGE_VARYING )
+        {
+            int row_size = width_ * symbol->size_by_type_and_storage( 1 );
+            unsigned char* destination = reinterpret_cast<unsigned char*>( lookup(symbol->offset()) );
+            const unsigned char* source = reinterpret_cast<const unsigned char*>( grid.lookup(symbol->offset()) );
+            memcpy( destination + to_row * row_size, source + from_row * row_size, rows * row_size );
+        }
+    }
+}
+
 void Grid::clear_lights()
 {
     lights_.clear();
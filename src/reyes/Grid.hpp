@@ -45,6 +45,7 @@ class Grid
     math::mat4x4 transform_; ///< The object to camera space transform at the time this Grid was bound to a Shader.
     Shader* shader_; ///< The light shader that this Grid stores parameters for or null if this Grid doesn't store parameters.
     bool normals_generated_; // True if normals have been generated from positions.
+    int revision_; ///< Incremented each time a parameter is set through Grid::operator[]().
 
 public:
     Grid();
@@ -60,6 +61,7 @@ public:
     float du() const;
     float dv() const;
     Shader* shader() const;
+    int revision() const;
     const Symbol* find_symbol( const char* identifier ) const;
     unsigned char* memory() const;
     float* float_value( int address ) const;
@@ -86,6 +88,8 @@ public:
     SetValueHelper operator[]( const std::string& identifier );
     void set_shader( Shader* shader );
     void zero();
+    void copy_uniforms( const Grid& grid );
+    void copy_rows( const Grid& grid, int from_row, int to_row, int rows );
 
     void clear_lights();
     void reserve_lights( unsigned int lights );
@@ -0,0 +1,176 @@
+//
+// GridCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "GridCache.hpp"
+#include "Grid.hpp"
+#include "assert.hpp"
+#include <math/vec2.ipp>
+#include <math/vec3.ipp>
+
+using std::map;
+using std::multimap;
+using std::mutex;
+using std::lock_guard;
+using std::vector;
+using std::make_pair;
+using std::make_tuple;
+using std::shared_ptr;
+using std::max;
+using namespace math;
+using namespace reyes;
+
+GridCache::GridCache()
+: mutex_()
+, entries_()
+, expiries_()
+, finished_buckets_()
+, unfinished_bucket_( 0 )
+{
+}
+
+/**
+// Acquire a shaded grid for one of the buckets that it overlaps.
+//
+// The grid is released from the cache once it has been acquired by the 
+// last of the buckets that it was inserted for.
+//
+// @param primitive
+//  The index of the primitive that the grid was split from.
+//
+// @param u_range, v_range
+//  The parametric range of the split geometry that the grid was diced from.
+//
+// @return
+//  The shaded grid or null if there is no such grid in the cache.
+*/
+std::shared_ptr<GridCache::Entry> GridCache::acquire( int primitive, const math::vec2& u_range, const math::vec2& v_range )
+{
+    lock_guard<mutex> lock( mutex_ );
+    map<Key, shared_ptr<Entry>>::iterator i = entries_.find( make_tuple(primitive, u_range.x, u_range.y, v_range.x, v_range.y) );
+    if ( i != entries_.end() )
+    {
+        shared_ptr<Entry> entry = i->second;
+        REYES_ASSERT( entry );
+        REYES_ASSERT( entry->references_ > 0 );
+        --entry->references_;
+        if ( entry->references_ <= 0 )
+        {
+            entries_.erase( i );
+        }
+        return entry;
+    }
+    return shared_ptr<Entry>();
+}
+
+/**
+// Insert a shaded grid for the buckets that it overlaps that haven't been
+// rendered yet.
+//
+// @param primitive
+//  The index of the primitive that the grid was split from.
+//
+// @param u_range, v_range
+//  The parametric range of the split geometry that the grid was diced from.
+//
+// @param grid
+//  The diced and shaded grid.
+//
+// @param outputs
+//  The values of the output variables copied from the grid by the sampler
+//  (empty when there are no output variables).
+//
+// @param references
+//  The number of buckets that are still to sample the grid.
+//
+// @param last_bucket
+//  The index of the last bucket that the grid overlaps.
+*/
+void GridCache::insert( int primitive, const math::vec2& u_range, const math::vec2& v_range, const Grid& grid, const std::vector<float>& outputs, int references, int last_bucket )
+{
+    REYES_ASSERT( references > 0 );
+    REYES_ASSERT( last_bucket >= 0 );
+
+    const int size = grid.size();
+    const vec3* positions = grid.vec3_value( "P" );
+    const vec3* colors = grid.vec3_value( "Ci" );
+    const vec3* opacities = grid.vec3_value( "Oi" );
+    REYES_ASSERT( positions );
+
+    shared_ptr<Entry> entry( new Entry );
+    entry->width_ = grid.width();
+    entry->height_ = grid.height();
+    entry->positions_.assign( positions, positions + size );
+    if ( colors && opacities )
+    {
+        entry->colors_.assign( colors, colors + size );
+        entry->opacities_.assign( opacities, opacities + size );
+    }
+    entry->outputs_ = outputs;
+    entry->references_ = references;
+    entry->last_bucket_ = last_bucket;
+
+    const Key key = make_tuple( primitive, u_range.x, u_range.y, v_range.x, v_range.y );
+    lock_guard<mutex> lock( mutex_ );
+    map<Key, shared_ptr<Entry>>::iterator i = entries_.find( key );
+    if ( i != entries_.end() )
+    {
+        --i->second->references_;
+        if ( i->second->references_ <= 0 )
+        {
+            entries_.erase( i );
+        }
+        return;
+    }
+    entries_.insert( make_pair(key, entry) );
+    expiries_.insert( make_pair(last_bucket, key) );
+}
+
+/**
+// Release the grids that only overlap buckets that have finished.
+//
+// Buckets may finish out of order when they are rendered concurrently.  
+// Grids are released once all of the buckets up to and including the last
+// bucket that they overlap have finished.
+//
+// @param bucket
+//  The index of the bucket that has finished rendering.
+*/
+void GridCache::finish_bucket( int bucket )
+{
+    REYES_ASSERT( bucket >= 0 );
+    lock_guard<mutex> lock( mutex_ );
+    if ( bucket >= int(finished_buckets_.size()) )
+    {
+        finished_buckets_.resize( max(bucket + 1, 2 * int(finished_buckets_.size())), false );
+    }
+    finished_buckets_[bucket] = true;
+    while ( unfinished_bucket_ < int(finished_buckets_.size()) && finished_buckets_[unfinished_bucket_] )
+    {
+        ++unfinished_bucket_;
+    }
+
+    multimap<int, Key>::iterator i = expiries_.begin();
+    while ( i != expiries_.end() && i->first < unfinished_bucket_ )
+    {
+        map<Key, shared_ptr<Entry>>::iterator entry = entries_.find( i->second );
+        if ( entry != entries_.end() && entry->second->last_bucket_ == i->first )
+        {
+            entries_.erase( entry );
+        }
+        i = expiries_.erase( i );
+    }
+}
+
+/**
+// Release all of the grids in the cache.
+*/
+void GridCache::clear()
+{
+    lock_guard<mutex> lock( mutex_ );
+    entries_.clear();
+    expiries_.clear();
+    finished_buckets_.clear();
+    unfinished_bucket_ = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <math/vec2.hpp>
+#include <math/vec3.hpp>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace reyes
+{
+
+class Grid;
+
+/**
+// Shaded grids kept for the buckets that they overlap but haven't been
+// rendered yet.
+//
+// When rendering in buckets the same piece of split geometry is reached from
+// every bucket that it overlaps.  Keeping the positions, colors, and
+// opacities of a shaded grid until it has been sampled into every bucket it
+// overlaps means each grid is diced and shaded once no matter how many 
+// buckets it overlaps.  Shading is deterministic so whether a grid is shaded
+// or found in the cache doesn't change the rendered image.
+//
+// The cache is shared by the threads that render buckets concurrently so 
+// two buckets may both miss and shade the same grid.  The second insertion 
+// only releases the reference held for the bucket that inserted it.
+//
+// Buckets can cull a grid before reaching it so a grid isn't always acquired
+// by every bucket that it was inserted for.  Grids are also released once 
+// every bucket up to and including the last bucket that they overlap has 
+// finished so that the cache only holds grids near the buckets that are 
+// still being rendered.
+*/
+class GridCache
+{
+public:
+    struct Entry
+    {
+        int width_; ///< The number of vertices across the grid.
+        int height_; ///< The number of vertices down the grid.
+        std::vector<math::vec3> positions_; ///< The camera space positions ("P").
+        std::vector<math::vec3> colors_; ///< The colors ("Ci").
+        std::vector<math::vec3> opacities_; ///< The opacities ("Oi").
+        std::vector<float> outputs_; ///< The values of the output variables (see Sampler::copy_outputs()).
+        int references_; ///< The number of buckets yet to sample this grid.
+        int last_bucket_; ///< The index of the last bucket that this grid overlaps.
+    };
+
+private:
+    typedef std::tuple<int, float, float, float, float> Key;
+    std::mutex mutex_; ///< Locks the cached grids.
+    std::map<Key, std::shared_ptr<Entry>> entries_; ///< The cached grids by primitive and parametric range.
+    std::multimap<int, Key> expiries_; ///< The keys of the cached grids by the last bucket that they overlap.
+    std::vector<bool> finished_buckets_; ///< True for each bucket that has finished rendering.
+    int unfinished_bucket_; ///< The lowest indexed bucket that hasn't finished rendering.
+
+public:
+    GridCache();
+    std::shared_ptr<Entry> acquire( int primitive, const math::vec2& u_range, const math::vec2& v_range );
+    void insert( int primitive, const math::vec2& u_range, const math::vec2& v_range, const Grid& grid, const std::vector<float>& outputs, int references, int last_bucket );
+    void finish_bucket( int bucket );
+    void clear();
+};
+
+}
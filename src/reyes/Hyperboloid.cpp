@@ -5,6 +5,7 @@
 
 #include "Hyperboloid.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -16,9 +17,7 @@
 
 using std::min;
 using std::max;
-using std::list;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -38,32 +37,52 @@ Hyperboloid::Hyperboloid( const Hyperboloid& hyperboloid, const math::vec2& u_ra
 {   
 }
 
+Geometry* Hyperboloid::clone() const
+{
+    return new Hyperboloid( *this );
+}
+
 bool Hyperboloid::boundable() const
 {
     return true;
 }
 
-void Hyperboloid::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* grid ) const
+void Hyperboloid::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
+
+    // The line from point1 to point2 is swept around the z axis so the 
+    // distance from the z axis ranges from the nearest point on the line to 
+    // the farthest end and the angle is widened by the angle that the line 
+    // subtends at the z axis.
+    const float PI = float(M_PI);
+    const vec2& u_range = Geometry::u_range();
+    const vec2& v_range = Geometry::v_range();
+    vec3 p0 = lerp( point1_, point2_, v_range.x );
+    vec3 p1 = lerp( point1_, point2_, v_range.y );
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+    float length_squared = dx * dx + dy * dy;
+    float t = length_squared > 0.0f ? min( max(-(p0.x * dx + p0.y * dy) / length_squared, 0.0f), 1.0f ) : 0.0f;
+    float nearest_x = p0.x + dx * t;
+    float nearest_y = p0.y + dy * t;
+    vec2 radius_range( 
+        sqrtf(nearest_x * nearest_x + nearest_y * nearest_y), 
+        max(sqrtf(p0.x * p0.x + p0.y * p0.y), sqrtf(p1.x * p1.x + p1.y * p1.y))
+    );
+
+    vec2 angle_range( 0.0f, 2.0f * PI );
+    if ( radius_range.x > 0.0f )
     {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
+        float alpha0 = atan2f( p0.y, p0.x );
+        float alpha1 = atan2f( p1.y, p1.x );
+        float sweep = alpha1 - alpha0;
+        sweep = sweep > PI ? sweep - 2.0f * PI : sweep < -PI ? sweep + 2.0f * PI : sweep;
+        vec2 theta_range = ordered( u_range.x * thetamax_, u_range.y * thetamax_ );
+        angle_range = vec2( theta_range.x + min(alpha0, alpha0 + sweep), theta_range.y + max(alpha0, alpha0 + sweep) );
     }
+    bound_revolution( transform, radius_range, angle_range, ordered(p0.z, p1.z), minimum, maximum );
 }
 
 bool Hyperboloid::splittable() const
@@ -71,9 +90,9 @@ bool Hyperboloid::splittable() const
     return true;
 }
 
-void Hyperboloid::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
+void Hyperboloid::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -87,15 +106,10 @@ void Hyperboloid::split( std::list<std::shared_ptr<Geometry>>* primitives ) cons
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> hyperboloid;
-    hyperboloid.reset( new Hyperboloid(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( hyperboloid );
-    hyperboloid.reset( new Hyperboloid(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( hyperboloid );
-    hyperboloid.reset( new Hyperboloid(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( hyperboloid );
-    hyperboloid.reset( new Hyperboloid(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( hyperboloid );
+    split_stack->emplace<Hyperboloid>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<Hyperboloid>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<Hyperboloid>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<Hyperboloid>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool Hyperboloid::diceable() const
@@ -4,8 +4,6 @@
 #include <math/vec2.hpp>
 #include <math/vec3.hpp>
 #include <math/mat4x4.hpp>
-#include <list>
-#include <memory>
 
 namespace reyes
 {
@@ -22,10 +20,11 @@ public:
     Hyperboloid( const math::vec3& point1, const math::vec3& point2, float thetamax );
     Hyperboloid( const Hyperboloid& hyperboloid, const math::vec2& u_range, const math::vec2& v_range );
 
+    Geometry* clone() const override;
     bool boundable() const override;
     void bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const override;
     bool splittable() const override;
-    void split( std::list<std::shared_ptr<Geometry>>* primitives ) const override;
+    void split( SplitStack* split_stack ) const override;
     bool diceable() const override;
     void dice( const math::mat4x4& transform, int width, int height, Grid* grid ) const override;
 
@@ -8,6 +8,7 @@
 #include "ImageBufferFormat.hpp"
 #include "ErrorCode.hpp"
 #include "ErrorPolicy.hpp"
+#include "BlueNoise.hpp"
 #include <math/scalar.ipp>
 #include "assert.hpp"
 #include <libpng/png.h>
@@ -17,10 +18,55 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 using namespace math;
 using namespace reyes;
 
+// Convert a float to a 16 bit half float rounding to the nearest even 
+// value.  Values too large for a half float become infinity and values too
+// small become denormals or zero.
+static uint16_t half_from_float( float value )
+{
+    uint32_t bits;
+    memcpy( &bits, &value, sizeof(bits) );
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t magnitude = bits & 0x7fffffffu;
+    if ( magnitude >= 0x7f800000u )
+    {
+        return uint16_t(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x0200u : 0u));
+    }
+    if ( magnitude >= 0x477ff000u )
+    {
+        return uint16_t(sign | 0x7c00u);
+    }
+    if ( magnitude < 0x38800000u )
+    {
+        if ( magnitude <= 0x33000000u )
+        {
+            return uint16_t(sign);
+        }
+        const uint32_t mantissa = (magnitude & 0x007fffffu) | 0x00800000u;
+        const uint32_t shift = 126u - (magnitude >> 23);
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        uint32_t half = mantissa >> shift;
+        if ( remainder > halfway || (remainder == halfway && (half & 1u)) )
+        {
+            ++half;
+        }
+        return uint16_t(sign | half);
+    }
+
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    const uint32_t remainder = magnitude & 0x1fffu;
+    if ( remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)) )
+    {
+        ++half;
+    }
+    return uint16_t(sign | half);
+}
+
 ImageBuffer::ImageBuffer()
 : width_( 0 )
 , height_( 0 )
@@ -198,13 +244,20 @@ void ImageBuffer::quantize( const ImageBuffer& image_buffer, float one, int mini
     maximum = clamp( maximum, 0, 255 );
 
     reset( image_buffer.width_, image_buffer.height_, image_buffer.elements_, FORMAT_U8 );
+    const BlueNoise& blue_noise = BlueNoise::pattern();
     unsigned char* quantized_pixels = u8_data();
     const float* pixels = image_buffer.f32_data();
-    int size = width_ * height_ * elements_;
-    for ( int i = 0; i < size; ++i )
+    for ( int y = 0; y < height_; ++y )
     {
-        quantized_pixels[i] = clamp( int(math::round(one * pixels[i] + dither * (float(rand()) / (RAND_MAX / 2) - 1.0f))), minimum, maximum );
-    }    
+        for ( int x = 0; x < width_; ++x )
+        {
+            const float* noise = blue_noise.values( x, y );
+            for ( int element = 0; element < elements_; ++element, ++pixels, ++quantized_pixels )
+            {
+                *quantized_pixels = clamp( int(math::round(one * *pixels + dither * noise[element % 4])), minimum, maximum );
+            }
+        }
+    }
 }
 
 void ImageBuffer::load( const char* filename, ErrorPolicy* error_policy )
@@ -512,6 +565,7 @@ void ImageBuffer::save_png( const char* filename, ErrorPolicy* error_policy ) co
         {
             png_write_row( guard.png_write, &data[y * width_ * elements_] );
         }
+        png_write_end( guard.png_write, nullptr );
     }
     else
     {
@@ -522,6 +576,97 @@ void ImageBuffer::save_png( const char* filename, ErrorPolicy* error_policy ) co
     }
 }
 
+/**
+// Save this image buffer to a self-contained tiled file of 16 or 32 bit 
+// floats.
+//
+// The file starts with a header of 32 bit integers in native byte order, as
+// written by ImageBuffer::save(): the characters 'RTIL', the version (1), 
+// the width and height of the image, the width and height of each tile, 
+// the number of channels, and the size of each element in bytes (2 for half
+// floats or 4 for floats).  Each channel's name follows as a 32 bit length
+// and that many characters.  Tiles follow in scanline order with each tile
+// storing its pixels in scanline order and each pixel's channels 
+// interleaved.  Tiles on the right and bottom edges are cropped to the 
+// image so that every tile's offset can be calculated from the header.
+//
+// @param filename
+//  The name of the file to save to (assumed not null).
+//
+// @param channels
+//  The name of each element in the pixels of this image buffer.
+//
+// @param half
+//  True to store elements as 16 bit half floats or false to store them as 
+//  32 bit floats.
+//
+// @param error_policy
+//  The error policy to report errors to (null to ignore errors).
+*/
+void ImageBuffer::save_tiled( const char* filename, const std::vector<std::string>& channels, bool half, ErrorPolicy* error_policy ) const
+{
+    REYES_ASSERT( filename );
+    REYES_ASSERT( format_ == FORMAT_F32 );
+    REYES_ASSERT( int(channels.size()) == elements_ );
+
+    FILE* file = fopen( filename, "wb" );
+    if ( !file )
+    {
+        if ( error_policy )
+        {
+            error_policy->error( RENDER_ERROR_OPENING_FILE_FAILED, "Opening '%s' to write a tiled image failed", filename );
+        }
+        return;
+    }
+
+    const int TILE_SIZE = 64;
+    const int element_size = half ? int(sizeof(uint16_t)) : int(sizeof(float));
+    const int header [] = { 0x4c495452, 1, width_, height_, TILE_SIZE, TILE_SIZE, elements_, element_size };
+    fwrite( header, sizeof(header), 1, file );
+    for ( const std::string& channel : channels )
+    {
+        const int length = int(channel.size());
+        fwrite( &length, sizeof(length), 1, file );
+        fwrite( channel.c_str(), 1, length, file );
+    }
+
+    std::vector<unsigned char> tile( TILE_SIZE * TILE_SIZE * elements_ * element_size );
+    for ( int tile_y = 0; tile_y < height_; tile_y += TILE_SIZE )
+    {
+        const int tile_height = std::min( TILE_SIZE, height_ - tile_y );
+        for ( int tile_x = 0; tile_x < width_; tile_x += TILE_SIZE )
+        {
+            const int tile_width = std::min( TILE_SIZE, width_ - tile_x );
+            const int row_elements = tile_width * elements_;
+            unsigned char* data = &tile[0];
+            for ( int y = tile_y; y < tile_y + tile_height; ++y )
+            {
+                const float* pixels = f32_data( tile_x, y );
+                if ( half )
+                {
+                    uint16_t* halves = reinterpret_cast<uint16_t*>( data );
+                    for ( int i = 0; i < row_elements; ++i )
+                    {
+                        halves[i] = half_from_float( pixels[i] );
+                    }
+                }
+                else
+                {
+                    memcpy( data, pixels, row_elements * sizeof(float) );
+                }
+                data += row_elements * element_size;
+            }
+            fwrite( &tile[0], 1, data - &tile[0], file );
+        }
+    }
+
+    const bool write_failed = ferror( file ) != 0;
+    if ( (fclose(file) != 0 || write_failed) && error_policy )
+    {
+        error_policy->error( RENDER_ERROR_WRITING_FILE_FAILED, "Writing a tiled image to '%s' failed", filename );
+    }
+}
+
 void ImageBuffer::load_jpeg( const char* filename, ErrorPolicy* error_policy )
 {
     REYES_ASSERT( filename );
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <math/vec4.hpp>
+#include <string>
+#include <vector>
 
 namespace reyes
 {
@@ -51,6 +53,7 @@ class ImageBuffer
         
         void load_png( const char* filename, ErrorPolicy* error_policy = nullptr );
         void save_png( const char* filename, ErrorPolicy* error_policy = nullptr ) const;
+        void save_tiled( const char* filename, const std::vector<std::string>& channels, bool half, ErrorPolicy* error_policy = nullptr ) const;
         
         void load_jpeg( const char* filename, ErrorPolicy* error_policy = nullptr );
 };
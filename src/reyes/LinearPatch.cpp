@@ -5,6 +5,7 @@
 
 #include "LinearPatch.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -18,7 +19,6 @@
 using std::min;
 using std::max;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -45,32 +45,33 @@ LinearPatch::LinearPatch( const LinearPatch& patch, const math::vec2& u_range, c
     memcpy( texture_coordinates_, patch.texture_coordinates_, sizeof(texture_coordinates_) );
 }
 
+Geometry* LinearPatch::clone() const
+{
+    return new LinearPatch( *this );
+}
+
 bool LinearPatch::boundable() const
 {
     return true;
 }
 
-void LinearPatch::bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* grid ) const
+void LinearPatch::bound( const math::mat4x4& transform, math::vec3* minimum, math::vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
+
+    // A bilinear patch lies within the convex hull of its corners and each
+    // piece split from it is itself bilinear.
+    const vec2& u_range = Geometry::u_range();
+    const vec2& v_range = Geometry::v_range();
+    const vec3 corners [4] = 
     {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
-    }
+        bilerp( positions_, u_range.x, v_range.x ),
+        bilerp( positions_, u_range.y, v_range.x ),
+        bilerp( positions_, u_range.x, v_range.y ),
+        bilerp( positions_, u_range.y, v_range.y )
+    };
+    bound_points( transform, corners, 4, minimum, maximum );
 }
 
 bool LinearPatch::splittable() const
@@ -78,9 +79,9 @@ bool LinearPatch::splittable() const
     return true;
 }
 
-void LinearPatch::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
+void LinearPatch::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -94,15 +95,10 @@ void LinearPatch::split( std::list<std::shared_ptr<Geometry>>* primitives ) cons
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> linear_patch;
-    linear_patch.reset( new LinearPatch(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( linear_patch );
-    linear_patch.reset( new LinearPatch(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( linear_patch );
-    linear_patch.reset( new LinearPatch(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( linear_patch );
-    linear_patch.reset( new LinearPatch(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( linear_patch );
+    split_stack->emplace<LinearPatch>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<LinearPatch>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<LinearPatch>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<LinearPatch>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool LinearPatch::diceable() const
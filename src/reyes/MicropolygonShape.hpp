@@ -0,0 +1,20 @@
+#pragma once
+
+namespace reyes
+{
+
+/**
+// The shape that each quad of a diced grid is sampled as.
+//
+// Quads are sampled once each and interpolate across the whole quad 
+// rather than across two triangles that meet along a diagonal.  Grids that
+// are moving or out of focus are always sampled as triangles.
+*/
+enum MicropolygonShape
+{
+    MICROPOLYGON_SHAPE_TRIANGLES, ///< Each quad is split into two triangles.
+    MICROPOLYGON_SHAPE_QUADS, ///< Each quad is sampled as a bilinear patch.
+    MICROPOLYGON_SHAPE_COUNT
+};
+
+}
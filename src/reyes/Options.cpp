@@ -10,6 +10,7 @@
 #include <math/scalar.ipp>
 #include "assert.hpp"
 #include <algorithm>
+#include <float.h>
 
 using std::max;
 using namespace math;
@@ -25,8 +26,13 @@ Options::Options()
 , view_transform_()
 , near_clip_distance_( 1.0f )
 , far_clip_distance_( 100.0f )
+, f_stop_( FLT_MAX )
+, focal_length_( 1.0f )
+, focal_distance_( 1.0f )
 , horizontal_sampling_rate_( 2.0f )
 , vertical_sampling_rate_( 2.0f )
+, sample_pattern_( SAMPLE_PATTERN_REGULAR )
+, micropolygon_shape_( MICROPOLYGON_SHAPE_TRIANGLES )
 , gain_( 1.0f )
 , gamma_( 1.0f )
 , one_( 255.0f )
@@ -36,6 +42,16 @@ Options::Options()
 , filter_function_( &Options::box_filter )
 , filter_width_( 1.0f )
 , filter_height_( 1.0f )
+, bucket_width_( 0 )
+, bucket_height_( 0 )
+, threads_( 1 )
+, occlusion_culling_( false )
+, grid_cache_( true )
+, maximum_vertices_( 64 * 64 )
+, opacity_threshold_( 0.996f )
+, maximum_visible_points_( 16 )
+, output_variables_()
+, output_types_()
 {
 #ifdef BUILD_VARIANT_DEBUG
     horizontal_resolution_ = 32;
@@ -88,6 +104,26 @@ float Options::far_clip_distance() const
     return far_clip_distance_;
 }
 
+float Options::f_stop() const
+{
+    return f_stop_;
+}
+
+float Options::focal_length() const
+{
+    return focal_length_;
+}
+
+float Options::focal_distance() const
+{
+    return focal_distance_;
+}
+
+float Options::lens_radius() const
+{
+    return f_stop_ < FLT_MAX ? 0.5f * focal_length_ / f_stop_ : 0.0f;
+}
+
 float Options::horizontal_sampling_rate() const
 {
     return horizontal_sampling_rate_;
@@ -98,6 +134,16 @@ float Options::vertical_sampling_rate() const
     return vertical_sampling_rate_;
 }
 
+SamplePattern Options::sample_pattern() const
+{
+    return sample_pattern_;
+}
+
+MicropolygonShape Options::micropolygon_shape() const
+{
+    return micropolygon_shape_;
+}
+
 float Options::gain() const
 {
     return gain_;
@@ -133,6 +179,17 @@ Options::FilterFunction Options::filter_function() const
     return filter_function_;
 }
 
+bool Options::separable_filter() const
+{
+    // The box, triangle, and sinc filters are each the product of a function
+    // of x and a function of y.
+    return 
+        filter_function_ == &Options::box_filter ||
+        filter_function_ == &Options::triangle_filter ||
+        filter_function_ == &Options::sinc_filter
+    ;
+}
+
 float Options::filter_width() const
 {
     return filter_width_;
@@ -143,6 +200,83 @@ float Options::filter_height() const
     return filter_height_;
 }
 
+int Options::bucket_width() const
+{
+    return bucket_width_;
+}
+
+int Options::bucket_height() const
+{
+    return bucket_height_;
+}
+
+bool Options::bucketed() const
+{
+    return bucket_width_ > 0 && bucket_height_ > 0;
+}
+
+int Options::threads() const
+{
+    return threads_;
+}
+
+bool Options::occlusion_culling() const
+{
+    return occlusion_culling_;
+}
+
+bool Options::grid_cache() const
+{
+    return grid_cache_;
+}
+
+int Options::maximum_vertices() const
+{
+    return maximum_vertices_;
+}
+
+float Options::opacity_threshold() const
+{
+    return opacity_threshold_;
+}
+
+int Options::maximum_visible_points() const
+{
+    return maximum_visible_points_;
+}
+
+int Options::output_variables() const
+{
+    return int(output_variables_.size());
+}
+
+const std::string& Options::output_variable( int index ) const
+{
+    REYES_ASSERT( index >= 0 && index < int(output_variables_.size()) );
+    return output_variables_[index];
+}
+
+ValueType Options::output_type( int index ) const
+{
+    REYES_ASSERT( index >= 0 && index < int(output_types_.size()) );
+    return output_types_[index];
+}
+
+int Options::output_variable_elements( int index ) const
+{
+    return output_type( index ) == TYPE_FLOAT ? 1 : 3;
+}
+
+int Options::output_elements() const
+{
+    int elements = 0;
+    for ( int i = 0; i < output_variables(); ++i )
+    {
+        elements += output_variable_elements( i );
+    }
+    return elements;
+}
+
 void Options::set_resolution( int horizontal_resolution, int vertical_resolution, float pixel_aspect_ratio )
 {
     REYES_ASSERT( horizontal_resolution > 1 );
@@ -201,6 +335,24 @@ void Options::set_far_clip_distance( float far_clip_distance )
     far_clip_distance_ = far_clip_distance;
 }
 
+void Options::set_f_stop( float f_stop )
+{
+    REYES_ASSERT( f_stop > 0.0f );
+    f_stop_ = f_stop;
+}
+
+void Options::set_focal_length( float focal_length )
+{
+    REYES_ASSERT( focal_length > 0.0f );
+    focal_length_ = focal_length;
+}
+
+void Options::set_focal_distance( float focal_distance )
+{
+    REYES_ASSERT( focal_distance > 0.0f );
+    focal_distance_ = focal_distance;
+}
+
 void Options::set_horizontal_sampling_rate( float horizontal_sampling_rate )
 {
     horizontal_sampling_rate_ = horizontal_sampling_rate;
@@ -211,6 +363,18 @@ void Options::set_vertical_sampling_rate( float vertical_sampling_rate )
     vertical_sampling_rate_ = vertical_sampling_rate;
 }
 
+void Options::set_sample_pattern( SamplePattern sample_pattern )
+{
+    REYES_ASSERT( sample_pattern >= SAMPLE_PATTERN_REGULAR && sample_pattern < SAMPLE_PATTERN_COUNT );
+    sample_pattern_ = sample_pattern;
+}
+
+void Options::set_micropolygon_shape( MicropolygonShape micropolygon_shape )
+{
+    REYES_ASSERT( micropolygon_shape >= MICROPOLYGON_SHAPE_TRIANGLES && micropolygon_shape < MICROPOLYGON_SHAPE_COUNT );
+    micropolygon_shape_ = micropolygon_shape;
+}
+
 void Options::set_gain( float gain )
 {
     gain_ = gain;
@@ -251,6 +415,62 @@ void Options::set_filter( FilterFunction function, float width, float height )
     filter_height_ = max( 1.0f, height );
 }
 
+void Options::set_bucket_size( int bucket_width, int bucket_height )
+{
+    REYES_ASSERT( bucket_width >= 0 );
+    REYES_ASSERT( bucket_height >= 0 );
+    bucket_width_ = max( 0, bucket_width );
+    bucket_height_ = max( 0, bucket_height );
+}
+
+void Options::set_threads( int threads )
+{
+    REYES_ASSERT( threads >= 1 );
+    threads_ = max( 1, threads );
+}
+
+void Options::set_occlusion_culling( bool occlusion_culling )
+{
+    occlusion_culling_ = occlusion_culling;
+}
+
+void Options::set_grid_cache( bool grid_cache )
+{
+    grid_cache_ = grid_cache;
+}
+
+void Options::set_maximum_vertices( int maximum_vertices )
+{
+    REYES_ASSERT( maximum_vertices >= 4 );
+    maximum_vertices_ = max( 4, maximum_vertices );
+}
+
+void Options::set_opacity_threshold( float opacity_threshold )
+{
+    REYES_ASSERT( opacity_threshold > 0.0f && opacity_threshold <= 1.0f );
+    opacity_threshold_ = clamp( opacity_threshold, 0.001f, 1.0f );
+}
+
+void Options::set_maximum_visible_points( int maximum_visible_points )
+{
+    REYES_ASSERT( maximum_visible_points >= 1 );
+    maximum_visible_points_ = max( 1, maximum_visible_points );
+}
+
+void Options::add_output_variable( const char* identifier, ValueType type )
+{
+    REYES_ASSERT( identifier );
+    REYES_ASSERT( type == TYPE_FLOAT || type == TYPE_COLOR || type == TYPE_POINT || type == TYPE_VECTOR || type == TYPE_NORMAL );
+    output_variables_.push_back( identifier );
+    output_types_.push_back( type );
+}
+
+void Options::clear_output_variables()
+{
+    output_variables_.clear();
+    output_types_.clear();
+}
+
 float Options::box_filter( float /*x*/, float /*y*/, float /*width*/, float /*height*/ )
 {
     return 1.0f;
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "SamplePattern.hpp"
+#include "MicropolygonShape.hpp"
+#include "ValueType.hpp"
 #include <math/vec4.hpp>
 #include <math/mat4x4.hpp>
 #include <string>
+#include <vector>
 
 namespace reyes
 {
@@ -25,8 +29,13 @@ private:
     math::mat4x4 view_transform_; ///< The view transform.
     float near_clip_distance_; ///< The distance from the camera to the near plane.
     float far_clip_distance_; ///< The distance from the camera to the far plane.
+    float f_stop_; ///< The f-stop of the camera's lens or FLT_MAX for a pinhole camera with no depth of field.
+    float focal_length_; ///< The focal length of the camera's lens.
+    float focal_distance_; ///< The distance from the camera to the plane that is in focus.
     float horizontal_sampling_rate_; ///< The number of samples across each pixel.
     float vertical_sampling_rate_; ///< The number of samples down each pixel.
+    SamplePattern sample_pattern_; ///< The pattern that samples are placed in within each pixel.
+    MicropolygonShape micropolygon_shape_; ///< The shape that each quad of a diced grid is sampled as.
     float gain_; ///< The gain value to use when exposing the final image.
     float gamma_; ///< The gamma value to use when exposing the final image.
     float one_; ///< The one value to use when exposing the final image.
@@ -36,6 +45,16 @@ private:
     FilterFunction filter_function_; ///< The filter function to use.
     float filter_width_; ///< The width of the filter (in pixels).
     float filter_height_; ///< The height of the filter (in pixels).
+    int bucket_width_; ///< The width of each bucket (in pixels) or 0 to sample the whole frame at once.
+    int bucket_height_; ///< The height of each bucket (in pixels) or 0 to sample the whole frame at once.
+    int threads_; ///< The number of threads to render buckets with.
+    bool occlusion_culling_; ///< True to cull geometry and skip shading grids that are hidden by geometry already sampled.
+    bool grid_cache_; ///< True to keep shaded grids for the buckets that they overlap instead of dicing and shading them again.
+    int maximum_vertices_; ///< The maximum number of vertices in a diced grid.
+    float opacity_threshold_; ///< The accumulated opacity at which a sample is treated as opaque.
+    int maximum_visible_points_; ///< The maximum number of semi-transparent points kept at each sample.
+    std::vector<std::string> output_variables_; ///< The identifiers of the shader variables sampled and filtered into extra output channels.
+    std::vector<ValueType> output_types_; ///< The type of each output variable.
 
 public:
     Options();
@@ -49,8 +68,14 @@ public:
     const math::mat4x4& view_transform() const;
     float near_clip_distance() const;
     float far_clip_distance() const;
+    float f_stop() const;
+    float focal_length() const;
+    float focal_distance() const;
+    float lens_radius() const;
     float horizontal_sampling_rate() const;
     float vertical_sampling_rate() const;
+    SamplePattern sample_pattern() const;
+    MicropolygonShape micropolygon_shape() const;
     float gain() const;
     float gamma() const;
     float one() const;
@@ -58,8 +83,23 @@ public:
     int minimum() const;
     int maximum() const;
     FilterFunction filter_function() const;
+    bool separable_filter() const;
     float filter_width() const;
     float filter_height() const;
+    int bucket_width() const;
+    int bucket_height() const;
+    bool bucketed() const;
+    int threads() const;
+    bool occlusion_culling() const;
+    bool grid_cache() const;
+    int maximum_vertices() const;
+    float opacity_threshold() const;
+    int maximum_visible_points() const;
+    int output_variables() const;
+    const std::string& output_variable( int index ) const;
+    ValueType output_type( int index ) const;
+    int output_variable_elements( int index ) const;
+    int output_elements() const;
 
     void set_resolution( int horizontal_resolution, int vertical_resolution, float pixel_aspect_ratio );
     void set_crop_window( const math::vec4& crop_window );
@@ -69,8 +109,12 @@ public:
     void set_near_clip_distance( float near_clip_distance );
     void set_far_clip_distance( float far_clip_distance );
     void set_f_stop( float f_stop );
+    void set_focal_length( float focal_length );
+    void set_focal_distance( float focal_distance );
     void set_horizontal_sampling_rate( float horizontal_sampling_rate );
     void set_vertical_sampling_rate( float vertical_sampling_rate );
+    void set_sample_pattern( SamplePattern sample_pattern );
+    void set_micropolygon_shape( MicropolygonShape micropolygon_shape );
     void set_gain( float gain );
     void set_gamma( float gamma );
     void set_one( float one );
@@ -78,6 +122,15 @@ public:
     void set_minimum( int minimum );
     void set_maximum( int maximum );
     void set_filter( FilterFunction function, float width, float height );
+    void set_bucket_size( int bucket_width, int bucket_height );
+    void set_threads( int threads );
+    void set_occlusion_culling( bool occlusion_culling );
+    void set_grid_cache( bool grid_cache );
+    void set_maximum_vertices( int maximum_vertices );
+    void set_opacity_threshold( float opacity_threshold );
+    void set_maximum_visible_points( int maximum_visible_points );
+    void add_output_variable( const char* identifier, ValueType type );
+    void clear_output_variables();
 
     static float box_filter( float x, float y, float width, float height );
     static float triangle_filter( float x, float y, float width, float height );
@@ -5,6 +5,7 @@
 
 #include "Paraboloid.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -16,9 +17,7 @@
 
 using std::min;
 using std::max;
-using std::list;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -40,32 +39,27 @@ Paraboloid::Paraboloid( const Paraboloid& paraboloid, const math::vec2& u_range,
 {   
 }
 
+Geometry* Paraboloid::clone() const
+{
+    return new Paraboloid( *this );
+}
+
 bool Paraboloid::boundable() const
 {
     return true;
 }
 
-void Paraboloid::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* grid ) const
+void Paraboloid::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
-    {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
-    }
+
+    const vec2& u_range = Geometry::u_range();
+    const vec2& v_range = Geometry::v_range();
+    float z0 = v_range.x * (zmax_ - zmin_);
+    float z1 = v_range.y * (zmax_ - zmin_);
+    vec2 radius_range = ordered( rmax_ * sqrtf(z0 / zmax_), rmax_ * sqrtf(z1 / zmax_) );
+    bound_revolution( transform, radius_range, vec2(u_range.x * thetamax_, u_range.y * thetamax_), ordered(z0, z1), minimum, maximum );
 }
 
 bool Paraboloid::splittable() const
@@ -73,9 +67,9 @@ bool Paraboloid::splittable() const
     return true;
 }
 
-void Paraboloid::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
+void Paraboloid::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -89,15 +83,10 @@ void Paraboloid::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> paraboloid;
-    paraboloid.reset( new Paraboloid(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( paraboloid );
-    paraboloid.reset( new Paraboloid(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( paraboloid );
-    paraboloid.reset( new Paraboloid(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( paraboloid );
-    paraboloid.reset( new Paraboloid(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( paraboloid );
+    split_stack->emplace<Paraboloid>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<Paraboloid>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<Paraboloid>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<Paraboloid>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool Paraboloid::diceable() const
@@ -0,0 +1,121 @@
+//
+// PngDisplay.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "PngDisplay.hpp"
+#include "ErrorCode.hpp"
+#include "ErrorPolicy.hpp"
+#include "assert.hpp"
+#include <libpng/png.h>
+
+using namespace reyes;
+
+PngDisplay::PngDisplay( const char* filename )
+: filename_( filename ? filename : "" )
+, file_( nullptr )
+, png_write_( nullptr )
+, png_info_( nullptr )
+{
+    REYES_ASSERT( filename );
+}
+
+PngDisplay::~PngDisplay()
+{
+    close();
+}
+
+/**
+// Open the file and write the PNG header.
+//
+// @param width, height
+//  The size of the image in pixels.
+//
+// @param elements
+//  The number of 8 bit elements in each pixel (3 or 4).
+//
+// @param error_policy
+//  The error policy to report errors to (null to ignore errors).
+*/
+void PngDisplay::begin( int width, int height, int elements, ErrorPolicy* error_policy )
+{
+    REYES_ASSERT( elements == 3 || elements == 4 );
+
+    close();
+    file_ = fopen( filename_.c_str(), "wb" );
+    if ( !file_ )
+    {
+        if ( error_policy )
+        {
+            error_policy->error( RENDER_ERROR_OPENING_FILE_FAILED, "Opening '%s' to write a PNG failed", filename_.c_str() );
+        }
+        return;
+    }
+
+    png_write_ = png_create_write_struct( PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr );
+    png_info_ = png_write_ ? png_create_info_struct( png_write_ ) : nullptr;
+    if ( !png_write_ || !png_info_ )
+    {
+        if ( error_policy )
+        {
+            error_policy->error( RENDER_ERROR_OUT_OF_MEMORY, "Allocating memory to write a PNG to '%s' failed", filename_.c_str() );
+        }
+        close();
+        return;
+    }
+
+    png_init_io( png_write_, file_ );
+    int color_type = elements == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB;
+    png_set_IHDR( png_write_, png_info_, width, height, 8, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+    png_write_info( png_write_, png_info_ );
+}
+
+/**
+// Compress and write rows of pixels.
+//
+// @param y0, y1
+//  The first and one past the last row to write.
+//
+// @param pixels
+//  The pixels in rows y0 through y1 (assumed not null).
+*/
+void PngDisplay::write( int y0, int y1, const unsigned char* pixels )
+{
+    REYES_ASSERT( pixels );
+    if ( png_write_ )
+    {
+        const size_t row_size = png_get_rowbytes( png_write_, png_info_ );
+        for ( int y = y0; y < y1; ++y, pixels += row_size )
+        {
+            png_write_row( png_write_, const_cast<unsigned char*>(pixels) );
+        }
+    }
+}
+
+/**
+// Write the end of the PNG and close the file.
+*/
+void PngDisplay::end()
+{
+    if ( png_write_ )
+    {
+        png_write_end( png_write_, nullptr );
+    }
+    close();
+}
+
+void PngDisplay::close()
+{
+    if ( png_write_ )
+    {
+        png_destroy_write_struct( &png_write_, &png_info_ );
+        png_write_ = nullptr;
+        png_info_ = nullptr;
+    }
+
+    if ( file_ )
+    {
+        fclose( file_ );
+        file_ = nullptr;
+    }
+}
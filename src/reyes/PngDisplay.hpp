@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Display.hpp"
+#include <string>
+#include <stdio.h>
+
+struct png_struct_def;
+struct png_info_def;
+
+namespace reyes
+{
+
+/**
+// A display that writes rows of the final image to a PNG file as they are
+// completed.
+*/
+class PngDisplay : public Display
+{
+    std::string filename_; ///< The name of the file to write to.
+    FILE* file_; ///< The file being written to (null when not writing).
+    png_struct_def* png_write_; ///< The libpng write structure.
+    png_info_def* png_info_; ///< The libpng info structure.
+
+public:
+    PngDisplay( const char* filename );
+    ~PngDisplay();
+    void begin( int width, int height, int elements, ErrorPolicy* error_policy ) override;
+    void write( int y0, int y1, const unsigned char* pixels ) override;
+    void end() override;
+
+private:
+    void close();
+};
+
+}
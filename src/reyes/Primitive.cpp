@@ -0,0 +1,46 @@
+//
+// Primitive.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Primitive.hpp"
+#include "Geometry.hpp"
+#include "Attributes.hpp"
+#include "assert.hpp"
+#include <math/mat4x4.ipp>
+
+using std::shared_ptr;
+using namespace math;
+using namespace reyes;
+
+Primitive::Primitive( Geometry* geometry, const std::shared_ptr<Attributes>& attributes, const math::mat4x4& transform, const math::mat4x4* motion_transform )
+: geometry_( geometry )
+, attributes_( attributes )
+, transform_( transform )
+, motion_transform_( motion_transform ? *motion_transform : transform )
+, moving_( motion_transform != nullptr )
+{
+    REYES_ASSERT( geometry_ );
+    REYES_ASSERT( attributes_ );
+}
+
+const Geometry& Primitive::geometry() const
+{
+    REYES_ASSERT( geometry_ );
+    return *geometry_;
+}
+
+const std::shared_ptr<Attributes>& Primitive::attributes() const
+{
+    return attributes_;
+}
+
+const math::mat4x4& Primitive::transform() const
+{
+    return transform_;
+}
+
+const math::mat4x4* Primitive::motion_transform() const
+{
+    return moving_ ? &motion_transform_ : nullptr;
+}
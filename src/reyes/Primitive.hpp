@@ -0,0 +1,33 @@
+#pragma once
+
+#include <math/mat4x4.hpp>
+#include <memory>
+
+namespace reyes
+{
+
+class Geometry;
+class Attributes;
+
+/**
+// A piece of geometry recorded along with the render state and transform
+// that were current when it was submitted so that it can be split, diced, 
+// shaded, and sampled later (for example once per bucket).
+*/
+class Primitive
+{
+    std::shared_ptr<Geometry> geometry_; ///< The geometry (owned by this primitive).
+    std::shared_ptr<Attributes> attributes_; ///< The attributes current when the geometry was submitted (shared with other primitives submitted with the same attributes).
+    math::mat4x4 transform_; ///< The object to camera space (or world space for primitives in a Scene) transform current when the geometry was submitted.
+    math::mat4x4 motion_transform_; ///< The same transform at shutter close (the same as the transform if the primitive doesn't move).
+    bool moving_; ///< True if the primitive moves while the shutter is open.
+
+public:
+    Primitive( Geometry* geometry, const std::shared_ptr<Attributes>& attributes, const math::mat4x4& transform, const math::mat4x4* motion_transform = nullptr );
+    const Geometry& geometry() const;
+    const std::shared_ptr<Attributes>& attributes() const;
+    const math::mat4x4& transform() const;
+    const math::mat4x4* motion_transform() const;
+};
+
+}
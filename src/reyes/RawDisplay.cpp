@@ -0,0 +1,90 @@
+//
+// RawDisplay.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "RawDisplay.hpp"
+#include "ImageBufferFormat.hpp"
+#include "ErrorCode.hpp"
+#include "ErrorPolicy.hpp"
+#include "assert.hpp"
+
+using namespace reyes;
+
+RawDisplay::RawDisplay( const char* filename )
+: filename_( filename ? filename : "" )
+, file_( nullptr )
+, row_size_( 0 )
+{
+    REYES_ASSERT( filename );
+}
+
+RawDisplay::~RawDisplay()
+{
+    end();
+}
+
+/**
+// Open the file and write the header.
+//
+// @param width, height
+//  The size of the image in pixels.
+//
+// @param elements
+//  The number of 8 bit elements in each pixel.
+//
+// @param error_policy
+//  The error policy to report errors to (null to ignore errors).
+*/
+void RawDisplay::begin( int width, int height, int elements, ErrorPolicy* error_policy )
+{
+    end();
+    file_ = fopen( filename_.c_str(), "wb" );
+    if ( !file_ )
+    {
+        if ( error_policy )
+        {
+            error_policy->error( RENDER_ERROR_OPENING_FILE_FAILED, "Opening '%s' to write an image failed", filename_.c_str() );
+        }
+        return;
+    }
+
+    const int format = FORMAT_U8;
+    row_size_ = width * elements;
+    fwrite( &width, sizeof(width), 1, file_ );
+    fwrite( &height, sizeof(height), 1, file_ );
+    fwrite( &elements, sizeof(elements), 1, file_ );
+    fwrite( &format, sizeof(format), 1, file_ );
+    fflush( file_ );
+}
+
+/**
+// Append rows of pixels.
+//
+// @param y0, y1
+//  The first and one past the last row to write.
+//
+// @param pixels
+//  The pixels in rows y0 through y1 (assumed not null).
+*/
+void RawDisplay::write( int y0, int y1, const unsigned char* pixels )
+{
+    REYES_ASSERT( pixels );
+    if ( file_ )
+    {
+        fwrite( pixels, row_size_, y1 - y0, file_ );
+        fflush( file_ );
+    }
+}
+
+/**
+// Close the file.
+*/
+void RawDisplay::end()
+{
+    if ( file_ )
+    {
+        fclose( file_ );
+        file_ = nullptr;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Display.hpp"
+#include <string>
+#include <stdio.h>
+
+namespace reyes
+{
+
+/**
+// A display that appends rows of the final image to a file in the same 
+// uncompressed format written by ImageBuffer::save() as they are completed.
+//
+// The header is written first so that a reader can follow the file as it 
+// grows and process rows before the frame finishes.
+*/
+class RawDisplay : public Display
+{
+    std::string filename_; ///< The name of the file to write to.
+    FILE* file_; ///< The file being written to (null when not writing).
+    int row_size_; ///< The number of bytes in each row.
+
+public:
+    RawDisplay( const char* filename );
+    ~RawDisplay();
+    void begin( int width, int height, int elements, ErrorPolicy* error_policy ) override;
+    void write( int y0, int y1, const unsigned char* pixels ) override;
+    void end() override;
+};
+
+}
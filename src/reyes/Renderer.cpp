@@ -26,9 +26,19 @@
 #include "VirtualMachine.hpp"
 #include "SymbolTable.hpp"
 #include "Attributes.hpp"
+#include "Primitive.hpp"
+#include "Scene.hpp"
+#include "GridCache.hpp"
+#include "SplitStack.hpp"
+#include "ThreadPool.hpp"
+#include "Worker.hpp"
+#include "Exposure.hpp"
+#include "Display.hpp"
+#include "ErrorCode.hpp"
 #include "ErrorPolicy.hpp"
 #include "DisplayMode.hpp"
 #include "ImageBufferFormat.hpp"
+#include "ValueType.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/vec4.ipp>
@@ -36,7 +46,6 @@
 #include <math/scalar.ipp>
 #include "assert.hpp"
 #include <vector>
-#include <list>
 #include <algorithm>
 #include <string.h>
 #include <stdarg.h>
@@ -47,7 +56,6 @@
 
 using std::max;
 using std::swap;
-using std::list;
 using std::map;
 using std::vector;
 using std::string;
@@ -58,7 +66,9 @@ using namespace math;
 using namespace reyes;
 
 static const int ATTRIBUTES_RESERVE = 32;
+static const int RESOLVE_ROWS = 16;
 static const char* NULL_SURFACE_SHADER = "surface null() { Ci = Cs; Oi = Os; }";
+static thread_local Worker* current_worker = nullptr;
 
 /**
 // Constructor.
@@ -69,18 +79,44 @@ Renderer::Renderer()
 , null_surface_shader_( nullptr )
 , sample_buffer_( nullptr )
 , image_buffer_( nullptr )
+, output_buffer_( nullptr )
 , sampler_( nullptr )
 , screen_transform_( math::identity() )
 , camera_transform_( math::identity() )
+, motion_transforms_( -1 )
+, motion_base_transform_( math::identity() )
 , textures_()
 , shaders_()
 , options_( nullptr )
 , attributes_()
+, snapshot_()
+, snapshot_source_( nullptr )
+, snapshot_revision_( 0 )
+, scene_( nullptr )
+, scene_snapshot_()
+, scene_snapshot_source_( nullptr )
+, scene_snapshot_revision_( 0 )
+, primitives_()
+, buckets_()
+, grid_cache_( nullptr )
+, split_stack_( nullptr )
+, thread_pool_( nullptr )
+, workers_()
+, displays_()
+, display_mutex_()
+, resolved_pixels_()
+, displayed_rows_( 0 )
+, shaded_grids_( 0 )
+, shaded_vertices_( 0 )
+, splits_( 0 )
 {
     error_policy_ = new ErrorPolicy;
     virtual_machine_ = new VirtualMachine( *this );
     null_surface_shader_ = new Shader( NULL_SURFACE_SHADER, NULL_SURFACE_SHADER + strlen(NULL_SURFACE_SHADER), error_policy() );
+    shaders_.insert( make_pair(make_pair(string(), null_surface_shader_->maximum_vertices()), null_surface_shader_) );
     options_ = new Options();
+    grid_cache_ = new GridCache();
+    split_stack_ = new SplitStack();
     attributes_.reserve( ATTRIBUTES_RESERVE );
 }
 
@@ -89,15 +125,28 @@ Renderer::Renderer()
 */
 Renderer::~Renderer()
 {
+    destroy_workers();
+
+    delete split_stack_;
+    split_stack_ = nullptr;
+
+    delete grid_cache_;
+    grid_cache_ = nullptr;
+
+    buckets_.clear();
+    primitives_.clear();
+    scene_snapshot_.reset();
+    snapshot_.reset();
     attributes_.clear();
 
-    for ( map<string, Shader*>::const_iterator i = shaders_.begin(); i != shaders_.end(); ++i )
+    for ( map<pair<string, int>, Shader*>::const_iterator i = shaders_.begin(); i != shaders_.end(); ++i )
     {
         Shader* shader = i->second;
         REYES_ASSERT( shader );
         delete shader;
     }
     shaders_.clear();
+    null_surface_shader_ = nullptr;
     
     for ( map<string, Texture*>::const_iterator i = textures_.begin(); i != textures_.end(); ++i )
     {
@@ -110,14 +159,14 @@ Renderer::~Renderer()
     delete sampler_;
     sampler_ = nullptr;
 
+    delete output_buffer_;
+    output_buffer_ = nullptr;
+
     delete image_buffer_;
     image_buffer_ = nullptr;
 
     delete sample_buffer_;
     sample_buffer_ = nullptr;
-    
-    delete null_surface_shader_;
-    null_surface_shader_ = nullptr;
 
     delete virtual_machine_;
     virtual_machine_ = nullptr;
@@ -174,6 +223,8 @@ void Renderer::push_attributes()
     REYES_ASSERT( !attributes_.empty() );
     shared_ptr<Attributes> attributes( new Attributes(*attributes_.back()) );
     attributes_.push_back( attributes );
+    snapshot_.reset();
+    scene_snapshot_.reset();
 }
 
 /**
@@ -185,6 +236,8 @@ void Renderer::pop_attributes()
     if ( attributes_.size() > 1 )
     {
         attributes_.pop_back();
+        snapshot_.reset();
+        scene_snapshot_.reset();
     }
 }
 
@@ -193,6 +246,11 @@ void Renderer::pop_attributes()
 */
 Attributes& Renderer::attributes() const
 {
+    Worker* worker = Renderer::worker();
+    if ( worker )
+    {
+        return worker->attributes();
+    }
     REYES_ASSERT( !attributes_.empty() );
     return *attributes_.back();
 }
@@ -324,6 +382,12 @@ void Renderer::begin()
         delete image_buffer_;
         image_buffer_ = nullptr;
     }
+
+    if ( output_buffer_ )
+    {
+        delete output_buffer_;
+        output_buffer_ = nullptr;
+    }
     
     if ( sampler_ )
     {
@@ -331,15 +395,70 @@ void Renderer::begin()
         sampler_ = nullptr;
     }
     
-    sample_buffer_ = new SampleBuffer( options_->horizontal_resolution(), options_->vertical_resolution(), options_->horizontal_sampling_rate(), options_->vertical_sampling_rate(), options_->filter_width(), options_->filter_height() );
+    sample_buffer_ = new SampleBuffer( options_->horizontal_resolution(), options_->vertical_resolution(), options_->horizontal_sampling_rate(), options_->vertical_sampling_rate(), options_->filter_width(), options_->filter_height(), options_->bucket_width(), options_->bucket_height(), options_->sample_pattern(), options_->opacity_threshold(), options_->maximum_visible_points(), options_->output_elements() );
+    sample_buffer_->set_filter( options_->filter_function(), options_->separable_filter() );
     image_buffer_ = new ImageBuffer( options_->horizontal_resolution(), options_->vertical_resolution(), 4, FORMAT_U8 );
-    sampler_ = new Sampler( float(sample_buffer_->width() - 1), float(sample_buffer_->height() - 1), options_->crop_window() );
+    sampler_ = new Sampler( float(sample_buffer_->width() - 1), float(sample_buffer_->height() - 1), options_->crop_window(), options_->maximum_vertices(), options_->lens_radius(), options_->focal_distance(), options_->micropolygon_shape() );
+    if ( options_->output_variables() > 0 )
+    {
+        output_buffer_ = new ImageBuffer( options_->horizontal_resolution(), options_->vertical_resolution(), 4 + options_->output_elements(), FORMAT_F32 );
+        for ( int i = 0; i < options_->output_variables(); ++i )
+        {
+            sampler_->add_output( options_->output_variable(i), options_->output_variable_elements(i) );
+        }
+    }
 
     screen_transform_ = math::identity();
     camera_transform_ = math::identity();
 
-    shared_ptr<Attributes> attributes( new Attributes(virtual_machine_) );
+    primitives_.clear();
+    buckets_.clear();
+    grid_cache_->clear();
+    destroy_workers();
+    shaded_grids_ = 0;
+    shaded_vertices_ = 0;
+    splits_ = 0;
+    if ( options_->bucketed() )
+    {
+        int columns = (options_->horizontal_resolution() + options_->bucket_width() - 1) / options_->bucket_width();
+        int rows = (options_->vertical_resolution() + options_->bucket_height() - 1) / options_->bucket_height();
+        buckets_.resize( columns * rows );
+
+        const int threads = options_->threads();
+        if ( threads > 1 )
+        {
+            thread_pool_ = new ThreadPool( threads );
+            workers_.reserve( threads );
+            for ( int i = 0; i < threads; ++i )
+            {
+                workers_.push_back( new Worker(*this, *options_) );
+            }
+        }
+    }
+    else if ( options_->threads() > 1 )
+    {
+        thread_pool_ = new ThreadPool( options_->threads() );
+        virtual_machine_->set_thread_pool( thread_pool_ );
+        sampler_->set_thread_pool( thread_pool_ );
+    }
+
+    scene_ = nullptr;
+    scene_snapshot_.reset();
+    snapshot_.reset();
     attributes_.clear();
+
+    // Shaders reserve grid memory for the largest grid that can be diced so
+    // shaders are compiled for each maximum grid size that they're used with.
+    // Shaders compiled for other sizes are kept as the attributes recorded
+    // in a scene may still refer to them.
+    null_surface_shader_ = find_shader( "" );
+    if ( !null_surface_shader_ )
+    {
+        null_surface_shader_ = new Shader( NULL_SURFACE_SHADER, NULL_SURFACE_SHADER + strlen(NULL_SURFACE_SHADER), error_policy(), options_->maximum_vertices() );
+        shaders_.insert( make_pair(make_pair(string(), options_->maximum_vertices()), null_surface_shader_) );
+    }
+
+    shared_ptr<Attributes> attributes( new Attributes(virtual_machine_) );
     attributes_.push_back( attributes );    
     attributes->set_surface_shader( null_surface_shader_, camera_transform_ );
     attributes->set_u_basis( bezier_basis() );
@@ -349,19 +468,54 @@ void Renderer::begin()
 /**
 // Mark the end of a frame.
 //
-// Clear the current attribute stack and filter, expose, and quantize the
-// sample buffer down into the image buffer.
+// Clear the current attribute stack and composite, filter, expose, and
+// quantize the sample buffer down into the image buffer.
+//
+// When rendering in buckets the primitives recorded during the frame are
+// rendered and resolved one bucket at a time first.  Buckets are rendered
+// concurrently when more than one thread has been set in the options.
+//
+// Rows are written to any displays that have been added as soon as they
+// have been completely resolved.
 */
 void Renderer::end()
 {
     REYES_ASSERT( options_ );
     
+    REYES_ASSERT( !scene_ );
+    scene_ = nullptr;
+    scene_snapshot_.reset();
     attributes_.clear();
+    snapshot_.reset();
     
-    ImageBuffer image_buffer;
-    sample_buffer_->filter( options_->filter_function(), &image_buffer );
-    image_buffer.expose( options_->gain(), options_->gamma() );
-    image_buffer_->quantize( image_buffer, options_->one(), options_->minimum(), options_->maximum(), options_->dither() );
+    const int width = options_->horizontal_resolution();
+    const int height = options_->vertical_resolution();
+    resolved_pixels_.assign( height, 0 );
+    displayed_rows_ = 0;
+    for ( vector<Display*>::const_iterator i = displays_.begin(); i != displays_.end(); ++i )
+    {
+        Display* display = *i;
+        REYES_ASSERT( display );
+        display->begin( width, height, image_buffer_->elements(), error_policy_ );
+    }
+
+    const Exposure exposure( options_->gain(), options_->gamma(), options_->one(), options_->minimum(), options_->maximum(), options_->dither() );
+    if ( options_->bucketed() )
+    {
+        render_buckets( exposure );
+    }
+    else
+    {
+        sample_buffer_->composite();
+        resolve( sample_buffer_, exposure, 0, 0, width, height );
+    }
+
+    for ( vector<Display*>::const_iterator i = displays_.begin(); i != displays_.end(); ++i )
+    {
+        Display* display = *i;
+        REYES_ASSERT( display );
+        display->end();
+    }
 }
 
 /**
@@ -402,6 +556,99 @@ void Renderer::end_world()
     pop_attributes();
 }
 
+/**
+// Mark the beginning of recording geometry into a scene.
+//
+// Geometry submitted until the matching call to Renderer::end_scene() is 
+// recorded into \e scene, along with the current attributes and transform, 
+// instead of being rendered.  The scene can then be rendered any number of
+// times, in this or later frames, by calling Renderer::render_scene().
+//
+// @param scene
+//  The scene to record geometry into (assumed not null).
+*/
+void Renderer::begin_scene( Scene* scene )
+{
+    REYES_ASSERT( scene );
+    REYES_ASSERT( !scene_ );
+    scene_ = scene;
+    scene_snapshot_.reset();
+}
+
+/**
+// Mark the end of recording geometry into a scene.
+*/
+void Renderer::end_scene()
+{
+    REYES_ASSERT( scene_ );
+    scene_ = nullptr;
+    scene_snapshot_.reset();
+}
+
+/**
+// Render the primitives recorded in a scene.
+//
+// Each primitive is rendered with the attributes recorded with it moved
+// into the camera space of the current frame, lit by the light shaders 
+// that are currently active, and able to refer to the coordinate systems 
+// that are currently defined.  Attributes shared by more than one recorded
+// primitive are copied once.
+//
+// Rendering a scene is equivalent to submitting its geometry again so it
+// must happen between Renderer::begin_world() and Renderer::end_world() and
+// the scene is rendered in buckets or not according to the current options.
+//
+// The recorded shaders reserve grid memory for the maximum grid size that 
+// was set when the scene was recorded so a scene recorded with a different
+// maximum grid size is reported as an error and isn't rendered.
+//
+// @param scene
+//  The scene to render.
+*/
+void Renderer::render_scene( const Scene& scene )
+{
+    REYES_ASSERT( !scene_ );
+
+    if ( scene.primitives() > 0 && scene.maximum_vertices() != options_->maximum_vertices() )
+    {
+        error_policy_->error( RENDER_ERROR_INCOMPATIBLE_SCENE, "Rendering a scene recorded with a maximum grid size of %d vertices with a maximum grid size of %d vertices failed", scene.maximum_vertices(), options_->maximum_vertices() );
+        return;
+    }
+
+    const Attributes& current_attributes = attributes();
+    map<const Attributes*, shared_ptr<Attributes>> copies;
+    for ( int i = 0; i < scene.primitives(); ++i )
+    {
+        const Primitive& primitive = scene.primitive( i );
+        shared_ptr<Attributes>& attributes = copies[primitive.attributes().get()];
+        if ( !attributes )
+        {
+            attributes.reset( new Attributes(*primitive.attributes()) );
+            attributes->set_virtual_machine( virtual_machine_ );
+            attributes->transform_spaces( camera_transform_ );
+            attributes->copy_coordinate_systems( current_attributes );
+            attributes->copy_light_shaders( current_attributes );
+        }
+
+        attributes_.push_back( attributes );
+        const mat4x4 transform = camera_transform_ * primitive.transform();
+        const mat4x4 motion_transform = primitive.motion_transform() ? camera_transform_ * *primitive.motion_transform() : transform;
+        const mat4x4* moving = primitive.motion_transform() ? &motion_transform : nullptr;
+        if ( options_->bucketed() )
+        {
+            record( primitive.geometry(), transform, moving );
+        }
+        else
+        {
+            add_coordinate_system( "object", transform );
+            split( primitive.geometry(), transform, moving, -1 );
+            remove_coordinate_system( "object" );
+        }
+        attributes_.pop_back();
+    }
+    snapshot_.reset();
+}
+
 /**
 // Mark the end of the projection setup.
 //
@@ -535,6 +782,34 @@ void Renderer::end_transform()
     attributes().pop_transform();
 }
 
+/**
+// Begin a motion block.
+//
+// The first transform given in a motion block sets or concatenates with the
+// current transform as usual and gives the transform at shutter open.  Each
+// later transform is applied to the transform as it was when the block 
+// began and gives the transform at shutter close.  Geometry submitted after
+// the block moves linearly, in raster space, between its positions at 
+// shutter open and shutter close.  Only object transforms can move; the
+// camera is fixed.
+*/
+void Renderer::motion_begin()
+{
+    REYES_ASSERT( !attributes_.empty() );
+    REYES_ASSERT( motion_transforms_ < 0 );
+    motion_transforms_ = 0;
+    motion_base_transform_ = attributes().motion_transform();
+}
+
+/**
+// End a motion block.
+*/
+void Renderer::motion_end()
+{
+    REYES_ASSERT( motion_transforms_ >= 0 );
+    motion_transforms_ = -1;
+}
+
 /**
 // Set the current transform to the identity.
 */
@@ -553,7 +828,18 @@ void Renderer::identity()
 void Renderer::transform( const math::mat4x4& transform )
 {
     REYES_ASSERT( !attributes_.empty() );
-    attributes().transform( transform );
+    if ( motion_transforms_ > 0 )
+    {
+        attributes().set_motion_transform( transform );
+    }
+    else
+    {
+        attributes().transform( transform );
+    }
+    if ( motion_transforms_ >= 0 )
+    {
+        ++motion_transforms_;
+    }
 }
 
 /**
@@ -570,7 +856,18 @@ void Renderer::transform( const math::mat4x4& transform )
 void Renderer::concat_transform( const math::mat4x4& transform )
 {
     REYES_ASSERT( !attributes_.empty() );
-    attributes().concat_transform( transform );
+    if ( motion_transforms_ > 0 )
+    {
+        attributes().set_motion_transform( motion_base_transform_ * transform );
+    }
+    else
+    {
+        attributes().concat_transform( transform );
+    }
+    if ( motion_transforms_ >= 0 )
+    {
+        ++motion_transforms_;
+    }
 }
 
 /**
@@ -1249,101 +1546,36 @@ void Renderer::polygon_mesh( int polygons, const int* vertices, const int* indic
 // Once a grid has been split small enough it is shaded, sampled, and then
 // discarded.
 //
+// When rendering in buckets the geometry is recorded along with the current
+// attributes and transform and isn't split until the buckets that it 
+// overlaps are rendered in Renderer::end().
+//
+// When recording a scene the geometry is recorded into the scene and isn't
+// rendered at all.
+//
 // @param geometry
 //  The geometry to split.
 */
 void Renderer::split( const Geometry& geometry )
 {
-    const mat4x4 transform = camera_transform_ * current_transform();
-    add_coordinate_system( "object", transform );
-
-    const float WIDTH = float(sample_buffer_->width() - 1);
-    const float HEIGHT = float(sample_buffer_->height() - 1);
-    const float SAMPLES_PER_PIXEL = float(options_->horizontal_sampling_rate() * options_->vertical_sampling_rate());
-
-    list<shared_ptr<Geometry>> geometries;
-    geometries.push_back( shared_ptr<Geometry>(const_cast<Geometry*>(&geometry), [](Geometry* /*geometry*/){}) );
-    while ( !geometries.empty() )
+    if ( scene_ )
     {
-        const shared_ptr<Geometry>& geometry = geometries.front();
-        REYES_ASSERT( geometry );
-
-        vec3 minimum = vec3( 0.0f, 0.0f, 0.0f );
-        vec3 maximum = vec3( 0.0f, 0.0f, 0.0f );
-
-        bool primitive_spans_epsilon_plane = false;
-        int width = 0;
-        int height = 0;
-        
-        if ( geometry->boundable() )
-        {
-            Grid& grid = attributes().surface_parameters();
-            geometry->bound( transform, &minimum, &maximum, &grid );
-            if ( minimum.z > options_->far_clip_distance() || maximum.z < options_->near_clip_distance() )
-            {
-                geometries.pop_front();   
-                continue;
-            }
-            
-            const float EPSILON = 0.01f;
-            primitive_spans_epsilon_plane = minimum.z < EPSILON && geometry->splittable();
-            if ( !primitive_spans_epsilon_plane )
-            {
-                vec3 s[8];
-                s[0] = vec3( raster(vec3(minimum.x, minimum.y, minimum.z)) );
-                s[1] = vec3( raster(vec3(minimum.x, maximum.y, minimum.z)) );
-                s[2] = vec3( raster(vec3(maximum.x, minimum.y, minimum.z)) );
-                s[3] = vec3( raster(vec3(maximum.x, maximum.y, minimum.z)) );
-                s[4] = vec3( raster(vec3(minimum.x, minimum.y, maximum.z)) );
-                s[5] = vec3( raster(vec3(minimum.x, maximum.y, maximum.z)) );
-                s[6] = vec3( raster(vec3(maximum.x, minimum.y, maximum.z)) );
-                s[7] = vec3( raster(vec3(maximum.x, maximum.y, maximum.z)) );
-
-                vec2 screen_minimum( FLT_MAX, FLT_MAX );
-                vec2 screen_maximum( -FLT_MAX, -FLT_MAX );
-                for ( int i = 0; i < 8; ++i )
-                {
-                    screen_minimum.x = std::min( screen_minimum.x, s[i].x );
-                    screen_minimum.y = std::min( screen_minimum.y, s[i].y );
-                    screen_maximum.x = std::max( screen_maximum.x, s[i].x );
-                    screen_maximum.y = std::max( screen_maximum.y, s[i].y );
-                }
-                
-                float x0 = screen_minimum.x;
-                float x1 = screen_maximum.x;
-                float y0 = screen_minimum.y;
-                float y1 = screen_maximum.y;
-
-                if ( x1 < 0.0f || x0 >= WIDTH || y1 < 0.0f || y0 >= HEIGHT )
-                {
-                    geometries.pop_front();
-                    continue;
-                }
+        record_in_scene( geometry );
+        return;
+    }
 
-                float pixels = (x1 - x0) * (y1 - y0) / SAMPLES_PER_PIXEL;
-                float micropolygons = pixels / attributes().shading_rate();
-                int power = std::max( 0, int(ceilf(lb(micropolygons) / 2.0f)) );
-                width = std::min( 1 << power, SHRT_MAX );
-                height = std::min( 1 << power, SHRT_MAX );
-            }
-        }
-        
-        Grid& grid = attributes().surface_parameters();
-        if ( !primitive_spans_epsilon_plane && width * height <= grid.maximum_vertices() && geometry->diceable() )
-        {
-            geometry->dice( transform, width, height, &grid );
-            displacement_shade( grid );
-            surface_shade( grid );
-            sample( grid );
-        }
-        else if ( geometry->splittable() )
-        {
-            geometry->split( &geometries );
-        }
-        
-        geometries.pop_front();
+    const Attributes& attributes = Renderer::attributes();
+    const mat4x4 transform = camera_transform_ * attributes.transform();
+    const mat4x4 motion_transform = camera_transform_ * attributes.motion_transform();
+    const mat4x4* moving = attributes.moving() ? &motion_transform : nullptr;
+    if ( options_->bucketed() )
+    {
+        record( geometry, transform, moving );
+        return;
     }
 
+    add_coordinate_system( "object", transform );
+    split( geometry, transform, moving, -1 );
     remove_coordinate_system( "object" );
 }
 
@@ -1385,15 +1617,135 @@ void Renderer::light_shade( Grid& grid )
 //
 // @param grid
 //  The grid to sample.
+//
+// @param motion_screen_transform
+//  The transform from camera space to screen space at shutter close for a
+//  moving grid or null if the grid doesn't move.
 */
-void Renderer::sample( const Grid& grid )
+void Renderer::sample( const Grid& grid, const math::mat4x4* motion_screen_transform )
 {
-    REYES_ASSERT( sampler_ );    
+    Sampler* sampler = Renderer::sampler();
+    REYES_ASSERT( sampler );    
     const Attributes& attributes = Renderer::attributes();
     bool matte = attributes.matte();
     bool two_sided = attributes.two_sided();
     bool left_handed = attributes.geometry_left_handed();
-    sampler_->sample( screen_transform_, grid, matte, two_sided, left_handed, sample_buffer_ );
+    sampler->sample( screen_transform_, grid, matte, two_sided, left_handed, sample_buffer(), motion_screen_transform );
+}
+
+/**
+// Is any micropolygon in \e grid nearer than the depth already stored at
+// a sample that it covers?
+//
+// Used to skip light and surface shading of grids that are completely 
+// hidden by geometry that has already been sampled when occlusion culling
+// is enabled.  Only the positions of \e grid are used so this assumes that
+// surface shaders don't move "P".
+//
+// @param grid
+//  The displaced grid to test.
+//
+// @return
+//  True if at least one sample would be written by sampling \e grid 
+//  otherwise false.
+*/
+bool Renderer::visible( const Grid& grid )
+{
+    Sampler* sampler = Renderer::sampler();
+    REYES_ASSERT( sampler );    
+    const Attributes& attributes = Renderer::attributes();
+    bool two_sided = attributes.two_sided();
+    bool left_handed = attributes.geometry_left_handed();
+    return sampler->visible( screen_transform_, grid, two_sided, left_handed, sample_buffer() );
+}
+
+/**
+// Add a display that rows of the final image are written to as they are 
+// completed.
+//
+// @param display
+//  The display to add (assumed not null and to outlive any frames rendered
+//  while it is added).
+*/
+void Renderer::add_display( Display* display )
+{
+    REYES_ASSERT( display );
+    displays_.push_back( display );
+}
+
+/**
+// Remove all of the displays added with Renderer::add_display().
+*/
+void Renderer::clear_displays()
+{
+    displays_.clear();
+}
+
+/**
+// Get the image buffer that the final image is quantized into.
+//
+// @return
+//  The image buffer for the last frame rendered.
+*/
+const ImageBuffer& Renderer::image_buffer() const
+{
+    REYES_ASSERT( image_buffer_ );
+    return *image_buffer_;
+}
+
+/**
+// Get the image buffer that unexposed colors and output variables are 
+// filtered into.
+//
+// The first four elements of each pixel are the filtered red, green, blue, 
+// and alpha before exposure and quantization and the remaining elements are
+// the filtered output variables in the order they were added to the 
+// options.
+//
+// @return
+//  The output buffer for the last frame rendered (assumed to exist because
+//  output variables were set in the options).
+*/
+const ImageBuffer& Renderer::output_buffer() const
+{
+    REYES_ASSERT( output_buffer_ );
+    return *output_buffer_;
+}
+
+/**
+// Get the number of grids that have been surface shaded.
+//
+// @return
+//  The number of grids surface shaded since the last call to 
+//  Renderer::begin().
+*/
+int Renderer::shaded_grids() const
+{
+    return shaded_grids_;
+}
+
+/**
+// Get the number of vertices that have been surface shaded.
+//
+// @return
+//  The number of vertices in the grids surface shaded since the last call
+//  to Renderer::begin().
+*/
+long long Renderer::shaded_vertices() const
+{
+    return shaded_vertices_;
+}
+
+/**
+// Get the number of times that geometry has been split.
+//
+// @return
+//  The number of times geometry has been split since the last call to 
+//  Renderer::begin().
+*/
+int Renderer::splits() const
+{
+    return splits_;
 }
 
 /**
@@ -1446,6 +1798,58 @@ void Renderer::save_image_as_png( const char* format, ... ) const
     image_buffer_->save_png( filename );
 }
 
+/**
+// Save the unexposed colors and output variables to a tiled file of 32 bit
+// floats.
+//
+// @param format
+//  A printf style format string that specifies the name of the file to write
+//  the output buffer to (assumed not null).
+//
+// @param ...
+//  Parameters as specified by \e format.
+*/
+void Renderer::save_outputs( const char* format, ... ) const
+{
+    REYES_ASSERT( output_buffer_ );
+    REYES_ASSERT( format );
+
+    char filename [1024];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( filename, sizeof(filename), format, args );
+    va_end( args );
+    filename [sizeof(filename) - 1] = 0;
+
+    output_buffer_->save_tiled( filename, output_channels(), false, error_policy_ );
+}
+
+/**
+// Save the unexposed colors and output variables to a tiled file of 16 bit
+// half floats.
+//
+// @param format
+//  A printf style format string that specifies the name of the file to write
+//  the output buffer to (assumed not null).
+//
+// @param ...
+//  Parameters as specified by \e format.
+*/
+void Renderer::save_outputs_as_half( const char* format, ... ) const
+{
+    REYES_ASSERT( output_buffer_ );
+    REYES_ASSERT( format );
+
+    char filename [1024];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( filename, sizeof(filename), format, args );
+    va_end( args );
+    filename [sizeof(filename) - 1] = 0;
+
+    output_buffer_->save_tiled( filename, output_channels(), true, error_policy_ );
+}
+
 /**
 // Save the current contents of the sample buffer to a file.
 //
@@ -1472,6 +1876,12 @@ void Renderer::save_samples( int mode, const char* format, ... ) const
     va_end( args );
     filename [sizeof(filename) - 1] = 0;
 
+    if ( options_->bucketed() )
+    {
+        error_policy_->error( RENDER_ERROR_SAMPLES_UNAVAILABLE, "Saving samples to '%s' failed as only the last bucket's samples are kept when rendering buckets", filename );
+        return;
+    }
+
     sample_buffer_->save( mode, filename );
 }
 
@@ -1504,6 +1914,12 @@ void Renderer::save_samples_as_png( int mode, const char* format, ... ) const
     va_end( args );
     filename [sizeof(filename) - 1] = 0;
 
+    if ( options_->bucketed() )
+    {
+        error_policy_->error( RENDER_ERROR_SAMPLES_UNAVAILABLE, "Saving samples to '%s' failed as only the last bucket's samples are kept when rendering buckets", filename );
+        return;
+    }
+
     sample_buffer_->save_png( mode, filename, error_policy_ );
 }
 
@@ -1587,7 +2003,13 @@ void Renderer::shadow_from_framebuffer( const char* name )
 {
     REYES_ASSERT( name );
 
-    Texture* texture = find_texture( name );
+    if ( options_->bucketed() )
+    {
+        error_policy_->error( RENDER_ERROR_SAMPLES_UNAVAILABLE, "Generating shadow map '%s' failed as only the last bucket's samples are kept when rendering buckets", name );
+        return;
+    }
+
+    Texture* texture = find_texture( name );
     if ( !texture )
     {
         texture = new Texture( TEXTURE_SHADOW, camera_transform_, screen_transform_ );
@@ -1611,6 +2033,12 @@ void Renderer::texture_from_framebuffer( const char* name )
 {
     REYES_ASSERT( name );
 
+    if ( options_->bucketed() )
+    {
+        error_policy_->error( RENDER_ERROR_SAMPLES_UNAVAILABLE, "Generating texture '%s' failed as only the last bucket's samples are kept when rendering buckets", name );
+        return;
+    }
+
     Texture* texture = find_texture( name );
     if ( !texture )
     {
@@ -1643,8 +2071,8 @@ Texture* Renderer::find_texture( const char* filename ) const
 // Load or find an existing shader.
 //
 // Looks for an existing loaded shader that was loaded using the same 
-// filename and returns that.  If there is no existing loaded shader with
-// that filename then a new shader is loaded and returned.
+// filename for the current maximum grid size and returns that.  If there is
+// no such shader then a new shader is loaded and returned.
 //
 // @param filename
 //  The filename of the shader to find or load.
@@ -1659,14 +2087,14 @@ Shader* Renderer::shader( const char* filename )
     Shader* shader = find_shader( filename );
     if ( !shader )
     {
-        shader = new Shader( filename, error_policy() );
-        shaders_.insert( make_pair(filename, shader) );
+        shader = new Shader( filename, error_policy(), options_->maximum_vertices() );
+        shaders_.insert( make_pair(make_pair(string(filename), options_->maximum_vertices()), shader) );
     }
     return shader;
 }
 
 /**
-// Find an existing shader.
+// Find an existing shader compiled for the current maximum grid size.
 //
 // @param filename
 //  The filename of the shader to find.
@@ -1678,7 +2106,7 @@ Shader* Renderer::find_shader( const char* filename ) const
 {
     REYES_ASSERT( filename );
     
-    map<string, Shader*>::const_iterator i = shaders_.find( filename );
+    map<pair<string, int>, Shader*>::const_iterator i = shaders_.find( make_pair(string(filename), options_->maximum_vertices()) );
     return i != shaders_.end() ? i->second : nullptr;
 }
 
@@ -1797,3 +2225,881 @@ float Renderer::lb( float x ) const
 {
     return log( x ) / log( 2.0f );
 }
+
+/**
+// Record geometry to render in the buckets that it overlaps.
+//
+// The current attributes are copied once and the copy is shared by all of
+// the primitives recorded until the attributes, or the parameters of any of
+// their shaders, are next changed.  Light shaders are copied along with the
+// attributes so that changes made to a light after geometry is recorded 
+// don't affect that geometry.
+//
+// Geometry that is culled by the near and far clipping planes or that falls
+// outside of the screen isn't recorded at all.
+//
+// @param geometry
+//  The geometry to record.
+//
+// @param transform
+//  The transform from object space to camera space.
+//
+// @param motion_transform
+//  The transform from object space to camera space at shutter close or null
+//  if the geometry doesn't move.
+*/
+void Renderer::record( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform )
+{
+    REYES_ASSERT( !attributes_.empty() );
+    REYES_ASSERT( options_->bucketed() );
+
+    const Attributes& attributes = Renderer::attributes();
+    if ( !snapshot_ || snapshot_source_ != &attributes || snapshot_revision_ != attributes.revision() )
+    {
+        snapshot_.reset( new Attributes(attributes) );
+        snapshot_->detach_light_shaders();
+        snapshot_source_ = &attributes;
+        snapshot_revision_ = attributes.revision();
+    }
+
+    const int columns = (options_->horizontal_resolution() + options_->bucket_width() - 1) / options_->bucket_width();
+    const int rows = (options_->vertical_resolution() + options_->bucket_height() - 1) / options_->bucket_height();
+
+    int x0 = 0;
+    int x1 = columns;
+    int y0 = 0;
+    int y1 = rows;
+    if ( geometry.boundable() )
+    {
+        vec4 bound( 0.0f, 0.0f, 0.0f, 0.0f );
+        float depth = 0.0f;
+        bool primitive_spans_epsilon_plane = false;
+        if ( !raster_bound(geometry, transform, motion_transform, &bound, &depth, &primitive_spans_epsilon_plane) )
+        {
+            return;
+        }
+        
+        if ( !primitive_spans_epsilon_plane )
+        {
+            overlapped_buckets( bound, &x0, &x1, &y0, &y1 );
+            if ( x0 >= x1 || y0 >= y1 )
+            {
+                return;
+            }
+        }
+    }
+
+    int primitive = int(primitives_.size());
+    primitives_.push_back( shared_ptr<Primitive>(new Primitive(geometry.clone(), snapshot_, transform, motion_transform)) );
+    for ( int y = y0; y < y1; ++y )
+    {
+        for ( int x = x0; x < x1; ++x )
+        {
+            buckets_[y * columns + x].push_back( primitive );
+        }
+    }
+}
+
+/**
+// Record geometry into the scene that is being recorded.
+//
+// The current attributes are copied once and the copy is shared by all of
+// the primitives recorded until the attributes, or the parameters of any of
+// their shaders, are next changed.  The shader and coordinate system 
+// transforms in the copy are moved from camera space to world space so that
+// the scene can be rendered from other cameras.
+//
+// @param geometry
+//  The geometry to record.
+*/
+void Renderer::record_in_scene( const Geometry& geometry )
+{
+    REYES_ASSERT( scene_ );
+    REYES_ASSERT( !attributes_.empty() );
+
+    if ( scene_->primitives() > 0 && scene_->maximum_vertices() != options_->maximum_vertices() )
+    {
+        error_policy_->error( RENDER_ERROR_INCOMPATIBLE_SCENE, "Recording into a scene recorded with a maximum grid size of %d vertices with a maximum grid size of %d vertices failed", scene_->maximum_vertices(), options_->maximum_vertices() );
+        return;
+    }
+
+    const Attributes& attributes = Renderer::attributes();
+    if ( !scene_snapshot_ || scene_snapshot_source_ != &attributes || scene_snapshot_revision_ != attributes.revision() )
+    {
+        scene_snapshot_.reset( new Attributes(attributes) );
+        scene_snapshot_->transform_spaces( inverse(camera_transform_) );
+        scene_snapshot_source_ = &attributes;
+        scene_snapshot_revision_ = attributes.revision();
+    }
+    scene_->add( shared_ptr<Primitive>(new Primitive(geometry.clone(), scene_snapshot_, attributes.transform(), attributes.moving() ? &attributes.motion_transform() : nullptr)), options_->maximum_vertices() );
+}
+
+/**
+// Render the primitives recorded during a frame one bucket at a time.
+//
+// Buckets are rendered from left to right and top to bottom or, when more
+// than one thread has been set in the options, concurrently by the threads
+// in the thread pool.  Each bucket only writes its own pixels and samples
+// primitives in the same order regardless of which thread renders it so the
+// image doesn't depend on the number of threads.
+//
+// @param exposure
+//  The exposure to resolve each bucket into the image buffer with.
+*/
+void Renderer::render_buckets( const Exposure& exposure )
+{
+    REYES_ASSERT( options_->bucketed() );
+
+    const int horizontal_resolution = options_->horizontal_resolution();
+    const int vertical_resolution = options_->vertical_resolution();
+    const int bucket_width = options_->bucket_width();
+    const int bucket_height = options_->bucket_height();
+    const int columns = (horizontal_resolution + bucket_width - 1) / bucket_width;
+    const int rows = (vertical_resolution + bucket_height - 1) / bucket_height;
+    REYES_ASSERT( int(buckets_.size()) == columns * rows );
+
+    if ( thread_pool_ )
+    {
+        thread_pool_->parallel_for( 0, columns * rows, [this, &exposure]( int thread, int bucket )
+        {
+            REYES_ASSERT( thread >= 0 && thread < int(workers_.size()) );
+            current_worker = workers_[thread];
+            render_bucket( bucket, exposure );
+            current_worker = nullptr;
+        } );
+
+        for ( vector<Worker*>::const_iterator i = workers_.begin(); i != workers_.end(); ++i )
+        {
+            Worker* worker = *i;
+            REYES_ASSERT( worker );
+            worker->clear();
+        }
+    }
+    else
+    {
+        for ( int bucket = 0; bucket < columns * rows; ++bucket )
+        {
+            render_bucket( bucket, exposure );
+        }
+    }
+
+    grid_cache_->clear();
+    buckets_.clear();
+    primitives_.clear();
+}
+
+/**
+// Render one bucket.
+//
+// The primitives that overlap the bucket are split, diced, shaded, and 
+// sampled in the order that they were submitted and then the bucket is 
+// resolved into the image buffer.  Only the samples for one bucket are stored
+// at any time.
+//
+// @param bucket
+//  The index of the bucket to render (in scanline order).
+//
+// @param exposure
+//  The exposure to resolve the bucket into the image buffer with.
+*/
+void Renderer::render_bucket( int bucket, const Exposure& exposure )
+{
+    REYES_ASSERT( bucket >= 0 && bucket < int(buckets_.size()) );
+
+    const int horizontal_resolution = options_->horizontal_resolution();
+    const int vertical_resolution = options_->vertical_resolution();
+    const int bucket_width = options_->bucket_width();
+    const int bucket_height = options_->bucket_height();
+    const int columns = (horizontal_resolution + bucket_width - 1) / bucket_width;
+    const int x0 = (bucket % columns) * bucket_width;
+    const int x1 = std::min( x0 + bucket_width, horizontal_resolution );
+    const int y0 = (bucket / columns) * bucket_height;
+    const int y1 = std::min( y0 + bucket_height, vertical_resolution );
+
+    SampleBuffer* sample_buffer = Renderer::sample_buffer();
+    sample_buffer->set_bucket( x0, y0, x1, y1 );
+
+    Worker* worker = Renderer::worker();
+    const vector<int>& primitives = buckets_[bucket];
+    for ( vector<int>::const_iterator i = primitives.begin(); i != primitives.end(); ++i )
+    {
+        const Primitive& primitive = *primitives_[*i];
+        if ( worker )
+        {
+            worker->push_attributes( primitive.attributes() );
+        }
+        else
+        {
+            attributes_.push_back( primitive.attributes() );
+        }
+
+        add_coordinate_system( "object", primitive.transform() );
+        split( primitive.geometry(), primitive.transform(), primitive.motion_transform(), *i );
+        remove_coordinate_system( "object" );
+
+        if ( worker )
+        {
+            worker->pop_attributes();
+        }
+        else
+        {
+            attributes_.pop_back();
+        }
+    }
+    grid_cache_->finish_bucket( bucket );
+
+    sample_buffer->composite();
+    resolve( sample_buffer, exposure, x0, y0, x1, y1 );
+}
+
+/**
+// Filter, expose, and quantize the pixels of the current bucket of a 
+// sample buffer into the image buffer.
+//
+// Pixels are resolved a few rows at a time so that only those rows are 
+// ever held as filtered floating point values.  When output variables are
+// set the unexposed colors and the filtered output variables are also 
+// copied into the output buffer.  The rows are resolved 
+// concurrently when a thread pool is available and this isn't already 
+// running on one of its threads to render a bucket.
+//
+// @param sample_buffer
+//  The sample buffer to resolve from (assumed not null).
+//
+// @param exposure
+//  The exposure to expose and quantize filtered pixels with.
+//
+// @param x0, y0, x1, y1
+//  The pixels covered by the current bucket of \e sample_buffer.
+*/
+void Renderer::resolve( const SampleBuffer* sample_buffer, const Exposure& exposure, int x0, int y0, int x1, int y1 )
+{
+    REYES_ASSERT( sample_buffer );
+    REYES_ASSERT( image_buffer_ );
+    REYES_ASSERT( image_buffer_->format() == FORMAT_U8 && image_buffer_->elements() == 4 );
+    REYES_ASSERT( x0 >= 0 && x1 <= image_buffer_->width() && y0 >= 0 && y1 <= image_buffer_->height() );
+
+    const int bands = (y1 - y0 + RESOLVE_ROWS - 1) / RESOLVE_ROWS;
+    auto resolve_band = [this, sample_buffer, &exposure, x0, y0, x1, y1]( int band )
+    {
+        const int band_y0 = y0 + band * RESOLVE_ROWS;
+        const int band_y1 = std::min( band_y0 + RESOLVE_ROWS, y1 );
+        vector<vec4> pixels;
+        sample_buffer->filter( band_y0, band_y1, &pixels );
+        for ( int y = band_y0; y < band_y1; ++y )
+        {
+            exposure.quantize( &pixels[(y - band_y0) * (x1 - x0)], x0, y, x1 - x0, image_buffer_->u8_data(x0, y) );
+        }
+
+        if ( output_buffer_ )
+        {
+            vector<float> outputs;
+            sample_buffer->filter_outputs( band_y0, band_y1, &outputs );
+            const int output_elements = sample_buffer->output_elements();
+            for ( int y = band_y0; y < band_y1; ++y )
+            {
+                for ( int x = x0; x < x1; ++x )
+                {
+                    const int pixel = (y - band_y0) * (x1 - x0) + x - x0;
+                    float* output = output_buffer_->f32_data( x, y );
+                    memcpy( output, &pixels[pixel], sizeof(vec4) );
+                    memcpy( output + 4, &outputs[pixel * output_elements], sizeof(float) * output_elements );
+                }
+            }
+        }
+        display( x0, band_y0, x1, band_y1 );
+    };
+
+    if ( thread_pool_ && !worker() && bands > 1 )
+    {
+        thread_pool_->parallel_for( 0, bands, [&resolve_band]( int /*thread*/, int band )
+        {
+            resolve_band( band );
+        } );
+    }
+    else
+    {
+        for ( int band = 0; band < bands; ++band )
+        {
+            resolve_band( band );
+        }
+    }
+}
+
+/**
+// Note that pixels have been resolved into the image buffer and write any
+// rows that are now complete to the displays.
+//
+// Rows are written in order so rows completed below a row that is still 
+// being resolved wait until it completes.
+//
+// @param x0, y0, x1, y1
+//  The pixels that have been resolved.
+*/
+void Renderer::display( int x0, int y0, int x1, int y1 )
+{
+    if ( displays_.empty() )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( display_mutex_ );
+    for ( int y = y0; y < y1; ++y )
+    {
+        resolved_pixels_[y] += x1 - x0;
+    }
+
+    const int width = image_buffer_->width();
+    const int height = image_buffer_->height();
+    const int displayed_rows = displayed_rows_;
+    while ( displayed_rows_ < height && resolved_pixels_[displayed_rows_] == width )
+    {
+        ++displayed_rows_;
+    }
+
+    if ( displayed_rows_ > displayed_rows )
+    {
+        for ( vector<Display*>::const_iterator i = displays_.begin(); i != displays_.end(); ++i )
+        {
+            Display* display = *i;
+            REYES_ASSERT( display );
+            display->write( displayed_rows, displayed_rows_, image_buffer_->u8_data(0, displayed_rows) );
+        }
+    }
+}
+
+/**
+// Get the names of the channels in the output buffer.
+//
+// @return
+//  The names "r", "g", "b", and "a" followed by the identifier of each
+//  float output variable and the identifier suffixed with ".r", ".g", and 
+//  ".b" or ".x", ".y", and ".z" for each color or point, vector, and normal
+//  output variable.
+*/
+vector<string> Renderer::output_channels() const
+{
+    vector<string> channels = { "r", "g", "b", "a" };
+    for ( int i = 0; i < options_->output_variables(); ++i )
+    {
+        const string& identifier = options_->output_variable( i );
+        switch ( options_->output_type(i) )
+        {
+            case TYPE_FLOAT:
+                channels.push_back( identifier );
+                break;
+
+            case TYPE_COLOR:
+                channels.push_back( identifier + ".r" );
+                channels.push_back( identifier + ".g" );
+                channels.push_back( identifier + ".b" );
+                break;
+
+            default:
+                channels.push_back( identifier + ".x" );
+                channels.push_back( identifier + ".y" );
+                channels.push_back( identifier + ".z" );
+                break;
+        }
+    }
+    return channels;
+}
+
+/**
+// Destroy the thread pool and the workers used to render buckets 
+// concurrently or to shade and sample large grids in parallel row bands.
+*/
+void Renderer::destroy_workers()
+{
+    virtual_machine_->set_thread_pool( nullptr );
+    if ( sampler_ )
+    {
+        sampler_->set_thread_pool( nullptr );
+    }
+
+    for ( vector<Worker*>::const_iterator i = workers_.begin(); i != workers_.end(); ++i )
+    {
+        delete *i;
+    }
+    workers_.clear();
+
+    delete thread_pool_;
+    thread_pool_ = nullptr;
+}
+
+/**
+// Get the worker for the calling thread.
+//
+// @return
+//  The worker that the calling thread is rendering a bucket with or null if
+//  the calling thread isn't rendering a bucket for this renderer on a thread
+//  pool.
+*/
+Worker* Renderer::worker() const
+{
+    return current_worker && current_worker->renderer() == this ? current_worker : nullptr;
+}
+
+/**
+// Get the sampler for the calling thread.
+//
+// @return
+//  The sampler of the calling thread's worker or this renderer's sampler 
+//  when not rendering on a thread pool.
+*/
+Sampler* Renderer::sampler() const
+{
+    Worker* worker = Renderer::worker();
+    return worker ? worker->sampler() : sampler_;
+}
+
+/**
+// Get the sample buffer for the calling thread.
+//
+// @return
+//  The sample buffer of the calling thread's worker or this renderer's 
+//  sample buffer when not rendering on a thread pool.
+*/
+SampleBuffer* Renderer::sample_buffer() const
+{
+    Worker* worker = Renderer::worker();
+    return worker ? worker->sample_buffer() : sample_buffer_;
+}
+
+/**
+// Get the split stack for the calling thread.
+//
+// @return
+//  The split stack of the calling thread's worker or this renderer's split
+//  stack when not rendering on a thread pool.
+*/
+SplitStack* Renderer::split_stack() const
+{
+    Worker* worker = Renderer::worker();
+    return worker ? worker->split_stack() : split_stack_;
+}
+
+/**
+// Recursively split geometry until it is small enough to dice.
+//
+// Geometry is split depth first on the calling thread's split stack.  The 
+// pieces split from the geometry are constructed in that stack's memory and
+// are all destroyed at once when the geometry is finished.
+//
+// Geometry is culled against the samples stored in the sample buffer; the 
+// whole frame when rendering without buckets or the samples for the current
+// bucket otherwise.
+//
+// When rendering buckets grids that overlap buckets that are still to be 
+// rendered are kept in the grid cache so that they're only diced and shaded
+// once.
+//
+// @param geometry
+//  The geometry to split.
+//
+// Moving geometry is bounded over the whole time that the shutter is open
+// and geometry is bounded over the whole lens when there is depth of field.
+// Either is always shaded as it can't be tested against the sample buffer's
+// depths without knowing when or from where each sample sees it.
+//
+// @param transform
+//  The transform from object space to camera space.
+//
+// @param motion_transform
+//  The transform from object space to camera space at shutter close or null
+//  if the geometry doesn't move.
+//
+// @param primitive
+//  The index of the recorded primitive that is being split for the current
+//  bucket or -1 if the geometry isn't a recorded primitive.
+*/
+void Renderer::split( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform, int primitive )
+{
+    const mat4x4 motion_screen_transform = motion_transform ? screen_transform_ * *motion_transform * inverse( transform ) : screen_transform_;
+    const mat4x4* moving = motion_transform ? &motion_screen_transform : nullptr;
+
+    // Samples may be offset from their integer positions by up to half a 
+    // sample so the bucket's samples are bounded by its first and last 
+    // samples' positions widened by that offset.
+    SampleBuffer* sample_buffer = Renderer::sample_buffer();
+    const float offset = sample_buffer->maximum_offset();
+    const float X0 = float(sample_buffer->x0()) - offset;
+    const float X1 = float(sample_buffer->x1() - 1) + offset;
+    const float Y0 = float(sample_buffer->y0()) - offset;
+    const float Y1 = float(sample_buffer->y1() - 1) + offset;
+
+    SplitStack* split_stack = Renderer::split_stack();
+    REYES_ASSERT( split_stack->empty() );
+    split_stack->push( &geometry );
+    while ( !split_stack->empty() )
+    {
+        const Geometry* geometry = split_stack->top();
+        split_stack->pop();
+        REYES_ASSERT( geometry );
+
+        vec4 bound( 0.0f, 0.0f, 0.0f, 0.0f );
+        float depth = 0.0f;
+        bool primitive_spans_epsilon_plane = false;
+        int width = 0;
+        int height = 0;
+        
+        if ( geometry->boundable() )
+        {
+            if ( !raster_bound(*geometry, transform, motion_transform, &bound, &depth, &primitive_spans_epsilon_plane) )
+            {
+                continue;
+            }
+            
+            if ( !primitive_spans_epsilon_plane )
+            {
+                float x0 = bound.x;
+                float x1 = bound.y;
+                float y0 = bound.z;
+                float y1 = bound.w;
+
+                if ( x1 < X0 || x0 > X1 || y1 < Y0 || y0 > Y1 )
+                {
+                    continue;
+                }
+
+                if ( options_->occlusion_culling() && sample_buffer->occluded(int(floorf(x0)), int(floorf(y0)), int(ceilf(x1)) + 1, int(ceilf(y1)) + 1, depth) )
+                {
+                    continue;
+                }
+
+                if ( geometry->diceable() )
+                {
+                    if ( moving || options_->lens_radius() > 0.0f || !bound_dicing_rate(bound, &width, &height) )
+                    {
+                        dicing_rate( *geometry, transform, &width, &height );
+                    }
+                }
+            }
+        }
+        
+        Grid& grid = attributes().surface_parameters();
+        if ( !primitive_spans_epsilon_plane && width * height <= grid.maximum_vertices() && geometry->diceable() )
+        {
+            const bool cached = primitive >= 0 && options_->grid_cache();
+            shared_ptr<GridCache::Entry> entry = cached ? grid_cache_->acquire( primitive, geometry->u_range(), geometry->v_range() ) : shared_ptr<GridCache::Entry>();
+            if ( entry )
+            {
+                const Attributes& attributes = Renderer::attributes();
+                const vec3* colors = !entry->colors_.empty() ? &entry->colors_[0] : nullptr;
+                const vec3* opacities = !entry->opacities_.empty() ? &entry->opacities_[0] : nullptr;
+                const float* outputs = !entry->outputs_.empty() ? &entry->outputs_[0] : nullptr;
+                sampler()->sample( screen_transform_, entry->width_, entry->height_, &entry->positions_[0], colors, opacities, outputs, attributes.matte(), attributes.two_sided(), attributes.geometry_left_handed(), sample_buffer, moving );
+            }
+            else
+            {
+                geometry->dice( transform, width, height, &grid );
+                displacement_shade( grid );
+                if ( !options_->occlusion_culling() || moving || options_->lens_radius() > 0.0f || visible(grid) )
+                {
+                    surface_shade( grid );
+                    sample( grid, moving );
+                    ++shaded_grids_;
+                    shaded_vertices_ += grid.size();
+
+                    if ( cached )
+                    {
+                        int x0 = 0;
+                        int x1 = 0;
+                        int y0 = 0;
+                        int y1 = 0;
+                        overlapped_buckets( bound, &x0, &x1, &y0, &y1 );
+                        int buckets = (x1 - x0) * (y1 - y0);
+                        if ( buckets > 1 )
+                        {
+                            const int columns = (options_->horizontal_resolution() + options_->bucket_width() - 1) / options_->bucket_width();
+                            vector<float> outputs;
+                            sampler()->copy_outputs( grid, &outputs );
+                            grid_cache_->insert( primitive, geometry->u_range(), geometry->v_range(), grid, outputs, buckets - 1, (y1 - 1) * columns + x1 - 1 );
+                        }
+                    }
+                }
+            }
+        }
+        else if ( geometry->splittable() )
+        {
+            geometry->split( split_stack );
+            ++splits_;
+        }
+    }
+    split_stack->clear();
+}
+
+/**
+// Calculate the bounds of geometry in raster space.
+//
+// Geometry that spans the epsilon plane can't be projected and so has no
+// bounds in raster space.  Such geometry is expected to be split until the
+// pieces either lie in front of the epsilon plane or are culled by the near
+// clipping plane.
+//
+// @param geometry
+//  The geometry to bound (assumed to be boundable).
+//
+// @param transform
+//  The transform from object space to camera space.
+//
+// @param motion_transform
+//  The transform from object space to camera space at shutter close or null
+//  if the geometry doesn't move.
+//
+// @param bound
+//  A variable to receive the minimum x, maximum x, minimum y, and maximum y
+//  of the geometry in raster space (assumed not null).
+//
+// @param depth
+//  A variable to receive the nearest depth of the geometry as compared 
+//  against the depths stored in the sample buffer (assumed not null).
+//
+// @param primitive_spans_epsilon_plane
+//  A variable to receive whether or not the geometry spans the epsilon plane
+//  (assumed not null).
+//
+// @return
+//  False if the geometry lies outside of the near or far clipping planes
+//  otherwise true.
+*/
+bool Renderer::raster_bound( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform, math::vec4* bound, float* depth, bool* primitive_spans_epsilon_plane )
+{
+    REYES_ASSERT( geometry.boundable() );
+    REYES_ASSERT( bound );
+    REYES_ASSERT( depth );
+    REYES_ASSERT( primitive_spans_epsilon_plane );
+
+    vec3 minimum = vec3( 0.0f, 0.0f, 0.0f );
+    vec3 maximum = vec3( 0.0f, 0.0f, 0.0f );
+    Grid& grid = attributes().surface_parameters();
+    geometry.bound( transform, &minimum, &maximum, &grid );
+    if ( motion_transform )
+    {
+        // Moving geometry is sampled between its raster positions at shutter
+        // open and close and both lie within the bound of its camera space 
+        // bounds at shutter open and close.
+        vec3 motion_minimum = vec3( 0.0f, 0.0f, 0.0f );
+        vec3 motion_maximum = vec3( 0.0f, 0.0f, 0.0f );
+        geometry.bound( *motion_transform, &motion_minimum, &motion_maximum, &grid );
+        minimum = vec3( std::min(minimum.x, motion_minimum.x), std::min(minimum.y, motion_minimum.y), std::min(minimum.z, motion_minimum.z) );
+        maximum = vec3( std::max(maximum.x, motion_maximum.x), std::max(maximum.y, motion_maximum.y), std::max(maximum.z, motion_maximum.z) );
+    }
+
+    const float lens_radius = options_->lens_radius();
+    if ( lens_radius > 0.0f )
+    {
+        // Seen from anywhere on the lens geometry moves across by at most the
+        // lens radius scaled by how far it is from the focal plane.
+        const float focal_distance = options_->focal_distance();
+        const float spread = lens_radius * std::max( fabsf(minimum.z / focal_distance - 1.0f), fabsf(maximum.z / focal_distance - 1.0f) );
+        minimum = vec3( minimum.x - spread, minimum.y - spread, minimum.z );
+        maximum = vec3( maximum.x + spread, maximum.y + spread, maximum.z );
+    }
+    if ( minimum.z > options_->far_clip_distance() || maximum.z < options_->near_clip_distance() )
+    {
+        return false;
+    }
+    
+    const float EPSILON = 0.01f;
+    *primitive_spans_epsilon_plane = minimum.z < EPSILON && geometry.splittable();
+    if ( !*primitive_spans_epsilon_plane )
+    {
+        vec4 s[8];
+        s[0] = raster( vec3(minimum.x, minimum.y, minimum.z) );
+        s[1] = raster( vec3(minimum.x, maximum.y, minimum.z) );
+        s[2] = raster( vec3(maximum.x, minimum.y, minimum.z) );
+        s[3] = raster( vec3(maximum.x, maximum.y, minimum.z) );
+        s[4] = raster( vec3(minimum.x, minimum.y, maximum.z) );
+        s[5] = raster( vec3(minimum.x, maximum.y, maximum.z) );
+        s[6] = raster( vec3(maximum.x, minimum.y, maximum.z) );
+        s[7] = raster( vec3(maximum.x, maximum.y, maximum.z) );
+
+        vec2 screen_minimum( FLT_MAX, FLT_MAX );
+        vec2 screen_maximum( -FLT_MAX, -FLT_MAX );
+        float nearest = FLT_MAX;
+        for ( int i = 0; i < 8; ++i )
+        {
+            screen_minimum.x = std::min( screen_minimum.x, s[i].x );
+            screen_minimum.y = std::min( screen_minimum.y, s[i].y );
+            screen_maximum.x = std::max( screen_maximum.x, s[i].x );
+            screen_maximum.y = std::max( screen_maximum.y, s[i].y );
+            nearest = std::min( nearest, s[i].w );
+        }
+        *bound = vec4( screen_minimum.x, screen_maximum.x, screen_minimum.y, screen_maximum.y );
+        *depth = nearest;
+    }
+    return true;
+}
+
+/**
+// Estimate the number of vertices across and down to dice geometry into 
+// from its raster bound.
+//
+// Geometry whose bound needs many times more vertices than fit in a grid is
+// split without dicing it into a small grid to probe its dicing rate.  A
+// bound can be much larger than the geometry it contains, e.g. for long 
+// thin geometry lying diagonally across the screen, so geometry whose bound
+// is only a little too large is left for Renderer::dicing_rate() to probe.
+//
+// @param bound
+//  The bound of the geometry in raster space (assumed not to be expanded
+//  for motion blur or depth of field).
+//
+// @param width
+//  A variable to receive the number of vertices to dice across.
+//
+// @param height
+//  A variable to receive the number of vertices to dice down.
+//
+// @return
+//  True if the geometry is clearly too large to dice and so \e width and
+//  \e height have been set otherwise false.
+*/
+bool Renderer::bound_dicing_rate( const math::vec4& bound, int* width, int* height )
+{
+    REYES_ASSERT( width );
+    REYES_ASSERT( height );
+
+    const int OVERSIZE = 4;
+    const float micropolygon_length = sqrtf( attributes().shading_rate() );
+    const float u_length = (bound.y - bound.x) / float(options_->horizontal_sampling_rate());
+    const float v_length = (bound.w - bound.z) / float(options_->vertical_sampling_rate());
+    const int across = std::min( std::max(2, int(ceilf(u_length / micropolygon_length)) + 1), int(SHRT_MAX) );
+    const int down = std::min( std::max(2, int(ceilf(v_length / micropolygon_length)) + 1), int(SHRT_MAX) );
+    if ( across * down > OVERSIZE * options_->maximum_vertices() )
+    {
+        *width = across;
+        *height = down;
+        return true;
+    }
+    return false;
+}
+
+/**
+// Calculate the number of vertices across and down to dice geometry into.
+//
+// The geometry is diced into a small grid that is projected into raster 
+// space to estimate its length in pixels along u and along v.  Each 
+// direction gets enough vertices for micropolygons to be close to the 
+// shading rate on a side so long thin geometry isn't diced as finely 
+// across its short side as along its long side.
+//
+// @param geometry
+//  The geometry to calculate the dicing rate for (assumed to be boundable,
+//  diceable, and not spanning the epsilon plane).
+//
+// @param transform
+//  The transform from object space to camera space.
+//
+// @param width
+//  A variable to receive the number of vertices to dice across (in u).
+//
+// @param height
+//  A variable to receive the number of vertices to dice down (in v).
+*/
+void Renderer::dicing_rate( const Geometry& geometry, const math::mat4x4& transform, int* width, int* height )
+{
+    REYES_ASSERT( geometry.diceable() );
+    REYES_ASSERT( width );
+    REYES_ASSERT( height );
+
+    const int PROBE = 5;
+    const float horizontal_sampling_rate = float(options_->horizontal_sampling_rate());
+    const float vertical_sampling_rate = float(options_->vertical_sampling_rate());
+    Grid& grid = attributes().surface_parameters();
+    geometry.dice( transform, PROBE, PROBE, &grid );
+    const vec3* positions = grid.vec3_value( "P" );
+    REYES_ASSERT( positions );
+
+    vec2 pixels [PROBE * PROBE];
+    for ( int i = 0; i < PROBE * PROBE; ++i )
+    {
+        vec4 position = raster( positions[i] );
+        pixels[i] = vec2( position.x / horizontal_sampling_rate, position.y / vertical_sampling_rate );
+    }
+
+    float u_length = 0.0f;
+    float v_length = 0.0f;
+    for ( int j = 0; j < PROBE; ++j )
+    {
+        float u_row_length = 0.0f;
+        float v_column_length = 0.0f;
+        for ( int i = 0; i < PROBE - 1; ++i )
+        {
+            vec2 u = pixels[j * PROBE + i + 1] - pixels[j * PROBE + i];
+            vec2 v = pixels[(i + 1) * PROBE + j] - pixels[i * PROBE + j];
+            u_row_length += sqrtf( u.x * u.x + u.y * u.y );
+            v_column_length += sqrtf( v.x * v.x + v.y * v.y );
+        }
+        u_length = std::max( u_length, u_row_length );
+        v_length = std::max( v_length, v_column_length );
+    }
+
+    const float micropolygon_length = sqrtf( attributes().shading_rate() );
+    *width = std::min( std::max(2, int(ceilf(u_length / micropolygon_length)) + 1), int(SHRT_MAX) );
+    *height = std::min( std::max(2, int(ceilf(v_length / micropolygon_length)) + 1), int(SHRT_MAX) );
+}
+
+/**
+// Calculate the range of buckets whose samples are overlapped by a raster
+// space bound.
+//
+// A bucket is overlapped when the bound isn't culled against the samples
+// stored for that bucket by Renderer::split().
+//
+// @param bound
+//  The minimum x, maximum x, minimum y, and maximum y in raster space.
+//
+// @param x0, y0
+//  Variables to receive the first bucket across and down (assumed not null).
+//
+// @param x1, y1
+//  Variables to receive one past the last bucket across and down (assumed
+//  not null).
+*/
+void Renderer::overlapped_buckets( const math::vec4& bound, int* x0, int* x1, int* y0, int* y1 ) const
+{
+    REYES_ASSERT( x0 && x1 && y0 && y1 );
+    REYES_ASSERT( options_->bucketed() );
+
+    const int horizontal_resolution = options_->horizontal_resolution();
+    const int vertical_resolution = options_->vertical_resolution();
+    const int bucket_width = options_->bucket_width();
+    const int bucket_height = options_->bucket_height();
+    const int columns = (horizontal_resolution + bucket_width - 1) / bucket_width;
+    const int rows = (vertical_resolution + bucket_height - 1) / bucket_height;
+    const float offset = sample_buffer_->maximum_offset();
+
+    *x0 = columns;
+    *x1 = 0;
+    for ( int x = 0; x < columns; ++x )
+    {
+        int sample_x0 = 0;
+        int sample_y0 = 0;
+        int sample_x1 = 0;
+        int sample_y1 = 0;
+        sample_buffer_->samples_for_pixels( x * bucket_width, 0, std::min((x + 1) * bucket_width, horizontal_resolution), 1, &sample_x0, &sample_y0, &sample_x1, &sample_y1 );
+        if ( bound.y >= float(sample_x0) - offset && bound.x <= float(sample_x1 - 1) + offset )
+        {
+            *x0 = std::min( *x0, x );
+            *x1 = std::max( *x1, x + 1 );
+        }
+    }
+
+    *y0 = rows;
+    *y1 = 0;
+    for ( int y = 0; y < rows; ++y )
+    {
+        int sample_x0 = 0;
+        int sample_y0 = 0;
+        int sample_x1 = 0;
+        int sample_y1 = 0;
+        sample_buffer_->samples_for_pixels( 0, y * bucket_height, 1, std::min((y + 1) * bucket_height, vertical_resolution), &sample_x0, &sample_y0, &sample_x1, &sample_y1 );
+        if ( bound.w >= float(sample_y0) - offset && bound.z <= float(sample_y1 - 1) + offset )
+        {
+            *y0 = std::min( *y0, y );
+            *y1 = std::max( *y1, y + 1 );
+        }
+    }
+}
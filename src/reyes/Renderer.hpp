@@ -4,6 +4,8 @@
 #include <math/vec4.hpp>
 #include <math/mat4x4.hpp>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <utility>
 #include <vector>
 #include <map>
@@ -23,6 +25,14 @@ class Grid;
 class Geometry;
 class Texture;
 class Shader;
+class Primitive;
+class GridCache;
+class SplitStack;
+class Scene;
+class ThreadPool;
+class Worker;
+class Exposure;
+class Display;
 
 /**
 // The main interface to the renderer.
@@ -34,13 +44,36 @@ class Renderer
     Shader* null_surface_shader_; ///< The null surface shader used when no surface shader is set.
     SampleBuffer* sample_buffer_; ///< The sample buffer that grids are sampled into.
     ImageBuffer* image_buffer_; ///< The image buffer that the final image is filtered, exposed, and quantized into.
+    ImageBuffer* output_buffer_; ///< The image buffer that unexposed colors and output variables are filtered into (null without output variables).
     Sampler* sampler_; ///< The sampler that samples grids into the sample buffer.
     math::mat4x4 screen_transform_; ///< Transform camera space to screen space.    
     math::mat4x4 camera_transform_; ///< Transform world space to camera space.
+    int motion_transforms_; ///< The number of transforms given in the current motion block or -1 outside of a motion block.
+    math::mat4x4 motion_base_transform_; ///< The transform at shutter close when the current motion block began.
     std::map<std::string, Texture*> textures_; ///< The textures that have been loaded (by filename).
-    std::map<std::string, Shader*> shaders_; ///< The shaders that have been loaded (by filename).
+    std::map<std::pair<std::string, int>, Shader*> shaders_; ///< The shaders that have been loaded (by filename and maximum grid size, the null surface shader has an empty filename).
     Options* options_; /// The options used for this renderer.
     std::vector<std::shared_ptr<Attributes>> attributes_; ///< The attributes stack.
+    std::shared_ptr<Attributes> snapshot_; ///< A copy of the current attributes shared by primitives recorded for buckets.
+    const Attributes* snapshot_source_; ///< The attributes that the snapshot was copied from.
+    int snapshot_revision_; ///< The revision of the attributes that the snapshot was copied from.
+    Scene* scene_; ///< The scene that geometry is recorded into or null to render geometry as it is submitted.
+    std::shared_ptr<Attributes> scene_snapshot_; ///< A world space copy of the current attributes shared by primitives recorded into the scene.
+    const Attributes* scene_snapshot_source_; ///< The attributes that the scene snapshot was copied from.
+    int scene_snapshot_revision_; ///< The revision of the attributes that the scene snapshot was copied from.
+    std::vector<std::shared_ptr<Primitive>> primitives_; ///< The primitives recorded to render in buckets.
+    std::vector<std::vector<int>> buckets_; ///< The indices of the primitives that overlap each bucket.
+    GridCache* grid_cache_; ///< Shaded grids kept for buckets that are yet to be rendered.
+    SplitStack* split_stack_; ///< The geometry waiting to be split or diced.
+    ThreadPool* thread_pool_; ///< The threads that render buckets concurrently (null when rendering on one thread).
+    std::vector<Worker*> workers_; ///< The state used by each thread in the thread pool.
+    std::vector<Display*> displays_; ///< The displays that completed rows of the final image are written to.
+    std::mutex display_mutex_; ///< Serializes writing completed rows to the displays.
+    std::vector<int> resolved_pixels_; ///< The number of pixels resolved in each row of the current frame.
+    int displayed_rows_; ///< The number of rows of the current frame written to the displays.
+    std::atomic<int> shaded_grids_; ///< The number of grids shaded since the last call to Renderer::begin().
+    std::atomic<long long> shaded_vertices_; ///< The number of vertices shaded since the last call to Renderer::begin().
+    std::atomic<int> splits_; ///< The number of times geometry has been split since the last call to Renderer::begin().
 
 public:
     Renderer();
@@ -69,6 +102,9 @@ public:
     void end();        
     void begin_world();
     void end_world();
+    void begin_scene( Scene* scene );
+    void end_scene();
+    void render_scene( const Scene& scene );
     void projection();
     const math::mat4x4& screen_transform() const;
     const math::mat4x4& camera_transform() const;
@@ -81,6 +117,8 @@ public:
 
     void begin_transform();
     void end_transform();
+    void motion_begin();
+    void motion_end();
     void identity();
     void transform( const math::mat4x4& transform );
     void concat_transform( const math::mat4x4& transform );
@@ -119,10 +157,20 @@ public:
     void displacement_shade( Grid& grid );
     void surface_shade( Grid& grid );
     void light_shade( Grid& grid );
-    void sample( const Grid& grid );
+    void sample( const Grid& grid, const math::mat4x4* motion_screen_transform = nullptr );
+    bool visible( const Grid& grid );
     
+    void add_display( Display* display );
+    void clear_displays();
+    const ImageBuffer& image_buffer() const;
+    const ImageBuffer& output_buffer() const;
+    int shaded_grids() const;
+    long long shaded_vertices() const;
+    int splits() const;
     void save_image( const char* format, ... ) const;
     void save_image_as_png( const char* format, ... ) const;
+    void save_outputs( const char* format, ... ) const;
+    void save_outputs_as_half( const char* format, ... ) const;
     void save_samples( int mode, const char* format, ... ) const;
     void save_samples_as_png( int mode, const char* format, ... ) const;
 
@@ -146,6 +194,25 @@ public:
     float min( float a, float b, float c, float d ) const;
     float max( float a, float b, float c, float d ) const;
     float lb( float x ) const;
+
+private:
+    void record( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform );
+    void record_in_scene( const Geometry& geometry );
+    void render_buckets( const Exposure& exposure );
+    void render_bucket( int bucket, const Exposure& exposure );
+    void resolve( const SampleBuffer* sample_buffer, const Exposure& exposure, int x0, int y0, int x1, int y1 );
+    void display( int x0, int y0, int x1, int y1 );
+    std::vector<std::string> output_channels() const;
+    void destroy_workers();
+    Worker* worker() const;
+    Sampler* sampler() const;
+    SampleBuffer* sample_buffer() const;
+    SplitStack* split_stack() const;
+    void split( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform, int primitive );
+    bool raster_bound( const Geometry& geometry, const math::mat4x4& transform, const math::mat4x4* motion_transform, math::vec4* bound, float* depth, bool* primitive_spans_epsilon_plane );
+    bool bound_dicing_rate( const math::vec4& bound, int* width, int* height );
+    void dicing_rate( const Geometry& geometry, const math::mat4x4& transform, int* width, int* height );
+    void overlapped_buckets( const math::vec4& bound, int* x0, int* x1, int* y0, int* y1 ) const;
 };
 
 }
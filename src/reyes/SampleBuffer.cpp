@@ -5,22 +5,186 @@
 
 #include "SampleBuffer.hpp"
 #include "ImageBuffer.hpp"
+#include "DepthPyramid.hpp"
+#include "VisiblePoints.hpp"
 #include "DisplayMode.hpp"
 #include "ImageBufferFormat.hpp"
 #include "ErrorCode.hpp"
 #include "ErrorPolicy.hpp"
+#include "hash.hpp"
 #include <math/vec2.ipp>
+#include <math/vec3.ipp>
 #include <math/vec4.ipp>
 #include <math/mat4x4.ipp>
 #include <math/scalar.ipp>
 #include "assert.hpp"
 #include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
 
 using std::max;
+using std::vector;
 using namespace math;
 using namespace reyes;
 
-SampleBuffer::SampleBuffer( int horizontal_resolution, int vertical_resolution, int horizontal_sampling_rate, int vertical_sampling_rate, float filter_width, float filter_height )
+// Sample offsets are stored for a tile of pixels that repeats across the
+// sample buffer.  Each row of the tile is followed by a copy of its first
+// few offsets so that vectors of offsets can be loaded from anywhere within
+// a row without wrapping.
+static const int OFFSETS_TILE_SIZE = 8;
+static const int OFFSETS_PADDING = 8;
+
+// Samples are divided into at most this many bins by time or by lens 
+// position so that moving or defocused micropolygons only test the samples
+// in the bins that they're bounded for.
+static const int MAXIMUM_TIME_BINS = 16;
+static const int MAXIMUM_LENS_BINS = 16;
+
+// Positions within strata are clamped below one so that samples never reach
+// the next stratum.
+static const float ONE_MINUS_EPSILON = 0.99999994f;
+
+static float random_float( unsigned int seed, unsigned int index )
+{
+    return float(hash(seed ^ hash(index)) >> 8) * (1.0f / 16777216.0f);
+}
+
+static int power_of_two_exponent( int value )
+{
+    int exponent = 0;
+    while ( (1 << exponent) < value )
+    {
+        ++exponent;
+    }
+    return (1 << exponent) == value ? exponent : -1;
+}
+
+static unsigned int van_der_corput( unsigned int index )
+{
+    index = (index << 16) | (index >> 16);
+    index = ((index & 0x00ff00ffu) << 8) | ((index & 0xff00ff00u) >> 8);
+    index = ((index & 0x0f0f0f0fu) << 4) | ((index & 0xf0f0f0f0u) >> 4);
+    index = ((index & 0x33333333u) << 2) | ((index & 0xccccccccu) >> 2);
+    index = ((index & 0x55555555u) << 1) | ((index & 0xaaaaaaaau) >> 1);
+    return index;
+}
+
+static unsigned int sobol( unsigned int index )
+{
+    unsigned int value = 0;
+    for ( unsigned int direction = 1u << 31; index; index >>= 1, direction ^= direction >> 1 )
+    {
+        if ( index & 1 )
+        {
+            value ^= direction;
+        }
+    }
+    return value;
+}
+
+static math::vec2 concentric_disk( float u, float v )
+{
+    // Maps concentric squares to concentric circles (Shirley and Chiu) so
+    // that strata of the square stay compact on the disk.
+    const float a = 2.0f * u - 1.0f;
+    const float b = 2.0f * v - 1.0f;
+    if ( a == 0.0f && b == 0.0f )
+    {
+        return vec2( 0.0f, 0.0f );
+    }
+    const float QUARTER_PI = 0.25f * float(M_PI);
+    const float r = fabsf(a) > fabsf(b) ? a : b;
+    const float phi = fabsf(a) > fabsf(b) ? QUARTER_PI * (b / a) : 2.0f * QUARTER_PI - QUARTER_PI * (a / b);
+    return vec2( r * cosf(phi), r * sinf(phi) );
+}
+
+static int largest_divisor( int value, int maximum )
+{
+    int divisor = 1;
+    for ( int i = 2; i <= std::min(value, maximum); ++i )
+    {
+        if ( value % i == 0 )
+        {
+            divisor = i;
+        }
+    }
+    return divisor;
+}
+
+static void jittered_offsets( unsigned int seed, int nx, int ny, float* xs, float* ys )
+{
+    for ( int i = 0; i < nx * ny; ++i )
+    {
+        xs[i] = random_float( seed, 2 * i + 0 );
+        ys[i] = random_float( seed, 2 * i + 1 );
+    }
+}
+
+static void shuffle( unsigned int seed, int* values, int count )
+{
+    for ( int i = count - 1; i > 0; --i )
+    {
+        int j = int(hash(seed ^ hash(i)) % unsigned(i + 1));
+        std::swap( values[i], values[j] );
+    }
+}
+
+static void multi_jittered_offsets( unsigned int seed, int nx, int ny, float* xs, float* ys )
+{
+    // Each sample is placed in its own nx * ny sub-stratum of its stratum so
+    // that no two samples in the pixel share a sub-stratum across or down.
+    // Shuffling the sub-strata within each column (across) and within each
+    // row (down) keeps that property while decorrelating the strata.
+    vector<int> permutation( max(nx, ny) );
+    for ( int i = 0; i < nx; ++i )
+    {
+        for ( int j = 0; j < ny; ++j )
+        {
+            permutation[j] = j;
+        }
+        shuffle( hash(seed ^ 0x5bd1e995u ^ hash(i)), &permutation[0], ny );
+        for ( int j = 0; j < ny; ++j )
+        {
+            xs[j * nx + i] = (float(permutation[j]) + random_float(seed, 2 * (j * nx + i) + 0)) / float(ny);
+        }
+    }
+    for ( int j = 0; j < ny; ++j )
+    {
+        for ( int i = 0; i < nx; ++i )
+        {
+            permutation[i] = i;
+        }
+        shuffle( hash(seed ^ 0x68e31da4u ^ hash(j)), &permutation[0], nx );
+        for ( int i = 0; i < nx; ++i )
+        {
+            ys[j * nx + i] = (float(permutation[i]) + random_float(seed, 2 * (j * nx + i) + 1)) / float(nx);
+        }
+    }
+}
+
+static void low_discrepancy_offsets( unsigned int seed, int nx, int ny, float* xs, float* ys )
+{
+    // The first nx * ny points of a (0,2)-sequence form a (0,m,2)-net so when
+    // nx and ny are powers of two exactly one point falls in each stratum.
+    // Scrambling the digits of the points with random bits preserves that.
+    const int x_exponent = power_of_two_exponent( nx );
+    const int y_exponent = power_of_two_exponent( ny );
+    REYES_ASSERT( x_exponent >= 0 && y_exponent >= 0 );
+    const unsigned int x_scramble = hash( seed ^ 0x2545f491u );
+    const unsigned int y_scramble = hash( seed ^ 0x9e3779b9u );
+    for ( int i = 0; i < nx * ny; ++i )
+    {
+        const unsigned int x = van_der_corput( unsigned(i) ) ^ x_scramble;
+        const unsigned int y = sobol( unsigned(i) ) ^ y_scramble;
+        const int stratum_x = x_exponent > 0 ? int(x >> (32 - x_exponent)) : 0;
+        const int stratum_y = y_exponent > 0 ? int(y >> (32 - y_exponent)) : 0;
+        xs[stratum_y * nx + stratum_x] = float((x << x_exponent) >> 8) * (1.0f / 16777216.0f);
+        ys[stratum_y * nx + stratum_x] = float((y << y_exponent) >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+SampleBuffer::SampleBuffer( int horizontal_resolution, int vertical_resolution, int horizontal_sampling_rate, int vertical_sampling_rate, float filter_width, float filter_height, int bucket_width, int bucket_height, SamplePattern sample_pattern, float opacity_threshold, int maximum_visible_points, int output_elements )
 : horizontal_resolution_( horizontal_resolution )
 , vertical_resolution_( vertical_resolution )
 , horizontal_sampling_rate_( horizontal_sampling_rate )
@@ -29,40 +193,91 @@ SampleBuffer::SampleBuffer( int horizontal_resolution, int vertical_resolution,
 , filter_height_( filter_height )
 , width_( (horizontal_resolution + int(ceilf(filter_width - 0.5f))) * horizontal_sampling_rate )
 , height_( (vertical_resolution + int(ceilf(filter_height - 0.5f))) * vertical_sampling_rate )
+, bucket_x0_( 0 )
+, bucket_x1_( 0 )
+, bucket_y0_( 0 )
+, bucket_y1_( 0 )
+, x0_( 0 )
+, x1_( 0 )
+, y0_( 0 )
+, y1_( 0 )
+, sample_pattern_( sample_pattern )
+, offsets_width_( 0 )
+, offsets_height_( 0 )
+, offsets_stride_( 0 )
+, horizontal_offsets_()
+, vertical_offsets_()
+, time_bins_( 1 )
+, times_()
+, time_bin_samples_()
+, lens_bins_( 1 )
+, lens_positions_()
+, lens_bin_samples_()
+, lens_bounds_()
+, separable_filter_( false )
+, filter_samples_width_( 0 )
+, filter_samples_height_( 0 )
+, filter_phases_( 1 )
+, filter_weights_()
+, horizontal_filter_weights_()
+, vertical_filter_weights_()
+, filter_normalizations_()
 , colors_( nullptr )
 , depths_( nullptr )
-, positions_( nullptr )
+, output_elements_( output_elements )
+, outputs_( nullptr )
+, depth_pyramid_( nullptr )
+, visible_points_( nullptr )
 {
     REYES_ASSERT( width_ > 0 );
     REYES_ASSERT( height_ > 0 );
+    REYES_ASSERT( bucket_width >= 0 );
+    REYES_ASSERT( bucket_height >= 0 );
+    REYES_ASSERT( output_elements >= 0 );
 
-    colors_ = new ImageBuffer( width_, height_, 4, FORMAT_F32 );
-    depths_ = new ImageBuffer( width_, height_, 1, FORMAT_F32 );
-    positions_ = new ImageBuffer( width_, height_, 4, FORMAT_F32 );
-    
-    float* depths = depths_->f32_data();
-    for ( int i = 0; i < width_ * height_; ++i )
+    depth_pyramid_ = new DepthPyramid;
+    visible_points_ = new VisiblePoints( maximum_visible_points, opacity_threshold );
+    calculate_offsets();
+    calculate_times();
+    calculate_lens_positions();
+
+    // Only the samples that are filtered into a single bucket are stored so
+    // the buffers need to cover a bucket plus the filter overlap on its
+    // right and bottom edges.  A bucket width or height of zero stores every
+    // sample in the frame.
+    if ( bucket_width > 0 && bucket_height > 0 )
     {
-        depths[i] = FLT_MAX;
+        bucket_width = std::min( bucket_width, horizontal_resolution_ );
+        bucket_height = std::min( bucket_height, vertical_resolution_ );
+        samples_for_pixels( 0, 0, bucket_width, bucket_height, &x0_, &y0_, &x1_, &y1_ );
+        colors_ = new ImageBuffer( x1_ - x0_, y1_ - y0_, 4, FORMAT_F32 );
+        depths_ = new ImageBuffer( x1_ - x0_, y1_ - y0_, 1, FORMAT_F32 );
+        outputs_ = output_elements_ > 0 ? new ImageBuffer( x1_ - x0_, y1_ - y0_, output_elements_, FORMAT_F32 ) : nullptr;
+        set_bucket( 0, 0, bucket_width, bucket_height );
     }
-    
-    float* positions = positions_->f32_data();
-    for ( int y = 0; y < height_; ++y )
+    else
     {
-        for ( int x = 0; x < width_; ++x )
-        {
-            positions[(y * width_ + x) * 4 + 0] = float(x);
-            positions[(y * width_ + x) * 4 + 1] = float(y);
-            positions[(y * width_ + x) * 4 + 2] = 0.0f;
-            positions[(y * width_ + x) * 4 + 3] = 0.0f;
-        }
+        colors_ = new ImageBuffer( width_, height_, 4, FORMAT_F32 );
+        depths_ = new ImageBuffer( width_, height_, 1, FORMAT_F32 );
+        outputs_ = output_elements_ > 0 ? new ImageBuffer( width_, height_, output_elements_, FORMAT_F32 ) : nullptr;
+        bucket_x1_ = horizontal_resolution_;
+        bucket_y1_ = vertical_resolution_;
+        x1_ = width_;
+        y1_ = height_;
+        clear();
     }
 }
 
 SampleBuffer::~SampleBuffer()
 {
-    delete positions_;
-    positions_ = nullptr;
+    delete visible_points_;
+    visible_points_ = nullptr;
+
+    delete depth_pyramid_;
+    depth_pyramid_ = nullptr;
+
+    delete outputs_;
+    outputs_ = nullptr;
 
     delete depths_;
     depths_ = nullptr;
@@ -81,28 +296,239 @@ int SampleBuffer::height() const
     return height_;
 }
 
+int SampleBuffer::horizontal_sampling_rate() const
+{
+    return horizontal_sampling_rate_;
+}
+
+int SampleBuffer::vertical_sampling_rate() const
+{
+    return vertical_sampling_rate_;
+}
+
+int SampleBuffer::x0() const
+{
+    return x0_;
+}
+
+int SampleBuffer::x1() const
+{
+    return x1_;
+}
+
+int SampleBuffer::y0() const
+{
+    return y0_;
+}
+
+int SampleBuffer::y1() const
+{
+    return y1_;
+}
+
+void SampleBuffer::set_bucket( int x0, int y0, int x1, int y1 )
+{
+    REYES_ASSERT( x0 >= 0 && x0 < x1 && x1 <= horizontal_resolution_ );
+    REYES_ASSERT( y0 >= 0 && y0 < y1 && y1 <= vertical_resolution_ );
+
+    bucket_x0_ = x0;
+    bucket_x1_ = x1;
+    bucket_y0_ = y0;
+    bucket_y1_ = y1;
+    samples_for_pixels( x0, y0, x1, y1, &x0_, &y0_, &x1_, &y1_ );
+    REYES_ASSERT( x1_ - x0_ <= colors_->width() );
+    REYES_ASSERT( y1_ - y0_ <= colors_->height() );
+    clear();
+}
+
 float* SampleBuffer::color( int x, int y ) const
 {
-    REYES_ASSERT( x >= 0 && x < width_ );
-    REYES_ASSERT( y >= 0 && y < height_ );
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
     REYES_ASSERT( colors_ );
-    return colors_->f32_data( x, y );
+    return colors_->f32_data( x - x0_, y - y0_ );
 }
 
 float* SampleBuffer::depth( int x, int y ) const
 {
-    REYES_ASSERT( x >= 0 && x < width_ );
-    REYES_ASSERT( y >= 0 && y < height_ );
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    REYES_ASSERT( depths_ );
+    return depths_->f32_data( x - x0_, y - y0_ );
+}
+
+int SampleBuffer::output_elements() const
+{
+    return output_elements_;
+}
+
+float* SampleBuffer::output( int x, int y ) const
+{
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    REYES_ASSERT( outputs_ );
+    return outputs_->f32_data( x - x0_, y - y0_ );
+}
+
+math::vec2 SampleBuffer::position( int x, int y ) const
+{
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    const int index = (y % offsets_height_) * offsets_stride_ + x % offsets_width_;
+    return vec2( float(x) + horizontal_offsets_[index], float(y) + vertical_offsets_[index] );
+}
+
+float SampleBuffer::maximum_offset() const
+{
+    return sample_pattern_ != SAMPLE_PATTERN_REGULAR ? 0.5f : 0.0f;
+}
+
+int SampleBuffer::offsets_width() const
+{
+    return offsets_width_;
+}
+
+const float* SampleBuffer::horizontal_offsets( int y ) const
+{
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    return &horizontal_offsets_[(y % offsets_height_) * offsets_stride_];
+}
+
+const float* SampleBuffer::vertical_offsets( int y ) const
+{
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    return &vertical_offsets_[(y % offsets_height_) * offsets_stride_];
+}
+
+float SampleBuffer::time( int x, int y ) const
+{
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    return times_[(y % offsets_height_) * offsets_stride_ + x % offsets_width_];
+}
+
+int SampleBuffer::time_bins() const
+{
+    return time_bins_;
+}
+
+int SampleBuffer::samples_per_time_bin() const
+{
+    return horizontal_sampling_rate_ * vertical_sampling_rate_ / time_bins_;
+}
+
+const int* SampleBuffer::time_bin_samples( int pixel_x, int pixel_y, int time_bin ) const
+{
+    REYES_ASSERT( pixel_x >= 0 && pixel_y >= 0 );
+    REYES_ASSERT( time_bin >= 0 && time_bin < time_bins_ );
+    const int samples = horizontal_sampling_rate_ * vertical_sampling_rate_;
+    const int pixel = (pixel_y % OFFSETS_TILE_SIZE) * OFFSETS_TILE_SIZE + pixel_x % OFFSETS_TILE_SIZE;
+    return &time_bin_samples_[pixel * samples + time_bin * samples_per_time_bin()];
+}
+
+math::vec2 SampleBuffer::lens_position( int x, int y ) const
+{
+    REYES_ASSERT( x >= x0_ && x < x1_ );
+    REYES_ASSERT( y >= y0_ && y < y1_ );
+    return lens_positions_[(y % offsets_height_) * offsets_stride_ + x % offsets_width_];
+}
+
+int SampleBuffer::lens_bins() const
+{
+    return lens_bins_;
+}
+
+int SampleBuffer::samples_per_lens_bin() const
+{
+    return horizontal_sampling_rate_ * vertical_sampling_rate_ / lens_bins_;
+}
+
+const int* SampleBuffer::lens_bin_samples( int pixel_x, int pixel_y, int lens_bin ) const
+{
+    REYES_ASSERT( pixel_x >= 0 && pixel_y >= 0 );
+    REYES_ASSERT( lens_bin >= 0 && lens_bin < lens_bins_ );
+    const int samples = horizontal_sampling_rate_ * vertical_sampling_rate_;
+    const int pixel = (pixel_y % OFFSETS_TILE_SIZE) * OFFSETS_TILE_SIZE + pixel_x % OFFSETS_TILE_SIZE;
+    return &lens_bin_samples_[pixel * samples + lens_bin * samples_per_lens_bin()];
+}
+
+const math::vec4& SampleBuffer::lens_bound( int lens_bin ) const
+{
+    REYES_ASSERT( lens_bin >= 0 && lens_bin < lens_bins_ );
+    return lens_bounds_[lens_bin];
+}
+
+float SampleBuffer::opacity_threshold() const
+{
+    REYES_ASSERT( visible_points_ );
+    return visible_points_->opacity_threshold();
+}
+
+void SampleBuffer::insert_visible_point( int x, int y, float depth, const math::vec3& color, const math::vec3& opacity )
+{
+    REYES_ASSERT( visible_points_ );
+    float* opaque_depth = SampleBuffer::depth( x, y );
+    const float depth_at_threshold = visible_points_->insert( x - x0_, y - y0_, depth, color, opacity, *opaque_depth );
+    if ( depth_at_threshold < *opaque_depth )
+    {
+        // The sample is opaque at the point where its accumulated opacity
+        // passed the threshold so nothing behind that point contributes.
+        float* color = SampleBuffer::color( x, y );
+        color[0] = 0.0f;
+        color[1] = 0.0f;
+        color[2] = 0.0f;
+        color[3] = 0.0f;
+        if ( outputs_ )
+        {
+            memset( SampleBuffer::output(x, y), 0, sizeof(float) * output_elements_ );
+        }
+        *opaque_depth = depth_at_threshold;
+    }
+}
+
+void SampleBuffer::composite()
+{
+    REYES_ASSERT( visible_points_ );
+    if ( !visible_points_->empty() )
+    {
+        for ( int y = y0_; y < y1_; ++y )
+        {
+            for ( int x = x0_; x < x1_; ++x )
+            {
+                float* color = SampleBuffer::color( x, y );
+                const vec4 composited = visible_points_->composite( x - x0_, y - y0_, *SampleBuffer::depth(x, y), vec4(color[0], color[1], color[2], color[3]) );
+                color[0] = composited.x;
+                color[1] = composited.y;
+                color[2] = composited.z;
+                color[3] = composited.w;
+            }
+        }
+        visible_points_->reset( x1_ - x0_, y1_ - y0_ );
+    }
+}
+
+void SampleBuffer::update_depths( int x0, int y0, int x1, int y1 )
+{
+    REYES_ASSERT( depth_pyramid_ );
     REYES_ASSERT( depths_ );
-    return depths_->f32_data( x, y );
+    depth_pyramid_->update( depths_->f32_data(), depths_->width(), x0 - x0_, y0 - y0_, x1 - x0_, y1 - y0_ );
+}
+
+bool SampleBuffer::occluded( int x0, int y0, int x1, int y1, float depth ) const
+{
+    REYES_ASSERT( depth_pyramid_ );
+    return depth_pyramid_->occluded( x0 - x0_, y0 - y0_, x1 - x0_, y1 - y0_, depth );
 }
 
-float* SampleBuffer::position( int x, int y ) const
+void SampleBuffer::samples_for_pixels( int x0, int y0, int x1, int y1, int* sample_x0, int* sample_y0, int* sample_x1, int* sample_y1 ) const
 {
-    REYES_ASSERT( x >= 0 && x < width_ );
-    REYES_ASSERT( y >= 0 && y < height_ );
-    REYES_ASSERT( positions_ );
-    return positions_->f32_data( x, y );
+    REYES_ASSERT( sample_x0 && sample_y0 && sample_x1 && sample_y1 );
+    int half_filter_width = int(ceilf(filter_width_ / 2.0f - 0.5f));
+    int half_filter_height = int(ceilf(filter_height_ / 2.0f - 0.5f));
+    *sample_x0 = x0 * horizontal_sampling_rate_;
+    *sample_x1 = std::min( width_, (x1 - 1 + max(1, 2 * half_filter_width)) * horizontal_sampling_rate_ );
+    *sample_y0 = y0 * vertical_sampling_rate_;
+    *sample_y1 = std::min( height_, (y1 - 1 + max(1, 2 * half_filter_height)) * vertical_sampling_rate_ );
 }
 
 void SampleBuffer::save( int mode, const char* filename ) const
@@ -141,44 +567,210 @@ void SampleBuffer::save_png( int mode, const char* filename, ErrorPolicy* error_
     quantized_image_buffer.save_png( filename );
 }
 
-void SampleBuffer::filter( float (*filter_function)(float, float, float, float), ImageBuffer* image_buffer ) const
+void SampleBuffer::set_filter( float (*filter_function)(float, float, float, float), bool separable )
 {
     REYES_ASSERT( filter_function );
-    REYES_ASSERT( image_buffer );
 
-    float horizontal_sampling_rate = float(horizontal_sampling_rate_);
-    float vertical_sampling_rate = float(vertical_sampling_rate_);
-    int half_filter_width = int(ceilf(filter_width_ / 2.0f - 0.5f));
-    int half_filter_height = int(ceilf(filter_height_ / 2.0f - 0.5f));
+    // Samples on the regular lattice sit at the same positions relative to
+    // every pixel and separable filters are applied across and then down.
+    // Otherwise the weights repeat with the tile of sample offsets and are
+    // looked up by each pixel's position within that tile.
+    calculate_filter_weights( filter_function, separable && sample_pattern_ == SAMPLE_PATTERN_REGULAR );
+}
+
+void SampleBuffer::filter( int y0, int y1, vector<vec4>* pixels ) const
+{
+    REYES_ASSERT( pixels );
+    REYES_ASSERT( y0 >= bucket_y0_ && y0 <= y1 && y1 <= bucket_y1_ );
+    REYES_ASSERT( !filter_normalizations_.empty() );
 
-    image_buffer->reset( horizontal_resolution_, vertical_resolution_, 4, FORMAT_F32 );
-    for ( int y = 0; y < vertical_resolution_; ++y )
+    const int width = bucket_x1_ - bucket_x0_;
+    pixels->resize( max(width * (y1 - y0), 0) );
+    if ( pixels->empty() )
     {
-        for ( int x = 0; x < horizontal_resolution_; ++x )
+        return;
+    }
+
+    if ( separable_filter_ )
+    {
+        filter_separable( y0, y1, &(*pixels)[0] );
+        return;
+    }
+
+    const int filter_samples_width = filter_samples_width_;
+    const int filter_samples_height = filter_samples_height_;
+    const int filter_samples = filter_samples_width * filter_samples_height;
+    vec4* filtered_pixel = &(*pixels)[0];
+    for ( int y = y0; y < y1; ++y )
+    {
+        const int sample_y0 = y * vertical_sampling_rate_;
+        const int phase_y = y % filter_phases_;
+        for ( int x = bucket_x0_; x < bucket_x1_; ++x, ++filtered_pixel )
         {
-            float px = float(x + half_filter_width) * horizontal_sampling_rate + horizontal_sampling_rate / 2.0f - 0.5f;
-            float py = float(y + half_filter_height) * vertical_sampling_rate + vertical_sampling_rate / 2.0f - 0.5f;
-            
-            int x0 = x * horizontal_sampling_rate_;
-            int x1 = x0 + max(1, 2 * half_filter_width) * horizontal_sampling_rate_;
-            int y0 = y * vertical_sampling_rate_;
-            int y1 = y0 + max(1, 2 * half_filter_height) * vertical_sampling_rate_;
-            
-            float area = 0.0f;
+            const int sample_x0 = x * horizontal_sampling_rate_;
+            const int phase = phase_y * filter_phases_ + x % filter_phases_;
+            const float* weight = &filter_weights_[phase * filter_samples];
             vec4 pixel = vec4( 0.0f, 0.0f, 0.0f, 0.0f );
-            for ( int yy = y0; yy < y1; ++yy )
+            for ( int yy = sample_y0; yy < sample_y0 + filter_samples_height; ++yy )
             {
-                for ( int xx = x0; xx < x1; ++xx )
+                const float* color = SampleBuffer::color( sample_x0, yy );
+                for ( int xx = 0; xx < filter_samples_width; ++xx, ++weight, color += 4 )
                 {
-                    const float* color = SampleBuffer::color( xx, yy );
-                    float weight = (*filter_function)( float(xx) - px, float(yy) - py, filter_width_, filter_height_ );
-                    area += weight;
-                    pixel += weight * vec4( color[0], color[1], color[2], color[3] );
+                    pixel += *weight * vec4( color[0], color[1], color[2], color[3] );
                 }
             }
-            pixel = 1.0f / area * pixel;
+            pixel = filter_normalizations_[phase] * pixel;
+            pixel.w = 1.0f;
+            *filtered_pixel = pixel;
+        }
+    }
+}
+
+void SampleBuffer::filter_separable( int y0, int y1, vec4* pixels ) const
+{
+    REYES_ASSERT( pixels );
+    REYES_ASSERT( separable_filter_ );
+
+    // Filter every row of samples under the rows of pixels across into one
+    // value per pixel and then filter those values down.
+    const int width = bucket_x1_ - bucket_x0_;
+    const int row0 = y0 * vertical_sampling_rate_;
+    const int rows = (y1 - y0 - 1) * vertical_sampling_rate_ + filter_samples_height_;
+    vector<vec4> filtered_rows( rows * width );
+    for ( int row = 0; row < rows; ++row )
+    {
+        vec4* filtered = &filtered_rows[row * width];
+        for ( int x = bucket_x0_; x < bucket_x1_; ++x )
+        {
+            const float* color = SampleBuffer::color( x * horizontal_sampling_rate_, row0 + row );
+            vec4 pixel = vec4( 0.0f, 0.0f, 0.0f, 0.0f );
+            for ( int i = 0; i < filter_samples_width_; ++i, color += 4 )
+            {
+                pixel += horizontal_filter_weights_[i] * vec4( color[0], color[1], color[2], color[3] );
+            }
+            filtered[x - bucket_x0_] = pixel;
+        }
+    }
+
+    const float normalization = filter_normalizations_[0];
+    for ( int y = y0; y < y1; ++y )
+    {
+        const int row = (y - y0) * vertical_sampling_rate_;
+        for ( int x = 0; x < width; ++x, ++pixels )
+        {
+            const vec4* filtered = &filtered_rows[row * width + x];
+            vec4 pixel = vec4( 0.0f, 0.0f, 0.0f, 0.0f );
+            for ( int j = 0; j < filter_samples_height_; ++j, filtered += width )
+            {
+                pixel += vertical_filter_weights_[j] * *filtered;
+            }
+            pixel = normalization * pixel;
             pixel.w = 1.0f;
-            image_buffer->set_pixel( x, y, pixel );
+            *pixels = pixel;
+        }
+    }
+}
+
+void SampleBuffer::filter_outputs( int y0, int y1, vector<float>* pixels ) const
+{
+    REYES_ASSERT( pixels );
+    REYES_ASSERT( y0 >= bucket_y0_ && y0 <= y1 && y1 <= bucket_y1_ );
+    REYES_ASSERT( !filter_normalizations_.empty() );
+
+    const int elements = output_elements_;
+    const int width = bucket_x1_ - bucket_x0_;
+    pixels->assign( max(width * (y1 - y0) * elements, 0), 0.0f );
+    if ( pixels->empty() )
+    {
+        return;
+    }
+
+    if ( separable_filter_ )
+    {
+        filter_outputs_separable( y0, y1, &(*pixels)[0] );
+        return;
+    }
+
+    const int filter_samples_width = filter_samples_width_;
+    const int filter_samples_height = filter_samples_height_;
+    const int filter_samples = filter_samples_width * filter_samples_height;
+    float* filtered_pixel = &(*pixels)[0];
+    for ( int y = y0; y < y1; ++y )
+    {
+        const int sample_y0 = y * vertical_sampling_rate_;
+        const int phase_y = y % filter_phases_;
+        for ( int x = bucket_x0_; x < bucket_x1_; ++x, filtered_pixel += elements )
+        {
+            const int sample_x0 = x * horizontal_sampling_rate_;
+            const int phase = phase_y * filter_phases_ + x % filter_phases_;
+            const float* weight = &filter_weights_[phase * filter_samples];
+            for ( int yy = sample_y0; yy < sample_y0 + filter_samples_height; ++yy )
+            {
+                const float* output = SampleBuffer::output( sample_x0, yy );
+                for ( int xx = 0; xx < filter_samples_width; ++xx, ++weight, output += elements )
+                {
+                    for ( int element = 0; element < elements; ++element )
+                    {
+                        filtered_pixel[element] += *weight * output[element];
+                    }
+                }
+            }
+
+            const float normalization = filter_normalizations_[phase];
+            for ( int element = 0; element < elements; ++element )
+            {
+                filtered_pixel[element] *= normalization;
+            }
+        }
+    }
+}
+
+void SampleBuffer::filter_outputs_separable( int y0, int y1, float* pixels ) const
+{
+    REYES_ASSERT( pixels );
+    REYES_ASSERT( separable_filter_ );
+
+    const int elements = output_elements_;
+    const int width = bucket_x1_ - bucket_x0_;
+    const int row0 = y0 * vertical_sampling_rate_;
+    const int rows = (y1 - y0 - 1) * vertical_sampling_rate_ + filter_samples_height_;
+    vector<float> filtered_rows( rows * width * elements, 0.0f );
+    for ( int row = 0; row < rows; ++row )
+    {
+        float* filtered = &filtered_rows[row * width * elements];
+        for ( int x = bucket_x0_; x < bucket_x1_; ++x, filtered += elements )
+        {
+            const float* output = SampleBuffer::output( x * horizontal_sampling_rate_, row0 + row );
+            for ( int i = 0; i < filter_samples_width_; ++i, output += elements )
+            {
+                for ( int element = 0; element < elements; ++element )
+                {
+                    filtered[element] += horizontal_filter_weights_[i] * output[element];
+                }
+            }
+        }
+    }
+
+    const float normalization = filter_normalizations_[0];
+    const int stride = width * elements;
+    for ( int y = y0; y < y1; ++y )
+    {
+        const int row = (y - y0) * vertical_sampling_rate_;
+        for ( int x = 0; x < width; ++x, pixels += elements )
+        {
+            const float* filtered = &filtered_rows[row * stride + x * elements];
+            for ( int j = 0; j < filter_samples_height_; ++j, filtered += stride )
+            {
+                for ( int element = 0; element < elements; ++element )
+                {
+                    pixels[element] += vertical_filter_weights_[j] * filtered[element];
+                }
+            }
+
+            for ( int element = 0; element < elements; ++element )
+            {
+                pixels[element] *= normalization;
+            }
         }
     }
 }
@@ -191,13 +783,16 @@ void SampleBuffer::pack( int mode, ImageBuffer* image_buffer ) const
     bool alpha = (mode & DISPLAY_MODE_A) != 0;
     bool depth = (mode & DISPLAY_MODE_Z) != 0;
     int elements = 3 * rgb + alpha + depth;
-    const float* colors = colors_->f32_data();
-    const float* depths = depths_->f32_data();
+    const int width = x1_ - x0_;
+    const int height = y1_ - y0_;
    
-    image_buffer->reset( width_, height_, elements, FORMAT_F32 );    
+    image_buffer->reset( width, height, elements, FORMAT_F32 );    
     float* data = image_buffer->f32_data();
-    for ( int i = 0; i < width_ * height_; ++i )
+    for ( int i = 0; i < width * height; ++i )
     {
+        const float* colors = colors_->f32_data( i % width, i / width );
+        const float* depths = depths_->f32_data( i % width, i / width );
+
         if ( rgb )
         {
             data[0] = colors[0];
@@ -217,8 +812,285 @@ void SampleBuffer::pack( int mode, ImageBuffer* image_buffer ) const
             data[0] = depths[0];
             data += 1;
         }
-        
-        colors += 4;
-        depths += 1;
+    }
+}
+
+void SampleBuffer::clear()
+{
+    const int stride = colors_->width();
+    float* colors = colors_->f32_data();
+    float* depths = depths_->f32_data();
+    for ( int y = y0_; y < y1_; ++y )
+    {
+        for ( int x = x0_; x < x1_; ++x )
+        {
+            int i = (y - y0_) * stride + (x - x0_);
+            colors[i * 4 + 0] = 0.0f;
+            colors[i * 4 + 1] = 0.0f;
+            colors[i * 4 + 2] = 0.0f;
+            colors[i * 4 + 3] = 0.0f;
+            depths[i] = FLT_MAX;
+        }
+    }
+    if ( outputs_ )
+    {
+        for ( int y = y0_; y < y1_; ++y )
+        {
+            memset( output(x0_, y), 0, sizeof(float) * output_elements_ * (x1_ - x0_) );
+        }
+    }
+    depth_pyramid_->reset( x1_ - x0_, y1_ - y0_ );
+    visible_points_->reset( x1_ - x0_, y1_ - y0_ );
+}
+
+void SampleBuffer::calculate_offsets()
+{
+    const int nx = horizontal_sampling_rate_;
+    const int ny = vertical_sampling_rate_;
+    offsets_width_ = OFFSETS_TILE_SIZE * nx;
+    offsets_height_ = OFFSETS_TILE_SIZE * ny;
+    offsets_stride_ = offsets_width_ + OFFSETS_PADDING;
+    horizontal_offsets_.assign( offsets_stride_ * offsets_height_, 0.0f );
+    vertical_offsets_.assign( offsets_stride_ * offsets_height_, 0.0f );
+
+    SamplePattern sample_pattern = sample_pattern_;
+    if ( sample_pattern == SAMPLE_PATTERN_LOW_DISCREPANCY && (power_of_two_exponent(nx) < 0 || power_of_two_exponent(ny) < 0) )
+    {
+        sample_pattern = SAMPLE_PATTERN_MULTI_JITTERED;
+    }
+
+    if ( sample_pattern == SAMPLE_PATTERN_REGULAR )
+    {
+        return;
+    }
+
+    // Offsets are generated from each pixel's position in the tile so that
+    // the same pixel always gets the same pattern.
+    vector<float> xs( nx * ny );
+    vector<float> ys( nx * ny );
+    for ( int pixel_y = 0; pixel_y < OFFSETS_TILE_SIZE; ++pixel_y )
+    {
+        for ( int pixel_x = 0; pixel_x < OFFSETS_TILE_SIZE; ++pixel_x )
+        {
+            const unsigned int seed = hash( unsigned(pixel_x) + hash(unsigned(pixel_y) + hash(unsigned(sample_pattern))) );
+            switch ( sample_pattern )
+            {
+                case SAMPLE_PATTERN_JITTERED:
+                    jittered_offsets( seed, nx, ny, &xs[0], &ys[0] );
+                    break;
+
+                case SAMPLE_PATTERN_MULTI_JITTERED:
+                    multi_jittered_offsets( seed, nx, ny, &xs[0], &ys[0] );
+                    break;
+
+                case SAMPLE_PATTERN_LOW_DISCREPANCY:
+                    low_discrepancy_offsets( seed, nx, ny, &xs[0], &ys[0] );
+                    break;
+
+                default:
+                    REYES_ASSERT( false );
+                    break;
+            }
+
+            for ( int j = 0; j < ny; ++j )
+            {
+                for ( int i = 0; i < nx; ++i )
+                {
+                    const int index = (pixel_y * ny + j) * offsets_stride_ + pixel_x * nx + i;
+                    horizontal_offsets_[index] = std::min( xs[j * nx + i], ONE_MINUS_EPSILON ) - 0.5f;
+                    vertical_offsets_[index] = std::min( ys[j * nx + i], ONE_MINUS_EPSILON ) - 0.5f;
+                }
+            }
+        }
+    }
+
+    for ( int y = 0; y < offsets_height_; ++y )
+    {
+        for ( int x = 0; x < OFFSETS_PADDING; ++x )
+        {
+            const int index = y * offsets_stride_;
+            horizontal_offsets_[index + offsets_width_ + x] = horizontal_offsets_[index + x % offsets_width_];
+            vertical_offsets_[index + offsets_width_ + x] = vertical_offsets_[index + x % offsets_width_];
+        }
+    }
+}
+
+void SampleBuffer::calculate_times()
+{
+    const int nx = horizontal_sampling_rate_;
+    const int ny = vertical_sampling_rate_;
+    const int samples = nx * ny;
+    time_bins_ = largest_divisor( samples, MAXIMUM_TIME_BINS );
+    times_.assign( offsets_stride_ * offsets_height_, 0.0f );
+    time_bin_samples_.assign( OFFSETS_TILE_SIZE * OFFSETS_TILE_SIZE * samples, 0 );
+
+    // The samples in each pixel are given one stratum each of the shutter 
+    // interval in a random order so that time isn't correlated with position.
+    // Listing each pixel's samples in stratum order leaves the samples in 
+    // each time bin next to each other.
+    vector<int> strata( samples );
+    for ( int pixel_y = 0; pixel_y < OFFSETS_TILE_SIZE; ++pixel_y )
+    {
+        for ( int pixel_x = 0; pixel_x < OFFSETS_TILE_SIZE; ++pixel_x )
+        {
+            const unsigned int seed = hash( unsigned(pixel_x) + hash(unsigned(pixel_y) + hash(0x74696d65u)) );
+            for ( int k = 0; k < samples; ++k )
+            {
+                strata[k] = k;
+            }
+            shuffle( seed, &strata[0], samples );
+
+            int* time_bin_samples = &time_bin_samples_[(pixel_y * OFFSETS_TILE_SIZE + pixel_x) * samples];
+            for ( int k = 0; k < samples; ++k )
+            {
+                const float jitter = sample_pattern_ != SAMPLE_PATTERN_REGULAR ? random_float( seed, k ) : 0.5f;
+                const int index = (pixel_y * ny + k / nx) * offsets_stride_ + pixel_x * nx + k % nx;
+                times_[index] = std::min( (float(strata[k]) + jitter) / float(samples), ONE_MINUS_EPSILON );
+                time_bin_samples[strata[k]] = k;
+            }
+        }
+    }
+}
+
+void SampleBuffer::calculate_lens_positions()
+{
+    // The lens is divided into one stratum for each sample in a pixel, 
+    // nx across by ny down, and neighbouring strata are grouped into lens 
+    // bins of equal numbers of strata.
+    const int nx = horizontal_sampling_rate_;
+    const int ny = vertical_sampling_rate_;
+    const int samples = nx * ny;
+    int lens_bins_x = 1;
+    int lens_bins_y = 1;
+    for ( int bins_x = 1; bins_x <= nx; ++bins_x )
+    {
+        const int bins_y = largest_divisor( ny, MAXIMUM_LENS_BINS / bins_x );
+        if ( nx % bins_x == 0 && bins_x * bins_y > lens_bins_x * lens_bins_y )
+        {
+            lens_bins_x = bins_x;
+            lens_bins_y = bins_y;
+        }
+    }
+    lens_bins_ = lens_bins_x * lens_bins_y;
+    lens_positions_.assign( offsets_stride_ * offsets_height_, vec2(0.0f, 0.0f) );
+    lens_bin_samples_.assign( OFFSETS_TILE_SIZE * OFFSETS_TILE_SIZE * samples, 0 );
+    lens_bounds_.assign( lens_bins_, vec4(FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX) );
+
+    // Samples are given lens strata in a random order, independent of their
+    // times, so that lens position isn't correlated with position in the
+    // pixel or with time.
+    const int samples_per_lens_bin = samples / lens_bins_;
+    vector<int> strata( samples );
+    vector<int> counts( lens_bins_ );
+    for ( int pixel_y = 0; pixel_y < OFFSETS_TILE_SIZE; ++pixel_y )
+    {
+        for ( int pixel_x = 0; pixel_x < OFFSETS_TILE_SIZE; ++pixel_x )
+        {
+            const unsigned int seed = hash( unsigned(pixel_x) + hash(unsigned(pixel_y) + hash(0x6c656e73u)) );
+            for ( int k = 0; k < samples; ++k )
+            {
+                strata[k] = k;
+            }
+            shuffle( seed, &strata[0], samples );
+            counts.assign( lens_bins_, 0 );
+
+            int* lens_bin_samples = &lens_bin_samples_[(pixel_y * OFFSETS_TILE_SIZE + pixel_x) * samples];
+            for ( int k = 0; k < samples; ++k )
+            {
+                const int stratum_x = strata[k] % nx;
+                const int stratum_y = strata[k] / nx;
+                const float jitter_x = sample_pattern_ != SAMPLE_PATTERN_REGULAR ? random_float( seed, 2 * k + 0 ) : 0.5f;
+                const float jitter_y = sample_pattern_ != SAMPLE_PATTERN_REGULAR ? random_float( seed, 2 * k + 1 ) : 0.5f;
+                const float u = std::min( (float(stratum_x) + jitter_x) / float(nx), ONE_MINUS_EPSILON );
+                const float v = std::min( (float(stratum_y) + jitter_y) / float(ny), ONE_MINUS_EPSILON );
+                const vec2 lens_position = concentric_disk( u, v );
+                const int index = (pixel_y * ny + k / nx) * offsets_stride_ + pixel_x * nx + k % nx;
+                lens_positions_[index] = lens_position;
+
+                const int lens_bin = (stratum_y * lens_bins_y / ny) * lens_bins_x + stratum_x * lens_bins_x / nx;
+                lens_bin_samples[lens_bin * samples_per_lens_bin + counts[lens_bin]] = k;
+                ++counts[lens_bin];
+
+                vec4& lens_bound = lens_bounds_[lens_bin];
+                lens_bound.x = std::min( lens_bound.x, lens_position.x );
+                lens_bound.y = std::max( lens_bound.y, lens_position.x );
+                lens_bound.z = std::min( lens_bound.z, lens_position.y );
+                lens_bound.w = std::max( lens_bound.w, lens_position.y );
+            }
+        }
+    }
+}
+
+void SampleBuffer::calculate_filter_weights( float (*filter_function)(float, float, float, float), bool separable )
+{
+    REYES_ASSERT( filter_function );
+
+    separable_filter_ = separable;
+
+    // Each pixel filters the samples from its own first sample across and
+    // down a whole number of pixels with the filter centered in the middle 
+    // of that window.
+    const int half_filter_width = int(ceilf(filter_width_ / 2.0f - 0.5f));
+    const int half_filter_height = int(ceilf(filter_height_ / 2.0f - 0.5f));
+    filter_samples_width_ = max( 1, 2 * half_filter_width ) * horizontal_sampling_rate_;
+    filter_samples_height_ = max( 1, 2 * half_filter_height ) * vertical_sampling_rate_;
+    const float cx = float(half_filter_width * horizontal_sampling_rate_) + float(horizontal_sampling_rate_) / 2.0f - 0.5f;
+    const float cy = float(half_filter_height * vertical_sampling_rate_) + float(vertical_sampling_rate_) / 2.0f - 0.5f;
+
+    // A separable filter's weight at (x, y) is proportional to the product 
+    // of its weights at (x, 0) and (0, y) and the constant of proportion 
+    // cancels out when the weights are normalized.
+    if ( separable )
+    {
+        float horizontal_area = 0.0f;
+        horizontal_filter_weights_.resize( filter_samples_width_ );
+        for ( int i = 0; i < filter_samples_width_; ++i )
+        {
+            horizontal_filter_weights_[i] = (*filter_function)( float(i) - cx, 0.0f, filter_width_, filter_height_ );
+            horizontal_area += horizontal_filter_weights_[i];
+        }
+
+        float vertical_area = 0.0f;
+        vertical_filter_weights_.resize( filter_samples_height_ );
+        for ( int j = 0; j < filter_samples_height_; ++j )
+        {
+            vertical_filter_weights_[j] = (*filter_function)( 0.0f, float(j) - cy, filter_width_, filter_height_ );
+            vertical_area += vertical_filter_weights_[j];
+        }
+
+        filter_phases_ = 1;
+        filter_normalizations_.assign( 1, 1.0f / (horizontal_area * vertical_area) );
+        filter_weights_.clear();
+        return;
+    }
+
+    // Sample offsets repeat every OFFSETS_TILE_SIZE pixels so there is one
+    // table of weights for each pixel in that tile.
+    filter_phases_ = sample_pattern_ == SAMPLE_PATTERN_REGULAR ? 1 : OFFSETS_TILE_SIZE;
+    const int filter_samples = filter_samples_width_ * filter_samples_height_;
+    filter_weights_.resize( filter_phases_ * filter_phases_ * filter_samples );
+    filter_normalizations_.resize( filter_phases_ * filter_phases_ );
+    for ( int phase_y = 0; phase_y < filter_phases_; ++phase_y )
+    {
+        for ( int phase_x = 0; phase_x < filter_phases_; ++phase_x )
+        {
+            const int phase = phase_y * filter_phases_ + phase_x;
+            float* weight = &filter_weights_[phase * filter_samples];
+            float area = 0.0f;
+            for ( int j = 0; j < filter_samples_height_; ++j )
+            {
+                const int offsets_y = (phase_y * vertical_sampling_rate_ + j) % offsets_height_;
+                for ( int i = 0; i < filter_samples_width_; ++i, ++weight )
+                {
+                    const int offsets_x = (phase_x * horizontal_sampling_rate_ + i) % offsets_width_;
+                    const int index = offsets_y * offsets_stride_ + offsets_x;
+                    const float x = float(i) + horizontal_offsets_[index] - cx;
+                    const float y = float(j) + vertical_offsets_[index] - cy;
+                    *weight = (*filter_function)( x, y, filter_width_, filter_height_ );
+                    area += *weight;
+                }
+            }
+            filter_normalizations_[phase] = 1.0f / area;
+        }
     }
 }
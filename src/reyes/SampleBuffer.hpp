@@ -1,13 +1,19 @@
 #pragma once
 
+#include "SamplePattern.hpp"
+#include <math/vec2.hpp>
+#include <math/vec3.hpp>
 #include <math/vec4.hpp>
 #include <math/mat4x4.hpp>
+#include <vector>
 
 namespace reyes
 {
 
 class ErrorPolicy;
 class ImageBuffer;
+class DepthPyramid;
+class VisiblePoints;
 
 /**
 // A buffer of samples.
@@ -22,24 +28,95 @@ class SampleBuffer
     float filter_height_; ///< The number of pixels to filter in y.
     int width_; ///< The number of horiztonal samples (horizontal resolution * horizontal samples per pixel + floor((filter_width + 1) / 2)).
     int height_; ///< The number of vertical samples (vertical resolution * vertical samples per pixel + floor((filter_height + 1) / 2)).
+    int bucket_x0_; ///< The first pixel across in the current bucket.
+    int bucket_x1_; ///< One past the last pixel across in the current bucket.
+    int bucket_y0_; ///< The first pixel down in the current bucket.
+    int bucket_y1_; ///< One past the last pixel down in the current bucket.
+    int x0_; ///< The first sample across stored for the current bucket.
+    int x1_; ///< One past the last sample across stored for the current bucket.
+    int y0_; ///< The first sample down stored for the current bucket.
+    int y1_; ///< One past the last sample down stored for the current bucket.
+    SamplePattern sample_pattern_; ///< The pattern that samples are placed in within each pixel.
+    int offsets_width_; ///< The number of samples across the tile of sample offsets before it repeats.
+    int offsets_height_; ///< The number of samples down the tile of sample offsets before it repeats.
+    int offsets_stride_; ///< The number of offsets stored for each row of the tile (including padding).
+    std::vector<float> horizontal_offsets_; ///< The offset across of each sample in the tile from its integer position in sample space.
+    std::vector<float> vertical_offsets_; ///< The offset down of each sample in the tile from its integer position in sample space.
+    int time_bins_; ///< The number of equal intervals that the shutter interval is divided into to look up samples by time.
+    std::vector<float> times_; ///< The time of each sample in the tile from 0 at shutter open to 1 at shutter close (with the same layout as the offsets).
+    std::vector<int> time_bin_samples_; ///< The index of each sample within its pixel ordered by time for each pixel in the tile.
+    int lens_bins_; ///< The number of regions that the lens is divided into to look up samples by lens position.
+    std::vector<math::vec2> lens_positions_; ///< The position of each sample in the tile on the unit disk over the lens (with the same layout as the offsets).
+    std::vector<int> lens_bin_samples_; ///< The index of each sample within its pixel ordered by lens region for each pixel in the tile.
+    std::vector<math::vec4> lens_bounds_; ///< The minimum x, maximum x, minimum y, and maximum y of the lens positions in each lens region.
+    bool separable_filter_; ///< True if the filter weights are stored as separate horizontal and vertical weights.
+    int filter_samples_width_; ///< The number of samples across that are filtered into each pixel.
+    int filter_samples_height_; ///< The number of samples down that are filtered into each pixel.
+    int filter_phases_; ///< The number of pixels across and down after which the filter weights repeat.
+    std::vector<float> filter_weights_; ///< The weight of each sample filtered into a pixel for each pixel in the repeating tile.
+    std::vector<float> horizontal_filter_weights_; ///< The weight of each sample across filtered into a pixel for separable filters.
+    std::vector<float> vertical_filter_weights_; ///< The weight of each sample down filtered into a pixel for separable filters.
+    std::vector<float> filter_normalizations_; ///< The reciprocal of the sum of the filter weights for each pixel in the repeating tile.
     ImageBuffer* colors_; ///< The color of the nearest element.
     ImageBuffer* depths_; ///< The distance of the nearest element from the near plane.
-    ImageBuffer* positions_; ///< The sample position on the near plane in sample space.
+    int output_elements_; ///< The number of floats of output variables stored at each sample.
+    ImageBuffer* outputs_; ///< The output variables of the nearest opaque element (null if there are none).
+    DepthPyramid* depth_pyramid_; ///< The nearest and farthest depths of tiles of samples.
+    VisiblePoints* visible_points_; ///< The semi-transparent points in front of the nearest opaque element at each sample.
     
     public:
-        SampleBuffer( int horizontal_resolution, int vertical_resolution, int horizontal_sampling_rate, int vertical_sampling_rate, float filter_width, float filter_height );
+        SampleBuffer( int horizontal_resolution, int vertical_resolution, int horizontal_sampling_rate, int vertical_sampling_rate, float filter_width, float filter_height, int bucket_width = 0, int bucket_height = 0, SamplePattern sample_pattern = SAMPLE_PATTERN_REGULAR, float opacity_threshold = 0.996f, int maximum_visible_points = 16, int output_elements = 0 );
         ~SampleBuffer();
         
         int width() const;
         int height() const;        
+        int horizontal_sampling_rate() const;
+        int vertical_sampling_rate() const;
+        int x0() const;
+        int x1() const;
+        int y0() const;
+        int y1() const;
+        void set_bucket( int x0, int y0, int x1, int y1 );
+        void samples_for_pixels( int x0, int y0, int x1, int y1, int* sample_x0, int* sample_y0, int* sample_x1, int* sample_y1 ) const;
         float* color( int x, int y ) const;
         float* depth( int x, int y ) const;
-        float* position( int x, int y ) const;
+        int output_elements() const;
+        float* output( int x, int y ) const;
+        math::vec2 position( int x, int y ) const;
+        float maximum_offset() const;
+        int offsets_width() const;
+        const float* horizontal_offsets( int y ) const;
+        const float* vertical_offsets( int y ) const;
+        float time( int x, int y ) const;
+        int time_bins() const;
+        int samples_per_time_bin() const;
+        const int* time_bin_samples( int pixel_x, int pixel_y, int time_bin ) const;
+        math::vec2 lens_position( int x, int y ) const;
+        int lens_bins() const;
+        int samples_per_lens_bin() const;
+        const int* lens_bin_samples( int pixel_x, int pixel_y, int lens_bin ) const;
+        const math::vec4& lens_bound( int lens_bin ) const;
+        float opacity_threshold() const;
+        void insert_visible_point( int x, int y, float depth, const math::vec3& color, const math::vec3& opacity );
+        void composite();
+        void update_depths( int x0, int y0, int x1, int y1 );
+        bool occluded( int x0, int y0, int x1, int y1, float depth ) const;
         
         void save( int mode, const char* filename ) const;
         void save_png( int mode, const char* filename, ErrorPolicy* error_policy ) const;
-        void filter( float (*filter_function)(float, float, float, float), ImageBuffer* image_buffer ) const;
+        void set_filter( float (*filter_function)(float, float, float, float), bool separable );
+        void filter( int y0, int y1, std::vector<math::vec4>* pixels ) const;
+        void filter_outputs( int y0, int y1, std::vector<float>* pixels ) const;
         void pack( int mode, ImageBuffer* image_buffer ) const;        
+
+    private:
+        void clear();
+        void calculate_offsets();
+        void calculate_times();
+        void calculate_lens_positions();
+        void calculate_filter_weights( float (*filter_function)(float, float, float, float), bool separable );
+        void filter_separable( int y0, int y1, math::vec4* pixels ) const;
+        void filter_outputs_separable( int y0, int y1, float* pixels ) const;
 };
 
 }
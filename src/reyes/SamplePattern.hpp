@@ -0,0 +1,23 @@
+#pragma once
+
+namespace reyes
+{
+
+/**
+// The pattern that samples are placed in within each pixel.
+//
+// Every pattern other than the regular lattice keeps each sample within its
+// own stratum of the pixel so that samples never swap places and each
+// pattern is repeated every few pixels so that it is the same for a pixel
+// whichever bucket or thread samples it.
+*/
+enum SamplePattern
+{
+    SAMPLE_PATTERN_REGULAR, ///< Samples at the centers of their strata.
+    SAMPLE_PATTERN_JITTERED, ///< Samples at random positions within their strata.
+    SAMPLE_PATTERN_MULTI_JITTERED, ///< Jittered samples that are also stratified across and down the pixel (n-rooks).
+    SAMPLE_PATTERN_LOW_DISCREPANCY, ///< Samples from a scrambled (0,2)-sequence (multi-jittered unless both sampling rates are powers of two).
+    SAMPLE_PATTERN_COUNT
+};
+
+}
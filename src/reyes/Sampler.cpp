@@ -6,6 +6,8 @@
 #include "Sampler.hpp"
 #include "SampleBuffer.hpp"
 #include "Grid.hpp"
+#include "Symbol.hpp"
+#include "ThreadPool.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/vec4.ipp>
@@ -14,316 +16,1334 @@
 #include "assert.hpp"
 #include <vector>
 #include <list>
+#include <algorithm>
+#include <limits.h>
+#include <float.h>
+#include <string.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define REYES_SAMPLER_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define REYES_TARGET_AVX2
+#else
+#define REYES_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 using namespace math;
 using namespace reyes;
 
-static const int MAXIMUM_SAMPLES = 4096;
+static int supported_simd_lanes()
+{
+#if defined(REYES_SAMPLER_SIMD) && defined(_MSC_VER)
+    // AVX2 needs support from both the processor and the operating system,
+    // which must save the upper halves of the YMM registers on a switch.
+    int registers [4];
+    __cpuid( registers, 0 );
+    if ( registers[0] >= 7 )
+    {
+        __cpuid( registers, 1 );
+        const bool osxsave_and_avx = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28));
+        __cpuidex( registers, 7, 0 );
+        const bool avx2 = (registers[1] & (1 << 5)) != 0;
+        if ( osxsave_and_avx && avx2 && (_xgetbv(0) & 6) == 6 )
+        {
+            return 8;
+        }
+    }
+    return 4;
+#elif defined(REYES_SAMPLER_SIMD)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) ? 8 : 4;
+#else
+    return 1;
+#endif
+}
+
+static const int SUPPORTED_SIMD_LANES = supported_simd_lanes();
 
-Sampler::Sampler( float width, float height, const math::vec4& crop_window )
+// Polygons whose bounds cover at least TILED_SAMPLES samples are sampled in 
+// tiles of TILE_SIZE x TILE_SIZE samples so that tiles entirely outside the
+// polygon are skipped and tiles entirely inside skip the per-sample tests.
+static const int TILE_SIZE = 8;
+static const int TILED_SAMPLES = 4 * TILE_SIZE * TILE_SIZE;
+
+Sampler::Sampler( float width, float height, const math::vec4& crop_window, int maximum_vertices, float lens_radius, float focal_distance, MicropolygonShape micropolygon_shape )
 : width_( width )
 , height_( height )
+, lens_radius_( lens_radius )
+, focal_distance_( focal_distance )
+, micropolygon_shape_( micropolygon_shape )
+, simd_lanes_( SUPPORTED_SIMD_LANES )
 , maximum_vertices_( 0 )
+, maximum_polygons_( 0 )
 , x0_( floorf(crop_window.x * width) )
 , x1_( floorf(crop_window.y * width) + 1 )
 , y0_( floorf(crop_window.z * height) )
 , y1_( floorf(crop_window.w * height) + 1)
 , origins_and_edges_( nullptr )
 , indices_( nullptr )
+, bounds_( nullptr )
 , polygons_( 0 )
-, samples_( nullptr )
-, raster_positions_( nullptr )
+, bands_()
+, thread_pool_( nullptr )
+, outputs_()
+, raster_xs_( nullptr )
+, raster_ys_( nullptr )
+, raster_zs_( nullptr )
+, motion_raster_positions_( nullptr )
+, circles_of_confusion_( nullptr )
 {
-    const unsigned int MAXIMUM_TRIANGLES = 2 * 63 * 63;
-    origins_and_edges_ = reinterpret_cast<vec3*>( malloc(3 * sizeof(vec3) * MAXIMUM_TRIANGLES) );
-    indices_ = reinterpret_cast<int*>( malloc(3 * sizeof(int) * MAXIMUM_TRIANGLES) );
-    bounds_ = reinterpret_cast<int*>( malloc(4 * sizeof(int) * MAXIMUM_TRIANGLES) );
-    samples_ = reinterpret_cast<Sample*>( malloc(sizeof(Sample) * MAXIMUM_SAMPLES) );
+    REYES_ASSERT( maximum_vertices > 0 );
+    REYES_ASSERT( lens_radius >= 0.0f );
+    REYES_ASSERT( focal_distance > 0.0f );
+    bands_.push_back( Band() );
+    reserve_samples( &bands_.front(), maximum_vertices );
+    reserve( maximum_vertices );
 }
 
 Sampler::~Sampler()
 {
     reset();
-    free( samples_ );
+    for ( const Band& band : bands_ )
+    {
+        free( band.samples_ );
+    }
     free( bounds_ );
     free( indices_ );
     free( origins_and_edges_ );
 }
 
-void Sampler::sample( const math::mat4x4& screen_transform, const Grid& grid, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer )
+void Sampler::set_thread_pool( ThreadPool* thread_pool )
 {
-    REYES_ASSERT( sample_buffer );
+    thread_pool_ = thread_pool;
+}
 
-    polygons_ = 0;
+int Sampler::simd_lanes() const
+{
+    return simd_lanes_;
+}
+
+// Samplers test as many samples at a time as the processor supports.  Fewer
+// lanes select the narrower SSE (4) or scalar (1) paths, which sample 
+// identically, so that every path can be run and compared on one host.
+void Sampler::set_simd_lanes( int simd_lanes )
+{
+    REYES_ASSERT( simd_lanes == 1 || simd_lanes == 4 || simd_lanes == 8 );
+    simd_lanes_ = std::min( simd_lanes, SUPPORTED_SIMD_LANES );
+}
+
+void Sampler::add_output( const std::string& identifier, int elements )
+{
+    REYES_ASSERT( elements == 1 || elements == 3 );
+    Output output;
+    output.identifier_ = identifier;
+    output.elements_ = elements;
+    output.values_ = nullptr;
+    output.stride_ = 0;
+    outputs_.push_back( output );
+}
+
+void Sampler::bind_outputs( const Grid* grid )
+{
+    // Variables that the grid doesn't have or that don't have the expected
+    // number of elements are sampled as zero.
+    for ( Output& output : outputs_ )
+    {
+        const Symbol* symbol = grid ? grid->find_symbol( output.identifier_.c_str() ) : nullptr;
+        const int elements = symbol && symbol->type() == TYPE_FLOAT ? 1 : 3;
+        const bool valid = symbol && symbol->type() >= TYPE_FLOAT && symbol->type() <= TYPE_NORMAL && elements == output.elements_;
+        output.values_ = !valid ? nullptr : elements == 1 ? grid->float_value( symbol ) : &grid->vec3_value( symbol )->x;
+        output.stride_ = valid && symbol->storage() == STORAGE_VARYING ? elements : 0;
+    }
+}
+
+void Sampler::bind_outputs( const float* values, int vertices )
+{
+    // Values copied by Sampler::copy_outputs() hold every element of each
+    // output at every vertex, one output after another.
+    for ( Output& output : outputs_ )
+    {
+        output.values_ = values;
+        output.stride_ = output.elements_;
+        values = values ? values + vertices * output.elements_ : nullptr;
+    }
+}
 
+void Sampler::copy_outputs( const Grid& grid, std::vector<float>* values )
+{
+    // Copy every element of each output at every vertex, one output after 
+    // another and with zeros for variables that the grid doesn't have, so 
+    // that the grid can be sampled again later without it.
+    REYES_ASSERT( values );
+    values->clear();
+    bind_outputs( &grid );
+    const int vertices = grid.size();
+    for ( const Output& output : outputs_ )
+    {
+        for ( int vertex = 0; vertex < vertices; ++vertex )
+        {
+            for ( int element = 0; element < output.elements_; ++element )
+            {
+                values->push_back( output.values_ ? output.values_[vertex * output.stride_ + element] : 0.0f );
+            }
+        }
+    }
+    bind_outputs( nullptr );
+}
+
+void Sampler::sample( const math::mat4x4& screen_transform, const Grid& grid, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform )
+{
     const vec3* colors = !matte ? grid.vec3_value( "Ci" ) : nullptr;
     const vec3* opacities = !matte ? grid.vec3_value( "Oi" ) : nullptr;
     const vec3* positions = grid.vec3_value( "P" );
-    const int vertices = grid.size();
-    
-    reserve( grid.maximum_vertices() );
-    calculate_raster_positions( screen_transform, positions, vertices );
-    calculate_indices_origins_and_edges( grid, two_sided, left_handed );
-    calculate_bounds( sample_buffer->width(), sample_buffer->height(), polygons_ );
-    calculate_samples( colors, opacities, matte, polygons_, sample_buffer );
+    bind_outputs( &grid );
+    sample_micropolygons( screen_transform, grid.width(), grid.height(), positions, colors, opacities, matte, two_sided, left_handed, sample_buffer, motion_screen_transform );
+    bind_outputs( nullptr );
+}
+
+void Sampler::sample( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, const math::vec3* colors, const math::vec3* opacities, const float* outputs, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform )
+{
+    bind_outputs( outputs, width * height );
+    sample_micropolygons( screen_transform, width, height, positions, colors, opacities, matte, two_sided, left_handed, sample_buffer, motion_screen_transform );
+    bind_outputs( nullptr );
+}
+
+void Sampler::sample_micropolygons( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, const math::vec3* colors, const math::vec3* opacities, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform )
+{
+    REYES_ASSERT( sample_buffer );
+    const bool opaque = matte || !opacities || Sampler::opaque( opacities, width * height, sample_buffer->opacity_threshold() );
+    if ( motion_screen_transform || lens_radius_ > 0.0f )
+    {
+        // Moving or defocused micropolygons can turn to face toward or away
+        // from the camera for some samples and not others so they're culled
+        // per sample.
+        const int vertices = width * height;
+        calculate_polygons( screen_transform, width, height, positions, true, left_handed, false, sample_buffer );
+        if ( motion_screen_transform )
+        {
+            calculate_raster_positions( *motion_screen_transform, positions, vertices, motion_raster_positions_ );
+        }
+        else
+        {
+            for ( int i = 0; i < vertices; ++i )
+            {
+                motion_raster_positions_[i] = raster_position( i );
+            }
+        }
+        calculate_circles_of_confusion( screen_transform, positions, vertices );
+        calculate_blurred_samples( colors, opacities, matte, opaque, two_sided, left_handed, polygons_, sample_buffer );
+        return;
+    }
+    if ( micropolygon_shape_ == MICROPOLYGON_SHAPE_QUADS )
+    {
+        calculate_quads( screen_transform, width, height, positions, two_sided, left_handed, sample_buffer );
+    }
+    else
+    {
+        calculate_polygons( screen_transform, width, height, positions, two_sided, left_handed, true, sample_buffer );
+    }
+    calculate_samples( colors, opacities, matte, opaque, polygons_, sample_buffer );
+}
+
+bool Sampler::visible( const math::mat4x4& screen_transform, const Grid& grid, bool two_sided, bool left_handed, const SampleBuffer* sample_buffer )
+{
+    REYES_ASSERT( sample_buffer );
+    const vec3* positions = grid.vec3_value( "P" );
+    calculate_polygons( screen_transform, grid.width(), grid.height(), positions, two_sided, left_handed, true, sample_buffer );
+    return calculate_visible( polygons_, sample_buffer );
 }
 
 void Sampler::reset()
 {
-    if ( raster_positions_ )
+    if ( raster_xs_ )
     {
-        free( raster_positions_ );
-        raster_positions_ = nullptr;
+        free( raster_xs_ );
+        raster_xs_ = nullptr;
+        free( raster_ys_ );
+        raster_ys_ = nullptr;
+        free( raster_zs_ );
+        raster_zs_ = nullptr;
     }    
+    if ( motion_raster_positions_ )
+    {
+        free( motion_raster_positions_ );
+        motion_raster_positions_ = nullptr;
+    }
+    if ( circles_of_confusion_ )
+    {
+        free( circles_of_confusion_ );
+        circles_of_confusion_ = nullptr;
+    }
+    maximum_vertices_ = 0;
+}
+
+void Sampler::calculate_polygons( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, bool two_sided, bool left_handed, bool cull_outside, const SampleBuffer* sample_buffer )
+{
+    REYES_ASSERT( width > 0 && height > 0 );
+    REYES_ASSERT( positions );
+    REYES_ASSERT( sample_buffer );
+
+    polygons_ = 0;
+
+    // Only the samples stored in the sample buffer's current bucket can be
+    // written so bounds are clipped to that as well as the crop window.
+    const int x0 = std::max( x0_, sample_buffer->x0() );
+    const int x1 = std::min( x1_, sample_buffer->x1() );
+    const int y0 = std::max( y0_, sample_buffer->y0() );
+    const int y1 = std::min( y1_, sample_buffer->y1() );
+    const int facing = two_sided ? 0 : left_handed ? -1 : 1;
+    
+    // Each row of quads is set up as soon as the row of vertices below it
+    // has been projected, while both rows are still in cache, and triangles
+    // that face away from the camera or lie outside of the bucket are culled
+    // before anything is written for them.
+    reserve( width * height );
+    project_vertices( screen_transform, positions, 0, width );
+    for ( int y = 0; y < height - 1; ++y )
+    {
+        const int row = y * width;
+        project_vertices( screen_transform, positions, row + width, width );
+        int x = 0;
+#ifdef REYES_SAMPLER_SIMD
+        if ( simd_lanes_ >= 4 )
+        {
+            x = calculate_row_polygons_sse( row, width, facing, cull_outside, x0, x1, y0, y1 );
+        }
+#endif
+        for ( ; x < width - 1; ++x )
+        {
+            calculate_quad_polygons( row + x, width, facing, cull_outside, x0, x1, y0, y1 );
+        }
+    }
 }
 
 void Sampler::reserve( int maximum_vertices )
 {
-    REYES_ASSERT( grid.maximum_vertices() > 0 );
+    REYES_ASSERT( maximum_vertices > 0 );
     if ( maximum_vertices > maximum_vertices_ )
     {
         reset();
-        raster_positions_ = reinterpret_cast<vec3*>( malloc(sizeof(vec3) * maximum_vertices) );
+        raster_xs_ = reinterpret_cast<float*>( malloc(sizeof(float) * maximum_vertices) );
+        raster_ys_ = reinterpret_cast<float*>( malloc(sizeof(float) * maximum_vertices) );
+        raster_zs_ = reinterpret_cast<float*>( malloc(sizeof(float) * maximum_vertices) );
+        motion_raster_positions_ = reinterpret_cast<vec3*>( malloc(sizeof(vec3) * maximum_vertices) );
+        circles_of_confusion_ = reinterpret_cast<vec2*>( malloc(sizeof(vec2) * maximum_vertices) );
         maximum_vertices_ = maximum_vertices;
     }
+
+    // A grid with n vertices has fewer than n quads and so fewer than 2n 
+    // triangles whatever its dimensions.
+    const int maximum_polygons = 2 * maximum_vertices;
+    if ( maximum_polygons > maximum_polygons_ )
+    {
+        free( bounds_ );
+        free( indices_ );
+        free( origins_and_edges_ );
+        origins_and_edges_ = reinterpret_cast<vec3*>( malloc(3 * sizeof(vec3) * maximum_polygons) );
+        indices_ = reinterpret_cast<int*>( malloc(3 * sizeof(int) * maximum_polygons) );
+        bounds_ = reinterpret_cast<int*>( malloc(4 * sizeof(int) * maximum_polygons) );
+        maximum_polygons_ = maximum_polygons;
+    }
 }
 
-void Sampler::calculate_raster_positions( const math::mat4x4& screen_transform, const vec3* positions, int vertices )
+void Sampler::calculate_raster_positions( const math::mat4x4& screen_transform, const vec3* positions, int vertices, vec3* raster_positions )
 {
     REYES_ASSERT( positions );
     REYES_ASSERT( vertices >= 0 );
-    REYES_ASSERT( raster_positions_ );
+    REYES_ASSERT( raster_positions );
     
     for ( int i = 0; i < vertices; ++i )
     {
         vec4 raster_position = renderman_project( screen_transform, width_, height_, positions[i] );
-        raster_positions_[i] = vec3( raster_position.x, raster_position.y, raster_position.w );
+        raster_positions[i] = vec3( raster_position.x, raster_position.y, raster_position.w );
     }
 }
 
-void Sampler::calculate_indices_origins_and_edges( const Grid& grid, bool two_sided, bool left_handed )
+void Sampler::calculate_circles_of_confusion( const math::mat4x4& screen_transform, const vec3* positions, int vertices )
 {
-    if ( two_sided )
+    REYES_ASSERT( positions );
+    REYES_ASSERT( vertices >= 0 );
+    REYES_ASSERT( circles_of_confusion_ );
+
+    if ( lens_radius_ <= 0.0f )
     {
-        calculate_indices_origins_and_edges_two_sided( grid );
+        std::fill( circles_of_confusion_, circles_of_confusion_ + vertices, vec2(0.0f, 0.0f) );
+        return;
     }
-    else if ( left_handed )
+
+    // Seen from a point on the lens a point in camera space moves across by
+    // that lens position scaled by how far it is from the focal plane.  The
+    // projection is linear in x and y at any depth so the raster movement
+    // for a lens position on the unit disk is that position scaled by the
+    // raster movement at the edge of the lens.
+    for ( int i = 0; i < vertices; ++i )
     {
-        calculate_indices_origins_and_edges_left_handed( grid );
+        const vec3& position = positions[i];
+        const float shift = lens_radius_ * (position.z / focal_distance_ - 1.0f);
+        const vec4 shifted = renderman_project( screen_transform, width_, height_, vec3(position.x + shift, position.y + shift, position.z) );
+        circles_of_confusion_[i] = vec2( shifted.x - raster_xs_[i], shifted.y - raster_ys_[i] );
     }
-    else
+}
+
+void Sampler::project_vertices( const math::mat4x4& screen_transform, const math::vec3* positions, int first, int vertices )
+{
+    REYES_ASSERT( positions );
+    REYES_ASSERT( first >= 0 && vertices >= 0 );
+    REYES_ASSERT( first + vertices <= maximum_vertices_ );
+
+    for ( int i = first; i < first + vertices; ++i )
+    {
+        vec4 raster_position = renderman_project( screen_transform, width_, height_, positions[i] );
+        raster_xs_[i] = raster_position.x;
+        raster_ys_[i] = raster_position.y;
+        raster_zs_[i] = raster_position.w;
+    }
+}
+
+void Sampler::calculate_quad_polygons( int i0, int width, int facing, bool cull_outside, int x0, int x1, int y0, int y1 )
+{
+    // Each quad is split into the triangles (p0, p1, p3) and (p2, p3, p1) 
+    // where p0 and p3 are on the upper row and p1 and p2 on the lower.
+    const int corners[2][3] = {
+        { i0, i0 + width, i0 + 1 },
+        { i0 + width + 1, i0 + 1, i0 + width }
+    };
+    for ( int i = 0; i < 2; ++i )
     {
-        calculate_indices_origins_and_edges_right_handed( grid );
+        const int* corner = corners[i];
+        const float p0x = raster_xs_[corner[0]];
+        const float p0y = raster_ys_[corner[0]];
+        const float p1x = raster_xs_[corner[1]];
+        const float p1y = raster_ys_[corner[1]];
+        const float p2x = raster_xs_[corner[2]];
+        const float p2y = raster_ys_[corner[2]];
+        const float normal_z = (p1x - p0x) * (p2y - p0y) - (p1y - p0y) * (p2x - p0x);
+        const bool facing_camera = facing == 0 || (facing < 0 ? normal_z < 0.0f : normal_z > 0.0f);
+        const bool inside = !cull_outside || (
+            min(p0x, p1x, p2x) < float(x1) && max(p0x, p1x, p2x) > float(x0) - 1.0f &&
+            min(p0y, p1y, p2y) < float(y1) && max(p0y, p1y, p2y) > float(y0) - 1.0f
+        );
+        if ( facing_camera && inside )
+        {
+            add_polygon( corner[0], corner[1], corner[2], x0, x1, y0, y1 );
+        }
     }
 }
 
-void Sampler::calculate_indices_origins_and_edges_two_sided( const Grid& grid )
+#ifdef REYES_SAMPLER_SIMD
+
+// Sets up 4 quads (8 triangles) across a row at once.  Only the facing and 
+// bounds tests are vectorized; triangles that pass are added by the same 
+// Sampler::add_polygon() as the scalar path in the same order so the two
+// paths produce exactly the same polygons.
+int Sampler::calculate_row_polygons_sse( int row, int width, int facing, bool cull_outside, int x0, int x1, int y0, int y1 )
 {
-    const int width = grid.width();
-    const int height = grid.height();
-    int i = 0;
-    int index = 0;    
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 all = _mm_castsi128_ps( _mm_set1_epi32(-1) );
+    const __m128 minimum_x = _mm_set1_ps( float(x0) - 1.0f );
+    const __m128 maximum_x = _mm_set1_ps( float(x1) );
+    const __m128 minimum_y = _mm_set1_ps( float(y0) - 1.0f );
+    const __m128 maximum_y = _mm_set1_ps( float(y1) );
+
+    int x = 0;
+    for ( ; x + 4 < width; x += 4 )
+    {
+        const int i0 = row + x;
+        const int i1 = i0 + width;
+        const __m128 p0x = _mm_loadu_ps( raster_xs_ + i0 );
+        const __m128 p0y = _mm_loadu_ps( raster_ys_ + i0 );
+        const __m128 p3x = _mm_loadu_ps( raster_xs_ + i0 + 1 );
+        const __m128 p3y = _mm_loadu_ps( raster_ys_ + i0 + 1 );
+        const __m128 p1x = _mm_loadu_ps( raster_xs_ + i1 );
+        const __m128 p1y = _mm_loadu_ps( raster_ys_ + i1 );
+        const __m128 p2x = _mm_loadu_ps( raster_xs_ + i1 + 1 );
+        const __m128 p2y = _mm_loadu_ps( raster_ys_ + i1 + 1 );
 
+        const __m128 normal_z_a = _mm_sub_ps( _mm_mul_ps(_mm_sub_ps(p1x, p0x), _mm_sub_ps(p3y, p0y)), _mm_mul_ps(_mm_sub_ps(p1y, p0y), _mm_sub_ps(p3x, p0x)) );
+        const __m128 normal_z_b = _mm_sub_ps( _mm_mul_ps(_mm_sub_ps(p3x, p2x), _mm_sub_ps(p1y, p2y)), _mm_mul_ps(_mm_sub_ps(p3y, p2y), _mm_sub_ps(p1x, p2x)) );
+        __m128 keep_a = facing == 0 ? all : facing < 0 ? _mm_cmplt_ps( normal_z_a, zero ) : _mm_cmpgt_ps( normal_z_a, zero );
+        __m128 keep_b = facing == 0 ? all : facing < 0 ? _mm_cmplt_ps( normal_z_b, zero ) : _mm_cmpgt_ps( normal_z_b, zero );
+
+        if ( cull_outside )
+        {
+            const __m128 minimum_x_13 = _mm_min_ps( p1x, p3x );
+            const __m128 maximum_x_13 = _mm_max_ps( p1x, p3x );
+            const __m128 minimum_y_13 = _mm_min_ps( p1y, p3y );
+            const __m128 maximum_y_13 = _mm_max_ps( p1y, p3y );
+            const __m128 inside_a = _mm_and_ps( 
+                _mm_and_ps(_mm_cmplt_ps(_mm_min_ps(p0x, minimum_x_13), maximum_x), _mm_cmpgt_ps(_mm_max_ps(p0x, maximum_x_13), minimum_x)),
+                _mm_and_ps(_mm_cmplt_ps(_mm_min_ps(p0y, minimum_y_13), maximum_y), _mm_cmpgt_ps(_mm_max_ps(p0y, maximum_y_13), minimum_y))
+            );
+            const __m128 inside_b = _mm_and_ps( 
+                _mm_and_ps(_mm_cmplt_ps(_mm_min_ps(p2x, minimum_x_13), maximum_x), _mm_cmpgt_ps(_mm_max_ps(p2x, maximum_x_13), minimum_x)),
+                _mm_and_ps(_mm_cmplt_ps(_mm_min_ps(p2y, minimum_y_13), maximum_y), _mm_cmpgt_ps(_mm_max_ps(p2y, maximum_y_13), minimum_y))
+            );
+            keep_a = _mm_and_ps( keep_a, inside_a );
+            keep_b = _mm_and_ps( keep_b, inside_b );
+        }
+
+        int mask_a = _mm_movemask_ps( keep_a );
+        int mask_b = _mm_movemask_ps( keep_b );
+        for ( int lane = 0; mask_a | mask_b; ++lane, mask_a >>= 1, mask_b >>= 1 )
+        {
+            if ( mask_a & 1 )
+            {
+                add_polygon( i0 + lane, i1 + lane, i0 + lane + 1, x0, x1, y0, y1 );
+            }
+            if ( mask_b & 1 )
+            {
+                add_polygon( i1 + lane + 1, i0 + lane + 1, i1 + lane, x0, x1, y0, y1 );
+            }
+        }
+    }
+    return x;
+}
+
+#endif
+
+void Sampler::add_polygon( int i0, int i1, int i2, int x0, int x1, int y0, int y1 )
+{
+    REYES_ASSERT( polygons_ < maximum_polygons_ );
+
+    const vec3 p0 = raster_position( i0 );
+    const vec3 p1 = raster_position( i1 );
+    const vec3 p2 = raster_position( i2 );
+
+    const int index = polygons_;
+    origins_and_edges_[index * 3 + 0] = p0;
+    origins_and_edges_[index * 3 + 1] = p1 - p0;
+    origins_and_edges_[index * 3 + 2] = p2 - p0;
+
+    indices_[index * 3 + 0] = i0;
+    indices_[index * 3 + 1] = i1;
+    indices_[index * 3 + 2] = i2;
+
+    bounds_[index * 4 + 0] = std::max( x0, int(floorf(min(p0.x, p1.x, p2.x))) );
+    bounds_[index * 4 + 1] = std::min( int(ceilf(max(p0.x, p1.x, p2.x))) + 1, x1 );
+    bounds_[index * 4 + 2] = std::max( y0, int(floorf(min(p0.y, p1.y, p2.y))) );
+    bounds_[index * 4 + 3] = std::min( int(ceilf(max(p0.y, p1.y, p2.y))) + 1, y1 );
+    ++polygons_;
+}
+
+void Sampler::calculate_quads( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, bool two_sided, bool left_handed, const SampleBuffer* sample_buffer )
+{
+    REYES_ASSERT( width > 0 && height > 0 );
+    REYES_ASSERT( positions );
+    REYES_ASSERT( sample_buffer );
+
+    polygons_ = 0;
+
+    const int x0 = std::max( x0_, sample_buffer->x0() );
+    const int x1 = std::min( x1_, sample_buffer->x1() );
+    const int y0 = std::max( y0_, sample_buffer->y0() );
+    const int y1 = std::min( y1_, sample_buffer->y1() );
+    const int facing = two_sided ? 0 : left_handed ? -1 : 1;
+
+    reserve( width * height );
+    project_vertices( screen_transform, positions, 0, width );
     for ( int y = 0; y < height - 1; ++y )
     {
+        const int row = y * width;
+        project_vertices( screen_transform, positions, row + width, width );
         for ( int x = 0; x < width - 1; ++x )
         {
-            int i0 = i + x;
-            int i1 = i + width + x;
-            int i2 = i + width + x + 1;
-            int i3 = i + x + 1;
+            add_quad( row + x, width, facing, x0, x1, y0, y1 );
+        }
+    }
+}
 
-            const vec3& p0 = raster_positions_[i0];
-            const vec3& p1 = raster_positions_[i1];
-            const vec3& p2 = raster_positions_[i2];
-            const vec3& p3 = raster_positions_[i3];
+void Sampler::add_quad( int i0, int width, int facing, int x0, int x1, int y0, int y1 )
+{
+    // The corners are stored in the order (u, v) = (0, 0), (1, 0), (0, 1), 
+    // and (1, 1) where u runs across the grid and v runs down it.
+    const int i1 = i0 + 1;
+    const int i2 = i0 + width;
+    const int i3 = i2 + 1;
+    const float p0x = raster_xs_[i0];
+    const float p0y = raster_ys_[i0];
+    const float p1x = raster_xs_[i1];
+    const float p1y = raster_ys_[i1];
+    const float p2x = raster_xs_[i2];
+    const float p2y = raster_ys_[i2];
+    const float p3x = raster_xs_[i3];
+    const float p3y = raster_ys_[i3];
 
-            vec3 u = p1 - p0;
-            vec3 v = p3 - p0;
+    // The diagonals of a quad cross with the same sign as the normals of the
+    // triangles that it would otherwise be split into.
+    const float normal_z = (p3x - p0x) * (p1y - p2y) - (p3y - p0y) * (p1x - p2x);
+    const bool facing_camera = facing == 0 || (facing < 0 ? normal_z < 0.0f : normal_z > 0.0f);
+    const float minimum_x = std::min( std::min(p0x, p1x), std::min(p2x, p3x) );
+    const float maximum_x = std::max( std::max(p0x, p1x), std::max(p2x, p3x) );
+    const float minimum_y = std::min( std::min(p0y, p1y), std::min(p2y, p3y) );
+    const float maximum_y = std::max( std::max(p0y, p1y), std::max(p2y, p3y) );
+    const bool inside = 
+        minimum_x < float(x1) && maximum_x > float(x0) - 1.0f &&
+        minimum_y < float(y1) && maximum_y > float(y0) - 1.0f
+    ;
+    if ( !facing_camera || !inside )
+    {
+        return;
+    }
 
-            origins_and_edges_[index * 3 + 0] = p0;
-            origins_and_edges_[index * 3 + 1] = u;
-            origins_and_edges_[index * 3 + 2] = v;
+    REYES_ASSERT( polygons_ < maximum_polygons_ );
+    const int index = polygons_;
+    indices_[index * 4 + 0] = i0;
+    indices_[index * 4 + 1] = i1;
+    indices_[index * 4 + 2] = i2;
+    indices_[index * 4 + 3] = i3;
+    bounds_[index * 4 + 0] = std::max( x0, int(floorf(minimum_x)) );
+    bounds_[index * 4 + 1] = std::min( int(ceilf(maximum_x)) + 1, x1 );
+    bounds_[index * 4 + 2] = std::max( y0, int(floorf(minimum_y)) );
+    bounds_[index * 4 + 3] = std::min( int(ceilf(maximum_y)) + 1, y1 );
+    ++polygons_;
+}
 
-            indices_[index * 3 + 0] = i0;
-            indices_[index * 3 + 1] = i1;
-            indices_[index * 3 + 2] = i3;
-            ++index;
+math::vec3 Sampler::raster_position( int index ) const
+{
+    return vec3( raster_xs_[index], raster_ys_[index], raster_zs_[index] );
+}
 
-            u = p3 - p2;
-            v = p1 - p2;
-            
-            origins_and_edges_[index * 3 + 0] = p2;
-            origins_and_edges_[index * 3 + 1] = u;
-            origins_and_edges_[index * 3 + 2] = v;
+void Sampler::calculate_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, int polygons, SampleBuffer* sample_buffer )
+{
+    REYES_ASSERT( colors );
+    REYES_ASSERT( opacities );
+    REYES_ASSERT( sample_buffer );
+    REYES_ASSERT( polygons >= 0 );
 
-            indices_[index * 3 + 0] = i2;
-            indices_[index * 3 + 1] = i3;
-            indices_[index * 3 + 2] = i1;
-            ++index;
+    int y0 = INT_MAX;
+    int y1 = INT_MIN;
+    const int bands = Sampler::bands( opaque, polygons, &y0, &y1 );
+    if ( bands > 1 )
+    {
+        // Each band samples every polygon clipped to its own rows of the
+        // sample buffer so that no two threads ever touch the same depth or 
+        // color and every sample sees polygons in the same order as when
+        // sampling on one thread.  The depth pyramid is shared between rows
+        // and is only updated once all of the bands have finished.
+        while ( int(bands_.size()) < bands )
+        {
+            bands_.push_back( Band() );
+            reserve_samples( &bands_.back(), bands_.front().maximum_samples_ );
         }
-        i += width;
+        thread_pool_->parallel_for( 0, bands, [&]( int /*thread*/, int band )
+        {
+            const int band_y0 = y0 + (y1 - y0) * band / bands;
+            const int band_y1 = y0 + (y1 - y0) * (band + 1) / bands;
+            sample_rows( colors, opacities, matte, opaque, polygons, band_y0, band_y1, &bands_[band], sample_buffer );
+        } );
+    }
+    else
+    {
+        sample_rows( colors, opacities, matte, opaque, polygons, INT_MIN, INT_MAX, &bands_.front(), sample_buffer );
+    }
+
+    int written_x0 = INT_MAX;
+    int written_x1 = INT_MIN;
+    int written_y0 = INT_MAX;
+    int written_y1 = INT_MIN;
+    for ( int i = 0; i < bands; ++i )
+    {
+        const Band& band = bands_[i];
+        written_x0 = std::min( written_x0, band.written_x0_ );
+        written_x1 = std::max( written_x1, band.written_x1_ );
+        written_y0 = std::min( written_y0, band.written_y0_ );
+        written_y1 = std::max( written_y1, band.written_y1_ );
     }
 
-    polygons_ = index;
+    if ( written_x0 < written_x1 )
+    {
+        sample_buffer->update_depths( written_x0, written_y0, written_x1, written_y1 );
+    }
 }
 
-void Sampler::calculate_indices_origins_and_edges_left_handed( const Grid& grid )
+int Sampler::bands( bool opaque, int polygons, int* y0, int* y1 ) const
 {
-    const int width = grid.width();
-    const int height = grid.height();
-    int i = 0;
-    int index = 0;    
+    REYES_ASSERT( y0 );
+    REYES_ASSERT( y1 );
 
-    for ( int y = 0; y < height - 1; ++y )
+    // Semi-transparent samples are inserted into visible point lists that
+    // share one pool and are always sampled on one thread.
+    const int MINIMUM_BAND_POLYGONS = 256;
+    const int MINIMUM_BAND_ROWS = 8;
+    if ( !thread_pool_ || !opaque || polygons < 2 * MINIMUM_BAND_POLYGONS )
     {
-        for ( int x = 0; x < width - 1; ++x )
+        return 1;
+    }
+
+    for ( int i = 0; i < polygons; ++i )
+    {
+        *y0 = std::min( *y0, bounds_[i * 4 + 2] );
+        *y1 = std::max( *y1, bounds_[i * 4 + 3] );
+    }
+    const int bands = std::min( polygons / MINIMUM_BAND_POLYGONS, (*y1 - *y0) / MINIMUM_BAND_ROWS );
+    return std::max( 1, std::min(bands, thread_pool_->threads()) );
+}
+
+void Sampler::sample_rows( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, int polygons, int y0, int y1, Band* band, SampleBuffer* sample_buffer ) const
+{
+    REYES_ASSERT( band );
+
+    const bool quads = micropolygon_shape_ == MICROPOLYGON_SHAPE_QUADS;
+    Sample* sample = band->samples_;
+    band->written_x0_ = INT_MAX;
+    band->written_x1_ = INT_MIN;
+    band->written_y0_ = INT_MAX;
+    band->written_y1_ = INT_MIN;
+
+    for ( int i = 0; i < polygons; ++i )
+    {
+        int sx0 = bounds_[i * 4 + 0];
+        int sx1 = bounds_[i * 4 + 1];
+        int sy0 = std::max( bounds_[i * 4 + 2], y0 );
+        int sy1 = std::min( bounds_[i * 4 + 3], y1 );
+        if ( sx0 >= sx1 || sy0 >= sy1 )
         {
-            int i0 = i + x;
-            int i1 = i + width + x;
-            int i2 = i + width + x + 1;
-            int i3 = i + x + 1;
-
-            const vec3& p0 = raster_positions_[i0];
-            const vec3& p1 = raster_positions_[i1];
-            const vec3& p2 = raster_positions_[i2];
-            const vec3& p3 = raster_positions_[i3];
-                                    
-            vec3 u = p1 - p0;
-            vec3 v = p3 - p0;
-            vec3 n = cross( u, v );
-            
-            if ( n.z < 0.0f )
+            continue;
+        }
+
+        const int bound_samples = (sy1 - sy0) * (sx1 - sx0);
+        int samples = sample - band->samples_;
+        if ( samples > 0 && samples + bound_samples > band->maximum_samples_ )
+        {
+            calculate_colors_in_sample_buffer( colors, opacities, matte, opaque, quads, band->samples_, samples, sample_buffer );
+            sample = band->samples_;
+        }
+
+        // Micropolygons that are diced coarsely or that straddle the epsilon
+        // plane can be bounded over more samples than there are vertices.
+        if ( bound_samples > band->maximum_samples_ )
+        {
+            reserve_samples( band, bound_samples );
+            sample = band->samples_;
+        }
+
+        Sample* first_sample = sample;
+        if ( quads )
+        {
+            sample = sample_quad( i, sx0, sx1, sy0, sy1, opaque, sample, sample_buffer );
+        }
+        else if ( bound_samples >= TILED_SAMPLES )
+        {
+            sample = sample_polygon_in_tiles( i, sx0, sx1, sy0, sy1, opaque, sample, sample_buffer );
+        }
+        else
+        {
+            sample = sample_polygon_region( i, sx0, sx1, sy0, sy1, false, opaque, sample, sample_buffer );
+        }
+
+        if ( sample != first_sample )
+        {
+            band->written_x0_ = std::min( band->written_x0_, sx0 );
+            band->written_x1_ = std::max( band->written_x1_, sx1 );
+            band->written_y0_ = std::min( band->written_y0_, sy0 );
+            band->written_y1_ = std::max( band->written_y1_, sy1 );
+        }
+    }    
+
+    int samples = sample - band->samples_;
+    if ( samples > 0 )
+    {
+        calculate_colors_in_sample_buffer( colors, opacities, matte, opaque, quads, band->samples_, samples, sample_buffer );
+    }
+}
+
+void Sampler::reserve_samples( Band* band, int samples ) const
+{
+    REYES_ASSERT( band );
+    REYES_ASSERT( samples > 0 );
+    free( band->samples_ );
+    band->samples_ = reinterpret_cast<Sample*>( malloc(sizeof(Sample) * samples) );
+    band->maximum_samples_ = samples;
+}
+
+Sampler::Sample* Sampler::sample_polygon_in_tiles( int polygon, int sx0, int sx1, int sy0, int sy1, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
+{
+    const vec3& o = origins_and_edges_[polygon * 3 + 0];
+    const vec3& u = origins_and_edges_[polygon * 3 + 1];
+    const vec3& v = origins_and_edges_[polygon * 3 + 2];
+    const float one_over_determinant = 1.0f / (u.x * v.y - v.x * u.y);
+    REYES_ASSERT( one_over_determinant != 0.0f );
+
+    // The barycentric coordinates are linear in sample position so their
+    // extremes over a tile are at its corners.  Sample positions are offset
+    // by less than half a sample from their integer coordinates so a tile 
+    // covering [tx0, tx1) and [ty0, ty1) has its samples in the box from
+    // (tx0 - 0.5, ty0 - 0.5) to (tx1 - 0.5, ty1 - 0.5).  Tiles are only classified as outside or 
+    // covered by a margin to allow for rounding in the per-sample tests.
+    const float EPSILON = -0.01f;
+    const float MARGIN = 0.001f;
+    const float du_dx = one_over_determinant * v.y;
+    const float du_dy = -one_over_determinant * v.x;
+    const float dv_dx = -one_over_determinant * u.y;
+    const float dv_dy = one_over_determinant * u.x;
+
+    for ( int ty0 = sy0; ty0 < sy1; ty0 += TILE_SIZE )
+    {
+        const int ty1 = std::min( ty0 + TILE_SIZE, sy1 );
+        const float height = float(ty1 - ty0);
+        for ( int tx0 = sx0; tx0 < sx1; tx0 += TILE_SIZE )
+        {
+            const int tx1 = std::min( tx0 + TILE_SIZE, sx1 );
+            const float width = float(tx1 - tx0);
+            const float px = float(tx0) - 0.5f - o.x;
+            const float py = float(ty0) - 0.5f - o.y;
+            const float uu = one_over_determinant * (v.y * px - v.x * py);
+            const float vv = one_over_determinant * (u.x * py - u.y * px);
+            const float uu_minimum = uu + std::min( du_dx * width, 0.0f ) + std::min( du_dy * height, 0.0f );
+            const float uu_maximum = uu + std::max( du_dx * width, 0.0f ) + std::max( du_dy * height, 0.0f );
+            const float vv_minimum = vv + std::min( dv_dx * width, 0.0f ) + std::min( dv_dy * height, 0.0f );
+            const float vv_maximum = vv + std::max( dv_dx * width, 0.0f ) + std::max( dv_dy * height, 0.0f );
+            const float ww_minimum = uu + vv + std::min( (du_dx + dv_dx) * width, 0.0f ) + std::min( (du_dy + dv_dy) * height, 0.0f );
+            const float ww_maximum = uu + vv + std::max( (du_dx + dv_dx) * width, 0.0f ) + std::max( (du_dy + dv_dy) * height, 0.0f );
+
+            if ( uu_maximum < EPSILON - MARGIN || vv_maximum < EPSILON - MARGIN || ww_minimum >= 1.0f + MARGIN )
             {
-                origins_and_edges_[index * 3 + 0] = p0;
-                origins_and_edges_[index * 3 + 1] = u;
-                origins_and_edges_[index * 3 + 2] = v;
+                continue;
+            }
+
+            const bool covered = uu_minimum >= EPSILON + MARGIN && vv_minimum >= EPSILON + MARGIN && ww_maximum < 1.0f - MARGIN;
+            sample = sample_polygon_region( polygon, tx0, tx1, ty0, ty1, covered, opaque, sample, sample_buffer );
+        }
+    }
+    return sample;
+}
+
+Sampler::Sample* Sampler::sample_polygon_region( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
+{
+    switch ( simd_lanes_ )
+    {
+#ifdef REYES_SAMPLER_SIMD
+        case 8:
+            return sample_polygon_avx2( polygon, sx0, sx1, sy0, sy1, covered, opaque, sample, sample_buffer );
 
-                indices_[index * 3 + 0] = i0;
-                indices_[index * 3 + 1] = i1;
-                indices_[index * 3 + 2] = i3;
-                ++index;
+        case 4:
+            return sample_polygon_sse( polygon, sx0, sx1, sy0, sy1, covered, opaque, sample, sample_buffer );
+#endif
+        default:
+            return sample_polygon( polygon, sx0, sx1, sy0, sy1, covered, opaque, sample, sample_buffer );
+    }
+}
+
+Sampler::Sample* Sampler::sample_quad( int polygon, int sx0, int sx1, int sy0, int sy1, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
+{
+    const int* indices = &indices_[polygon * 4];
+    const vec3 p0 = raster_position( indices[0] );
+    const vec3 p1 = raster_position( indices[1] );
+    const vec3 p2 = raster_position( indices[2] );
+    const vec3 p3 = raster_position( indices[3] );
+
+    // The position of a sample is p0 + e * u + f * v + g * u * v for the 
+    // parameters (u, v) of the sample in the quad.  Crossing both sides with
+    // e + g * v leaves the quadratic k2 * v^2 + k1 * v + k0 = 0 in v from 
+    // which u follows.  The root found from k0 / q is the one nearest -k0 / k1
+    // and is stable as the quad tends towards a parallelogram and k2 to 0.
+    const vec2 e( p1.x - p0.x, p1.y - p0.y );
+    const vec2 f( p2.x - p0.x, p2.y - p0.y );
+    const vec2 g( p0.x - p1.x - p2.x + p3.x, p0.y - p1.y - p2.y + p3.y );
+    const float k2 = g.x * f.y - g.y * f.x;
+    const float e_cross_f = e.x * f.y - e.y * f.x;
+
+    for ( int y = sy0; y < sy1; ++y )
+    {
+        for ( int x = sx0; x < sx1; ++x )
+        {
+            const vec2 s = sample_buffer->position( x, y );
+            const vec2 h = vec2( s.x - p0.x, s.y - p0.y );
+            const float k1 = e_cross_f + h.x * g.y - h.y * g.x;
+            const float k0 = h.x * e.y - h.y * e.x;
+            const float discriminant = k1 * k1 - 4.0f * k0 * k2;
+            if ( discriminant < 0.0f )
+            {
+                continue;
             }
 
-            u = p3 - p2;
-            v = p1 - p2;
-            n = cross( u, v );
-            
-            if ( n.z < 0.0f )
+            const float q = -0.5f * (k1 + copysignf(sqrtf(discriminant), k1));
+            const float roots [2] = { q != 0.0f ? k0 / q : -1.0f, k2 != 0.0f ? q / k2 : -1.0f };
+            for ( int root = 0; root < 2; ++root )
             {
-                origins_and_edges_[index * 3 + 0] = p2;
-                origins_and_edges_[index * 3 + 1] = u;
-                origins_and_edges_[index * 3 + 2] = v;
+                const float vv = roots[root];
+                const float dx = e.x + g.x * vv;
+                const float dy = e.y + g.y * vv;
+                const float uu = fabsf(dx) >= fabsf(dy) ? (h.x - f.x * vv) / dx : (h.y - f.y * vv) / dy;
 
-                indices_[index * 3 + 0] = i2;
-                indices_[index * 3 + 1] = i3;
-                indices_[index * 3 + 2] = i1;
-                ++index;
+                const float EPSILON = -0.01f;
+                if ( uu >= EPSILON & vv >= EPSILON & uu < 1.0f & vv < 1.0f )
+                {
+                    float* depth = sample_buffer->depth( x, y );
+                    float z = lerp( lerp(p0.z, p1.z, uu), lerp(p2.z, p3.z, uu), vv );
+                    if ( z < *depth )
+                    {
+                        if ( opaque )
+                        {
+                            *depth = z;
+                        }
+                        sample->u_ = uu;
+                        sample->v_ = vv;
+                        sample->z_ = z;
+                        sample->index_ = polygon;
+                        sample->x_ = x;
+                        sample->y_ = y;
+                        ++sample;
+                    }
+                    break;
+                }
             }
         }
-        i += width;
     }
+    return sample;
+}
+
+Sampler::Sample* Sampler::sample_polygon( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
+{
+    const vec3& o = origins_and_edges_[polygon * 3 + 0];
+    const vec3& u = origins_and_edges_[polygon * 3 + 1];
+    const vec3& v = origins_and_edges_[polygon * 3 + 2];
+    const float one_over_determinant = 1.0f / (u.x * v.y - v.x * u.y);
+    REYES_ASSERT( one_over_determinant != 0.0f );
 
-    polygons_ = index;
+    for ( int y = sy0; y < sy1; ++y )
+    {
+        for ( int x = sx0; x < sx1; ++x )
+        {
+            const vec2 s = sample_buffer->position( x, y );
+            const vec2 p = vec2( s.x - o.x, s.y - o.y );
+            float uu = one_over_determinant * (v.y * p.x - v.x * p.y);
+            float vv = one_over_determinant * (u.x * p.y - u.y * p.x);
+
+            const float EPSILON = -0.01f;
+            if ( covered || (uu >= EPSILON & vv >= EPSILON & uu + vv < 1.0f) )
+            {
+                float* depth = sample_buffer->depth( x, y );
+                float z = o.z + u.z * uu + v.z * vv;
+                if ( z < *depth )
+                {
+                    if ( opaque )
+                    {
+                        *depth = z;
+                    }
+                    sample->u_ = uu;
+                    sample->v_ = vv;
+                    sample->z_ = z;
+                    sample->index_ = polygon;
+                    sample->x_ = x;
+                    sample->y_ = y;
+                    ++sample;
+                }
+            }
+        }
+    }
+    return sample;
 }
 
-void Sampler::calculate_indices_origins_and_edges_right_handed( const Grid& grid )
+#ifdef REYES_SAMPLER_SIMD
+
+// The vector paths evaluate the same expressions as Sampler::sample_polygon()
+// in the same order for 4 or 8 samples across a row at once so they write 
+// exactly the same samples.  Sample positions are generated from their
+// integer coordinates plus offsets loaded from the sample buffer's tile of
+// offsets (see SampleBuffer::position()).  Rows of that tile are padded so
+// that a full vector of offsets can be loaded from any sample in a row.
+
+Sampler::Sample* Sampler::sample_polygon_sse( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
 {
-    const int width = grid.width();
-    const int height = grid.height();
-    int i = 0;
-    int index = 0;    
+    const vec3& o = origins_and_edges_[polygon * 3 + 0];
+    const vec3& u = origins_and_edges_[polygon * 3 + 1];
+    const vec3& v = origins_and_edges_[polygon * 3 + 2];
+    const float one_over_determinant = 1.0f / (u.x * v.y - v.x * u.y);
+    REYES_ASSERT( one_over_determinant != 0.0f );
 
-    for ( int y = 0; y < height - 1; ++y )
+    const __m128 lanes = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+    const __m128 epsilon = _mm_set1_ps( -0.01f );
+    const __m128 one = _mm_set1_ps( 1.0f );
+    const __m128 ox = _mm_set1_ps( o.x );
+    const __m128 oy = _mm_set1_ps( o.y );
+    const __m128 oz = _mm_set1_ps( o.z );
+    const __m128 ux = _mm_set1_ps( u.x );
+    const __m128 uy = _mm_set1_ps( u.y );
+    const __m128 uz = _mm_set1_ps( u.z );
+    const __m128 vx = _mm_set1_ps( v.x );
+    const __m128 vy = _mm_set1_ps( v.y );
+    const __m128 vz = _mm_set1_ps( v.z );
+    const __m128 scale = _mm_set1_ps( one_over_determinant );
+    const __m128 end = _mm_set1_ps( float(sx1) );
+    const int buffer_x1 = sample_buffer->x1();
+    const int offsets_width = sample_buffer->offsets_width();
+
+    alignas(16) float uus [4];
+    alignas(16) float vvs [4];
+    alignas(16) float zs [4];
+    alignas(16) float depths [4];
+
+    for ( int y = sy0; y < sy1; ++y )
     {
-        for ( int x = 0; x < width - 1; ++x )
+        const float* horizontal_offsets = sample_buffer->horizontal_offsets( y );
+        const float* vertical_offsets = sample_buffer->vertical_offsets( y );
+        const __m128 sy = _mm_set1_ps( float(y) );
+        float* row = sample_buffer->depth( sx0, y );
+
+        for ( int x = sx0, offset = sx0 % offsets_width; x < sx1; x += 4, offset += 4 )
         {
-            int i0 = i + x;
-            int i1 = i + width + x;
-            int i2 = i + width + x + 1;
-            int i3 = i + x + 1;
+            if ( offset >= offsets_width )
+            {
+                offset -= offsets_width;
+            }
 
-            const vec3& p0 = raster_positions_[i0];
-            const vec3& p1 = raster_positions_[i1];
-            const vec3& p2 = raster_positions_[i2];
-            const vec3& p3 = raster_positions_[i3];
-            
-            vec3 u = p1 - p0;
-            vec3 v = p3 - p0;
-            vec3 n = cross( u, v );
-            
-            if ( n.z > 0.0f )
+            const __m128 sx = _mm_add_ps( _mm_set1_ps(float(x)), lanes );
+            const __m128 px = _mm_sub_ps( _mm_add_ps(sx, _mm_loadu_ps(horizontal_offsets + offset)), ox );
+            const __m128 py = _mm_sub_ps( _mm_add_ps(sy, _mm_loadu_ps(vertical_offsets + offset)), oy );
+            const __m128 uu = _mm_mul_ps( scale, _mm_sub_ps(_mm_mul_ps(vy, px), _mm_mul_ps(vx, py)) );
+            const __m128 vv = _mm_mul_ps( scale, _mm_sub_ps(_mm_mul_ps(ux, py), _mm_mul_ps(uy, px)) );
+            __m128 inside = _mm_cmplt_ps( sx, end );
+            if ( !covered )
+            {
+                inside = _mm_and_ps( inside, _mm_and_ps(_mm_cmpge_ps(uu, epsilon), _mm_cmpge_ps(vv, epsilon)) );
+                inside = _mm_and_ps( inside, _mm_cmplt_ps(_mm_add_ps(uu, vv), one) );
+            }
+            if ( _mm_movemask_ps(inside) == 0 )
             {
-                origins_and_edges_[index * 3 + 0] = p0;
-                origins_and_edges_[index * 3 + 1] = u;
-                origins_and_edges_[index * 3 + 2] = v;
+                continue;
+            }
 
-                indices_[index * 3 + 0] = i0;
-                indices_[index * 3 + 1] = i1;
-                indices_[index * 3 + 2] = i3;
-                ++index;
+            __m128 depth;
+            if ( x + 4 <= buffer_x1 )
+            {
+                depth = _mm_loadu_ps( row + x - sx0 );
             }
-            
-            u = p3 - p2;
-            v = p1 - p2;
-            n = cross( u, v );
-            
-            if ( n.z > 0.0f )
+            else
             {
-                origins_and_edges_[index * 3 + 0] = p2;
-                origins_and_edges_[index * 3 + 1] = u;
-                origins_and_edges_[index * 3 + 2] = v;
+                for ( int lane = 0; lane < 4; ++lane )
+                {
+                    depths[lane] = x + lane < sx1 ? row[x - sx0 + lane] : 0.0f;
+                }
+                depth = _mm_load_ps( depths );
+            }
 
-                indices_[index * 3 + 0] = i2;
-                indices_[index * 3 + 1] = i3;
-                indices_[index * 3 + 2] = i1;
-                ++index;
+            const __m128 z = _mm_add_ps( _mm_add_ps(oz, _mm_mul_ps(uz, uu)), _mm_mul_ps(vz, vv) );
+            int mask = _mm_movemask_ps( _mm_and_ps(inside, _mm_cmplt_ps(z, depth)) );
+            if ( mask )
+            {
+                _mm_store_ps( uus, uu );
+                _mm_store_ps( vvs, vv );
+                _mm_store_ps( zs, z );
+                for ( int lane = 0; mask; ++lane, mask >>= 1 )
+                {
+                    if ( mask & 1 )
+                    {
+                        if ( opaque )
+                        {
+                            row[x - sx0 + lane] = zs[lane];
+                        }
+                        sample->u_ = uus[lane];
+                        sample->v_ = vvs[lane];
+                        sample->z_ = zs[lane];
+                        sample->index_ = polygon;
+                        sample->x_ = x + lane;
+                        sample->y_ = y;
+                        ++sample;
+                    }
+                }
             }
         }
-        i += width;
     }
-
-    polygons_ = index;
+    return sample;
 }
 
-void Sampler::calculate_bounds( int width, int height, int polygons )
+REYES_TARGET_AVX2 Sampler::Sample* Sampler::sample_polygon_avx2( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
 {
-    REYES_ASSERT( width >= 0 );
-    REYES_ASSERT( height >= 0 );
-    REYES_ASSERT( polygons >= 0 );
-    
-    for ( int i = 0; i < polygons; ++i )
+    const vec3& o = origins_and_edges_[polygon * 3 + 0];
+    const vec3& u = origins_and_edges_[polygon * 3 + 1];
+    const vec3& v = origins_and_edges_[polygon * 3 + 2];
+    const float one_over_determinant = 1.0f / (u.x * v.y - v.x * u.y);
+    REYES_ASSERT( one_over_determinant != 0.0f );
+
+    const __m256 lanes = _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f );
+    const __m256 epsilon = _mm256_set1_ps( -0.01f );
+    const __m256 one = _mm256_set1_ps( 1.0f );
+    const __m256 ox = _mm256_set1_ps( o.x );
+    const __m256 oy = _mm256_set1_ps( o.y );
+    const __m256 oz = _mm256_set1_ps( o.z );
+    const __m256 ux = _mm256_set1_ps( u.x );
+    const __m256 uy = _mm256_set1_ps( u.y );
+    const __m256 uz = _mm256_set1_ps( u.z );
+    const __m256 vx = _mm256_set1_ps( v.x );
+    const __m256 vy = _mm256_set1_ps( v.y );
+    const __m256 vz = _mm256_set1_ps( v.z );
+    const __m256 scale = _mm256_set1_ps( one_over_determinant );
+    const __m256 end = _mm256_set1_ps( float(sx1) );
+    const int buffer_x1 = sample_buffer->x1();
+    const int offsets_width = sample_buffer->offsets_width();
+
+    alignas(32) float uus [8];
+    alignas(32) float vvs [8];
+    alignas(32) float zs [8];
+    alignas(32) float depths [8];
+
+    for ( int y = sy0; y < sy1; ++y )
     {
-        int i0 = indices_[i * 3 + 0];
-        int i1 = indices_[i * 3 + 1];
-        int i2 = indices_[i * 3 + 2];
+        const float* horizontal_offsets = sample_buffer->horizontal_offsets( y );
+        const float* vertical_offsets = sample_buffer->vertical_offsets( y );
+        const __m256 sy = _mm256_set1_ps( float(y) );
+        float* row = sample_buffer->depth( sx0, y );
 
-        const vec3& p0 = raster_positions_[i0];
-        const vec3& p1 = raster_positions_[i1];
-        const vec3& p2 = raster_positions_[i2];
+        for ( int x = sx0, offset = sx0 % offsets_width; x < sx1; x += 8, offset += 8 )
+        {
+            if ( offset >= offsets_width )
+            {
+                offset -= offsets_width;
+            }
+
+            const __m256 sx = _mm256_add_ps( _mm256_set1_ps(float(x)), lanes );
+            const __m256 px = _mm256_sub_ps( _mm256_add_ps(sx, _mm256_loadu_ps(horizontal_offsets + offset)), ox );
+            const __m256 py = _mm256_sub_ps( _mm256_add_ps(sy, _mm256_loadu_ps(vertical_offsets + offset)), oy );
+            const __m256 uu = _mm256_mul_ps( scale, _mm256_sub_ps(_mm256_mul_ps(vy, px), _mm256_mul_ps(vx, py)) );
+            const __m256 vv = _mm256_mul_ps( scale, _mm256_sub_ps(_mm256_mul_ps(ux, py), _mm256_mul_ps(uy, px)) );
+            __m256 inside = _mm256_cmp_ps( sx, end, _CMP_LT_OQ );
+            if ( !covered )
+            {
+                inside = _mm256_and_ps( inside, _mm256_and_ps(_mm256_cmp_ps(uu, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(vv, epsilon, _CMP_GE_OQ)) );
+                inside = _mm256_and_ps( inside, _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LT_OQ) );
+            }
+            if ( _mm256_movemask_ps(inside) == 0 )
+            {
+                continue;
+            }
 
-        int sx0 = int(floorf( min(p0.x, p1.x, p2.x) ));
-        int sx1 = int(ceilf( max(p0.x, p1.x, p2.x) )) + 1;
-        int sy0 = int(floorf( min(p0.y, p1.y, p2.y) ));
-        int sy1 = int(ceilf( max(p0.y, p1.y, p2.y) )) + 1;
+            __m256 depth;
+            if ( x + 8 <= buffer_x1 )
+            {
+                depth = _mm256_loadu_ps( row + x - sx0 );
+            }
+            else
+            {
+                for ( int lane = 0; lane < 8; ++lane )
+                {
+                    depths[lane] = x + lane < sx1 ? row[x - sx0 + lane] : 0.0f;
+                }
+                depth = _mm256_load_ps( depths );
+            }
 
-        bounds_[i * 4 + 0] = std::max( x0_, sx0 );
-        bounds_[i * 4 + 1] = std::min( sx1, x1_ );
-        bounds_[i * 4 + 2] = std::max( y0_, sy0 );
-        bounds_[i * 4 + 3] = std::min( sy1, y1_ );
+            const __m256 z = _mm256_add_ps( _mm256_add_ps(oz, _mm256_mul_ps(uz, uu)), _mm256_mul_ps(vz, vv) );
+            int mask = _mm256_movemask_ps( _mm256_and_ps(inside, _mm256_cmp_ps(z, depth, _CMP_LT_OQ)) );
+            if ( mask )
+            {
+                _mm256_store_ps( uus, uu );
+                _mm256_store_ps( vvs, vv );
+                _mm256_store_ps( zs, z );
+                for ( int lane = 0; mask; ++lane, mask >>= 1 )
+                {
+                    if ( mask & 1 )
+                    {
+                        if ( opaque )
+                        {
+                            row[x - sx0 + lane] = zs[lane];
+                        }
+                        sample->u_ = uus[lane];
+                        sample->v_ = vvs[lane];
+                        sample->z_ = zs[lane];
+                        sample->index_ = polygon;
+                        sample->x_ = x + lane;
+                        sample->y_ = y;
+                        ++sample;
+                    }
+                }
+            }
+        }
     }
+    return sample;
 }
 
-void Sampler::calculate_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, int polygons, SampleBuffer* sample_buffer )
+#endif
+
+void Sampler::calculate_blurred_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, bool two_sided, bool left_handed, int polygons, SampleBuffer* sample_buffer )
 {
     REYES_ASSERT( colors );
     REYES_ASSERT( opacities );
     REYES_ASSERT( sample_buffer );
     REYES_ASSERT( polygons >= 0 );
 
-    Sample* sample = samples_;
+    const int x0 = std::max( x0_, sample_buffer->x0() );
+    const int x1 = std::min( x1_, sample_buffer->x1() );
+    const int y0 = std::max( y0_, sample_buffer->y0() );
+    const int y1 = std::min( y1_, sample_buffer->y1() );
+
+    // Samples are binned by lens position when there is depth of field and
+    // by time otherwise; micropolygons that move and are defocused are 
+    // bounded over the whole time that the shutter is open for each bin.
+    const bool lens_bins = lens_radius_ > 0.0f;
+    const int bins = lens_bins ? sample_buffer->lens_bins() : sample_buffer->time_bins();
+
+    Band& band = bands_.front();
+    Sample* sample = band.samples_;
+    int written_x0 = INT_MAX;
+    int written_x1 = INT_MIN;
+    int written_y0 = INT_MAX;
+    int written_y1 = INT_MIN;
+
+    for ( int i = 0; i < polygons; ++i )
+    {
+        for ( int bin = 0; bin < bins; ++bin )
+        {
+            const float t0 = lens_bins ? 0.0f : float(bin) / float(bins);
+            const float t1 = lens_bins ? 1.0f : float(bin + 1) / float(bins);
+            const vec4 lens_bound = lens_bins ? sample_buffer->lens_bound( bin ) : vec4( 0.0f, 0.0f, 0.0f, 0.0f );
+
+            // Vertices move linearly so a micropolygon stays within the bound
+            // of its positions at the start and end of each time bin moved 
+            // by as much as any lens position in the bin moves them.
+            float minimum_x = FLT_MAX;
+            float maximum_x = -FLT_MAX;
+            float minimum_y = FLT_MAX;
+            float maximum_y = -FLT_MAX;
+            for ( int j = 0; j < 3; ++j )
+            {
+                const int index = indices_[i * 3 + j];
+                const vec3 a = lerp( raster_position(index), motion_raster_positions_[index], t0 );
+                const vec3 b = lerp( raster_position(index), motion_raster_positions_[index], t1 );
+                const vec2& c = circles_of_confusion_[index];
+                minimum_x = std::min( minimum_x, std::min(a.x, b.x) + std::min(lens_bound.x * c.x, lens_bound.y * c.x) );
+                maximum_x = std::max( maximum_x, std::max(a.x, b.x) + std::max(lens_bound.x * c.x, lens_bound.y * c.x) );
+                minimum_y = std::min( minimum_y, std::min(a.y, b.y) + std::min(lens_bound.z * c.y, lens_bound.w * c.y) );
+                maximum_y = std::max( maximum_y, std::max(a.y, b.y) + std::max(lens_bound.z * c.y, lens_bound.w * c.y) );
+            }
+
+            int sx0 = std::max( x0, int(floorf(minimum_x)) );
+            int sx1 = std::min( int(ceilf(maximum_x)) + 1, x1 );
+            int sy0 = std::max( y0, int(floorf(minimum_y)) );
+            int sy1 = std::min( int(ceilf(maximum_y)) + 1, y1 );
+            if ( sx0 >= sx1 || sy0 >= sy1 )
+            {
+                continue;
+            }
+
+            const int bound_samples = (sy1 - sy0) * (sx1 - sx0);
+            int samples = sample - band.samples_;
+            if ( samples > 0 && samples + bound_samples > band.maximum_samples_ )
+            {
+                calculate_colors_in_sample_buffer( colors, opacities, matte, opaque, false, band.samples_, samples, sample_buffer );
+                sample = band.samples_;
+            }
+
+            // Micropolygons that move quickly or are far out of focus can be
+            // bounded over many more samples than those that aren't blurred.
+            if ( bound_samples > band.maximum_samples_ )
+            {
+                reserve_samples( &band, bound_samples );
+                sample = band.samples_;
+            }
+
+            Sample* first_sample = sample;
+            sample = sample_blurred_polygon( i, lens_bins, bin, sx0, sx1, sy0, sy1, two_sided, left_handed, opaque, sample, sample_buffer );
+            if ( sample != first_sample )
+            {
+                written_x0 = std::min( written_x0, sx0 );
+                written_x1 = std::max( written_x1, sx1 );
+                written_y0 = std::min( written_y0, sy0 );
+                written_y1 = std::max( written_y1, sy1 );
+            }
+        }
+    }
+
+    int samples = sample - band.samples_;
+    if ( samples > 0 )
+    {
+        calculate_colors_in_sample_buffer( colors, opacities, matte, opaque, false, band.samples_, samples, sample_buffer );
+    }
+
+    if ( written_x0 < written_x1 )
+    {
+        sample_buffer->update_depths( written_x0, written_y0, written_x1, written_y1 );
+    }
+}
+
+Sampler::Sample* Sampler::sample_blurred_polygon( int polygon, bool lens_bins, int bin, int sx0, int sx1, int sy0, int sy1, bool two_sided, bool left_handed, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const
+{
+    const int i0 = indices_[polygon * 3 + 0];
+    const int i1 = indices_[polygon * 3 + 1];
+    const int i2 = indices_[polygon * 3 + 2];
+    const vec3 p0 = raster_position( i0 );
+    const vec3 p1 = raster_position( i1 );
+    const vec3 p2 = raster_position( i2 );
+    const vec3& q0 = motion_raster_positions_[i0];
+    const vec3& q1 = motion_raster_positions_[i1];
+    const vec3& q2 = motion_raster_positions_[i2];
+    const vec2& c0 = circles_of_confusion_[i0];
+    const vec2& c1 = circles_of_confusion_[i1];
+    const vec2& c2 = circles_of_confusion_[i2];
+
+    const int horizontal_sampling_rate = sample_buffer->horizontal_sampling_rate();
+    const int vertical_sampling_rate = sample_buffer->vertical_sampling_rate();
+    const int samples_per_bin = lens_bins ? sample_buffer->samples_per_lens_bin() : sample_buffer->samples_per_time_bin();
+    const int pixel_x0 = sx0 / horizontal_sampling_rate;
+    const int pixel_x1 = (sx1 - 1) / horizontal_sampling_rate + 1;
+    const int pixel_y0 = sy0 / vertical_sampling_rate;
+    const int pixel_y1 = (sy1 - 1) / vertical_sampling_rate + 1;
+
+    for ( int pixel_y = pixel_y0; pixel_y < pixel_y1; ++pixel_y )
+    {
+        for ( int pixel_x = pixel_x0; pixel_x < pixel_x1; ++pixel_x )
+        {
+            const int* bin_samples = lens_bins ? sample_buffer->lens_bin_samples( pixel_x, pixel_y, bin ) : sample_buffer->time_bin_samples( pixel_x, pixel_y, bin );
+            for ( int i = 0; i < samples_per_bin; ++i )
+            {
+                const int x = pixel_x * horizontal_sampling_rate + bin_samples[i] % horizontal_sampling_rate;
+                const int y = pixel_y * vertical_sampling_rate + bin_samples[i] / horizontal_sampling_rate;
+                if ( x < sx0 || x >= sx1 || y < sy0 || y >= sy1 )
+                {
+                    continue;
+                }
+
+                const float t = sample_buffer->time( x, y );
+                const vec2 l = sample_buffer->lens_position( x, y );
+                const vec3 o = lerp( p0, q0, t ) + vec3( l.x * c0.x, l.y * c0.y, 0.0f );
+                const vec3 u = lerp( p1, q1, t ) + vec3( l.x * c1.x, l.y * c1.y, 0.0f ) - o;
+                const vec3 v = lerp( p2, q2, t ) + vec3( l.x * c2.x, l.y * c2.y, 0.0f ) - o;
+                const float determinant = u.x * v.y - v.x * u.y;
+                if ( determinant == 0.0f || (!two_sided && (left_handed ? determinant > 0.0f : determinant < 0.0f)) )
+                {
+                    continue;
+                }
+
+                const float one_over_determinant = 1.0f / determinant;
+                const vec2 s = sample_buffer->position( x, y );
+                const vec2 p = vec2( s.x - o.x, s.y - o.y );
+                float uu = one_over_determinant * (v.y * p.x - v.x * p.y);
+                float vv = one_over_determinant * (u.x * p.y - u.y * p.x);
+
+                const float EPSILON = -0.01f;
+                if ( uu >= EPSILON & vv >= EPSILON & uu + vv < 1.0f )
+                {
+                    float* depth = sample_buffer->depth( x, y );
+                    float z = o.z + u.z * uu + v.z * vv;
+                    if ( z < *depth )
+                    {
+                        if ( opaque )
+                        {
+                            *depth = z;
+                        }
+                        sample->u_ = uu;
+                        sample->v_ = vv;
+                        sample->z_ = z;
+                        sample->index_ = polygon;
+                        sample->x_ = x;
+                        sample->y_ = y;
+                        ++sample;
+                    }
+                }
+            }
+        }
+    }
+    return sample;
+}
+
+bool Sampler::calculate_visible( int polygons, const SampleBuffer* sample_buffer ) const
+{
+    REYES_ASSERT( sample_buffer );
+    REYES_ASSERT( polygons >= 0 );
 
     for ( int i = 0; i < polygons; ++i )
     {
@@ -332,13 +1352,6 @@ void Sampler::calculate_samples( const math::vec3* colors, const math::vec3* opa
         int sy0 = bounds_[i * 4 + 2];
         int sy1 = bounds_[i * 4 + 3];
 
-        int samples = sample - samples_;
-        if ( samples > 0 && samples + (sy1 - sy0) * (sx1 - sx0) > MAXIMUM_SAMPLES )
-        {
-            calculate_colors_in_sample_buffer( colors, opacities, matte, samples, sample_buffer );
-            sample = samples_;
-        }
-    
         const vec3& o = origins_and_edges_[i * 3 + 0];
         const vec3& u = origins_and_edges_[i * 3 + 1];
         const vec3& v = origins_and_edges_[i * 3 + 2];
@@ -349,85 +1362,171 @@ void Sampler::calculate_samples( const math::vec3* colors, const math::vec3* opa
         {
             for ( int x = sx0; x < sx1; ++x )
             {
-                const vec3& s = *reinterpret_cast<const vec3*>( sample_buffer->position(x, y) );
-                vec3 p = s - o;
+                const vec2 s = sample_buffer->position( x, y );
+                const vec2 p = vec2( s.x - o.x, s.y - o.y );
                 float uu = one_over_determinant * (v.y * p.x - v.x * p.y);
                 float vv = one_over_determinant * (u.x * p.y - u.y * p.x);
 
                 const float EPSILON = -0.01f;
                 if ( uu >= EPSILON & vv >= EPSILON & uu + vv < 1.0f )
                 {
-                    float* depth = sample_buffer->depth( x, y );
                     float z = o.z + u.z * uu + v.z * vv;
-                    if ( z < *depth )
+                    if ( z < *sample_buffer->depth(x, y) )
                     {
-                        *depth = z;
-                        sample->u_ = uu;
-                        sample->v_ = vv;
-                        sample->index_ = i;
-                        sample->x_ = x;
-                        sample->y_ = y;
-                        ++sample;
+                        return true;
                     }
                 }
             }
         }
-    }    
-
-    int samples = sample - samples_;
-    if ( samples > 0 )
-    {
-        calculate_colors_in_sample_buffer( colors, opacities, matte, samples, sample_buffer );
     }
+    return false;
 }
 
-void Sampler::calculate_colors_in_sample_buffer( const math::vec3* colors, const math::vec3* opacities, bool matte, int samples, SampleBuffer* sample_buffer )
+void Sampler::calculate_colors_in_sample_buffer( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, bool quads, const Sample* samples, int count, SampleBuffer* sample_buffer ) const
 {
     REYES_ASSERT( colors );
     REYES_ASSERT( opacities );
-    REYES_ASSERT( samples >= 0 );
+    REYES_ASSERT( samples );
+    REYES_ASSERT( count >= 0 );
     REYES_ASSERT( sample_buffer );
-    REYES_ASSERT( samples_ );
 
     if ( matte )
     {
         const vec4 matte_color( 0.0f, 0.0f, 0.0f, 0.0f );
-        for ( int i = 0; i < samples; ++i )
+        for ( int i = 0; i < count; ++i )
         {
-            const Sample* sample = &samples_[i];
+            const Sample* sample = &samples[i];
             vec4* color_address = reinterpret_cast<vec4*>(sample_buffer->color( sample->x_, sample->y_ ));
             *color_address = matte_color;
         }
     }
     else
     {
-        for ( int i = 0; i < samples; ++i )
+        for ( int i = 0; i < count; ++i )
         {
-            const Sample* sample = &samples_[i];
+            const Sample* sample = &samples[i];
             
             float uu = clamp( sample->u_, 0.0f, 1.0f );
             float vv = clamp( sample->v_, 0.0f, 1.0f );
             
             int index = sample->index_;
-            int i0 = indices_[index * 3 + 0];
-            int i1 = indices_[index * 3 + 1];
-            int i2 = indices_[index * 3 + 2];
-            
-            const vec3& c0 = colors[i0];
-            const vec3& c1 = colors[i1];
-            const vec3& c2 = colors[i2];
-            
-            const vec3& o0 = opacities[i0];
-            const vec3& o1 = opacities[i1];
-            const vec3& o2 = opacities[i2];
-            
-            vec4* color = reinterpret_cast<vec4*>(sample_buffer->color( sample->x_, sample->y_ ));
-            *color = vec4(
-                lerp(lerp(c0, c1, uu), lerp(c0, c2, vv), 0.5f),
-                lerp(lerp(o0, o1, uu), lerp(o0, o2, vv), 0.5f).x
-            );
+            vec3 color;
+            vec3 opacity;
+            if ( quads )
+            {
+                const int* indices = &indices_[index * 4];
+                color = lerp( lerp(colors[indices[0]], colors[indices[1]], uu), lerp(colors[indices[2]], colors[indices[3]], uu), vv );
+                opacity = lerp( lerp(opacities[indices[0]], opacities[indices[1]], uu), lerp(opacities[indices[2]], opacities[indices[3]], uu), vv );
+            }
+            else
+            {
+                int i0 = indices_[index * 3 + 0];
+                int i1 = indices_[index * 3 + 1];
+                int i2 = indices_[index * 3 + 2];
+                
+                const vec3& c0 = colors[i0];
+                const vec3& c1 = colors[i1];
+                const vec3& c2 = colors[i2];
+                
+                const vec3& o0 = opacities[i0];
+                const vec3& o1 = opacities[i1];
+                const vec3& o2 = opacities[i2];
+                
+                color = lerp( lerp(c0, c1, uu), lerp(c0, c2, vv), 0.5f );
+                opacity = lerp( lerp(o0, o1, uu), lerp(o0, o2, vv), 0.5f );
+            }
+
+            if ( opaque )
+            {
+                vec4* color_address = reinterpret_cast<vec4*>(sample_buffer->color( sample->x_, sample->y_ ));
+                *color_address = vec4( color, (opacity.x + opacity.y + opacity.z) / 3.0f );
+            }
+            else
+            {
+                sample_buffer->insert_visible_point( sample->x_, sample->y_, sample->z_, color, opacity );
+            }
+        }
+    }
+
+    // Output variables are only kept for the nearest opaque micropolygon at
+    // each sample.
+    if ( opaque && !outputs_.empty() )
+    {
+        calculate_outputs_in_sample_buffer( matte, quads, samples, count, sample_buffer );
+    }
+}
+
+void Sampler::calculate_outputs_in_sample_buffer( bool matte, bool quads, const Sample* samples, int count, SampleBuffer* sample_buffer ) const
+{
+    REYES_ASSERT( samples );
+    REYES_ASSERT( count >= 0 );
+    REYES_ASSERT( sample_buffer );
+    REYES_ASSERT( sample_buffer->output_elements() > 0 );
+
+    const int output_elements = sample_buffer->output_elements();
+    for ( int i = 0; i < count; ++i )
+    {
+        const Sample* sample = &samples[i];
+        float* output = sample_buffer->output( sample->x_, sample->y_ );
+        if ( matte )
+        {
+            memset( output, 0, sizeof(float) * output_elements );
+            continue;
+        }
+
+        // The same interpolation as colors expressed as a weight for each
+        // of the micropolygon's vertices.
+        const float uu = clamp( sample->u_, 0.0f, 1.0f );
+        const float vv = clamp( sample->v_, 0.0f, 1.0f );
+        const int* indices = quads ? &indices_[sample->index_ * 4] : &indices_[sample->index_ * 3];
+        const int vertices = quads ? 4 : 3;
+        float weights [4];
+        if ( quads )
+        {
+            weights[0] = (1.0f - uu) * (1.0f - vv);
+            weights[1] = uu * (1.0f - vv);
+            weights[2] = (1.0f - uu) * vv;
+            weights[3] = uu * vv;
+        }
+        else
+        {
+            weights[0] = 1.0f - 0.5f * (uu + vv);
+            weights[1] = 0.5f * uu;
+            weights[2] = 0.5f * vv;
+        }
+
+        for ( const Output& variable : outputs_ )
+        {
+            for ( int element = 0; element < variable.elements_; ++element )
+            {
+                float value = 0.0f;
+                if ( variable.values_ )
+                {
+                    for ( int vertex = 0; vertex < vertices; ++vertex )
+                    {
+                        value += weights[vertex] * variable.values_[indices[vertex] * variable.stride_ + element];
+                    }
+                }
+                output[element] = value;
+            }
+            output += variable.elements_;
+        }
+    }
+}
+
+bool Sampler::opaque( const math::vec3* opacities, int vertices, float opacity_threshold ) const
+{
+    REYES_ASSERT( opacities );
+    REYES_ASSERT( vertices >= 0 );
+    for ( int i = 0; i < vertices; ++i )
+    {
+        const vec3& opacity = opacities[i];
+        if ( opacity.x < opacity_threshold || opacity.y < opacity_threshold || opacity.z < opacity_threshold )
+        {
+            return false;
         }
     }
+    return true;
 }
 
 float Sampler::min( float a, float b, float c ) const
@@ -1,13 +1,18 @@
 #pragma once
 
+#include "MicropolygonShape.hpp"
+#include <math/vec2.hpp>
 #include <math/vec3.hpp>
 #include <math/mat4x4.hpp>
+#include <vector>
+#include <string>
 
 namespace reyes
 {
 
 class Grid;
 class SampleBuffer;
+class ThreadPool;
 
 /**
 // Sample the micropolygons in a diced grid down into a sample buffer.
@@ -18,14 +23,38 @@ class Sampler
     {
         float u_; ///< The u parameter of this sample for color interpolation.
         float v_; ///< The v parameter of this sample for color interpolation.
+        float z_; ///< The depth of the micropolygon at this sample.
         int index_; ///< Index of the micropolygon that this sample is for.
         short x_; ///< The x coordinate of the sample in the sample buffer that this sample applies to.
         short y_; ///< The y coordinate of the sample in the sample buffer that this sample applies to.
     };
 
+    struct Band
+    {
+        Sample* samples_; ///< The samples found in this band waiting for their colors to be written.
+        int maximum_samples_; ///< The number of samples allocated in samples_.
+        int written_x0_; ///< The left of the bound of the samples written in this band.
+        int written_x1_; ///< The right of the bound of the samples written in this band.
+        int written_y0_; ///< The top of the bound of the samples written in this band.
+        int written_y1_; ///< The bottom of the bound of the samples written in this band.
+    };
+
+    struct Output
+    {
+        std::string identifier_; ///< The identifier of the shader variable sampled into this output.
+        int elements_; ///< The number of floats in each value of the variable.
+        const float* values_; ///< The values of the variable in the grid being sampled (null if the grid doesn't have it).
+        int stride_; ///< The number of floats between the values at neighbouring vertices (0 for uniform values).
+    };
+
     const float width_;
     const float height_;
+    const float lens_radius_;
+    const float focal_distance_;
+    const MicropolygonShape micropolygon_shape_;
+    int simd_lanes_;
     int maximum_vertices_;
+    int maximum_polygons_;
     int x0_;
     int x1_;
     int y0_;
@@ -34,26 +63,60 @@ class Sampler
     int* indices_;
     int* bounds_;
     int polygons_;
-    Sample* samples_;
-    math::vec3* raster_positions_;
+    std::vector<Band> bands_;
+    ThreadPool* thread_pool_;
+    std::vector<Output> outputs_;
+    float* raster_xs_;
+    float* raster_ys_;
+    float* raster_zs_;
+    math::vec3* motion_raster_positions_;
+    math::vec2* circles_of_confusion_;
     
 public:
-    Sampler( float width, float height, const math::vec4& crop_window );
+    Sampler( float width, float height, const math::vec4& crop_window, int maximum_vertices, float lens_radius = 0.0f, float focal_distance = 1.0f, MicropolygonShape micropolygon_shape = MICROPOLYGON_SHAPE_TRIANGLES );
     ~Sampler();    
-    void sample( const math::mat4x4& screen_transform, const Grid& grid, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer );
+    void set_thread_pool( ThreadPool* thread_pool );
+    int simd_lanes() const;
+    void set_simd_lanes( int simd_lanes );
+    void add_output( const std::string& identifier, int elements );
+    void sample( const math::mat4x4& screen_transform, const Grid& grid, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform = nullptr );
+    void sample( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, const math::vec3* colors, const math::vec3* opacities, const float* outputs, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform = nullptr );
+    void copy_outputs( const Grid& grid, std::vector<float>* values );
+    bool visible( const math::mat4x4& screen_transform, const Grid& grid, bool two_sided, bool left_handed, const SampleBuffer* sample_buffer );
     
 private:
     void reset();
+    void bind_outputs( const Grid* grid );
+    void bind_outputs( const float* values, int vertices );
+    void sample_micropolygons( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, const math::vec3* colors, const math::vec3* opacities, bool matte, bool two_sided, bool left_handed, SampleBuffer* sample_buffer, const math::mat4x4* motion_screen_transform );
+    void calculate_polygons( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, bool two_sided, bool left_handed, bool cull_outside, const SampleBuffer* sample_buffer );
     void reserve( int maximum_vertices );
-    void calculate_raster_positions( const math::mat4x4& screen_transform, const math::vec3* positions, int vertices );
-    void calculate_indices_origins_and_edges( const Grid& grid, bool two_sided, bool left_handed );
-    void calculate_indices_origins_and_edges_two_sided( const Grid& grid );
-    void calculate_indices_origins_and_edges_left_handed( const Grid& grid );
-    void calculate_indices_origins_and_edges_right_handed( const Grid& grid );
-    void calculate_bounds( int width, int height, int polygons );
-    void calculate_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, int polygons, SampleBuffer* sample_buffer );
-    void calculate_colors_in_sample_buffer( const math::vec3* colors, const math::vec3* opacities, bool matte, int samples, SampleBuffer* sample_buffer );
+    void calculate_raster_positions( const math::mat4x4& screen_transform, const math::vec3* positions, int vertices, math::vec3* raster_positions );
+    void calculate_circles_of_confusion( const math::mat4x4& screen_transform, const math::vec3* positions, int vertices );
+    void project_vertices( const math::mat4x4& screen_transform, const math::vec3* positions, int first, int vertices );
+    void calculate_quad_polygons( int i0, int width, int facing, bool cull_outside, int x0, int x1, int y0, int y1 );
+    int calculate_row_polygons_sse( int row, int width, int facing, bool cull_outside, int x0, int x1, int y0, int y1 );
+    void add_polygon( int i0, int i1, int i2, int x0, int x1, int y0, int y1 );
+    void calculate_quads( const math::mat4x4& screen_transform, int width, int height, const math::vec3* positions, bool two_sided, bool left_handed, const SampleBuffer* sample_buffer );
+    void add_quad( int i0, int width, int facing, int x0, int x1, int y0, int y1 );
+    math::vec3 raster_position( int index ) const;
+    void calculate_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, int polygons, SampleBuffer* sample_buffer );
+    int bands( bool opaque, int polygons, int* y0, int* y1 ) const;
+    void sample_rows( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, int polygons, int y0, int y1, Band* band, SampleBuffer* sample_buffer ) const;
+    void reserve_samples( Band* band, int samples ) const;
+    Sample* sample_polygon_in_tiles( int polygon, int sx0, int sx1, int sy0, int sy1, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    Sample* sample_polygon_region( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    Sample* sample_quad( int polygon, int sx0, int sx1, int sy0, int sy1, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    Sample* sample_polygon( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    Sample* sample_polygon_sse( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    Sample* sample_polygon_avx2( int polygon, int sx0, int sx1, int sy0, int sy1, bool covered, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    void calculate_blurred_samples( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, bool two_sided, bool left_handed, int polygons, SampleBuffer* sample_buffer );
+    Sample* sample_blurred_polygon( int polygon, bool lens_bins, int bin, int sx0, int sx1, int sy0, int sy1, bool two_sided, bool left_handed, bool opaque, Sample* sample, SampleBuffer* sample_buffer ) const;
+    bool calculate_visible( int polygons, const SampleBuffer* sample_buffer ) const;
+    void calculate_colors_in_sample_buffer( const math::vec3* colors, const math::vec3* opacities, bool matte, bool opaque, bool quads, const Sample* samples, int count, SampleBuffer* sample_buffer ) const;
+    void calculate_outputs_in_sample_buffer( bool matte, bool quads, const Sample* samples, int count, SampleBuffer* sample_buffer ) const;
 
+    bool opaque( const math::vec3* opacities, int vertices, float opacity_threshold ) const;
     float min( float a, float b, float c ) const;
     float max( float a, float b, float c ) const;
 };
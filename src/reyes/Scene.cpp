@@ -0,0 +1,72 @@
+//
+// Scene.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Scene.hpp"
+#include "Primitive.hpp"
+#include "assert.hpp"
+
+using std::shared_ptr;
+using namespace reyes;
+
+Scene::Scene()
+: primitives_()
+, maximum_vertices_( 0 )
+{
+}
+
+Scene::~Scene()
+{
+}
+
+int Scene::primitives() const
+{
+    return int(primitives_.size());
+}
+
+const Primitive& Scene::primitive( int index ) const
+{
+    REYES_ASSERT( index >= 0 && index < int(primitives_.size()) );
+    return *primitives_[index];
+}
+
+/**
+// Get the maximum grid size that this scene was recorded with.
+//
+// @return
+//  The maximum number of vertices in a grid diced when the primitives in 
+//  this scene were recorded or 0 if this scene is empty.
+*/
+int Scene::maximum_vertices() const
+{
+    return maximum_vertices_;
+}
+
+/**
+// Add a primitive to this scene.
+//
+// @param primitive
+//  The primitive to add; its transform is from object to world space
+//  (assumed not null).
+//
+// @param maximum_vertices
+//  The maximum grid size that the shaders in the primitive's attributes 
+//  were compiled for (assumed to match any primitives already recorded).
+*/
+void Scene::add( const std::shared_ptr<Primitive>& primitive, int maximum_vertices )
+{
+    REYES_ASSERT( primitive );
+    REYES_ASSERT( primitives_.empty() || maximum_vertices == maximum_vertices_ );
+    primitives_.push_back( primitive );
+    maximum_vertices_ = maximum_vertices;
+}
+
+/**
+// Remove every primitive from this scene.
+*/
+void Scene::clear()
+{
+    primitives_.clear();
+    maximum_vertices_ = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+namespace reyes
+{
+
+class Primitive;
+
+/**
+// Primitives recorded once so that they can be rendered in any number of
+// frames.
+//
+// Each primitive is recorded with a copy of the attributes and the object
+// to world transform that were current when it was submitted.  Shader and
+// coordinate system transforms in the recorded attributes are kept relative
+// to world space so that the primitives can be rendered from any camera.
+//
+// A scene is lit by the light shaders that are active when it is rendered
+// rather than by those active when it was recorded so that lights can be
+// moved and their parameters changed between frames without recording the
+// scene again.
+//
+// The recorded attributes refer to shaders loaded by the renderer that the
+// scene was recorded with so a scene can only be rendered by that renderer
+// and only with the same maximum grid size.  The renderer refuses to record
+// or render a scene with any other maximum grid size.
+*/
+class Scene
+{
+    std::vector<std::shared_ptr<Primitive>> primitives_; ///< The primitives recorded in this scene.
+    int maximum_vertices_; ///< The maximum grid size that the shaders of the recorded primitives were compiled for.
+
+public:
+    Scene();
+    ~Scene();
+    int primitives() const;
+    const Primitive& primitive( int index ) const;
+    int maximum_vertices() const;
+    void add( const std::shared_ptr<Primitive>& primitive, int maximum_vertices );
+    void clear();
+
+private:
+    Scene( const Scene& ) = delete;
+    Scene& operator=( const Scene& ) = delete;
+};
+
+}
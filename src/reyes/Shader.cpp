@@ -25,66 +25,71 @@ Shader::Shader()
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , maximum_vertices_( 0 )
+, overlap_rows_( 0 )
 , constant_memory_size_( 0 )
 , grid_memory_size_( 0 )
 , temporary_memory_size_( 0 )
 {
 }
 
-Shader::Shader( const char* filename, ErrorPolicy& error_policy )
+Shader::Shader( const char* filename, ErrorPolicy& error_policy, int maximum_vertices )
 : symbols_()
 , constants_()
 , code_()
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , maximum_vertices_( 0 )
+, overlap_rows_( 0 )
 , constant_memory_size_( 0 )
 , grid_memory_size_( 0 )
 , temporary_memory_size_( 0 )
 {
-    load_file( filename, error_policy );
+    load_file( filename, error_policy, maximum_vertices );
 }
 
-Shader::Shader( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy )
+Shader::Shader( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices )
 : symbols_()
 , constants_()
 , code_()
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , maximum_vertices_( 0 )
+, overlap_rows_( 0 )
 , constant_memory_size_( 0 )
 , grid_memory_size_( 0 )
 , temporary_memory_size_( 0 )
 {
-    load_file( filename, symbol_table, error_policy );
+    load_file( filename, symbol_table, error_policy, maximum_vertices );
 }
 
-Shader::Shader( const char* start, const char* finish, ErrorPolicy& error_policy )
+Shader::Shader( const char* start, const char* finish, ErrorPolicy& error_policy, int maximum_vertices )
 : symbols_()
 , constants_()
 , code_()
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , maximum_vertices_( 0 )
+, overlap_rows_( 0 )
 , constant_memory_size_( 0 )
 , grid_memory_size_( 0 )
 , temporary_memory_size_( 0 )
 {
-    load_memory( start, finish, error_policy );
+    load_memory( start, finish, error_policy, maximum_vertices );
 }
 
-Shader::Shader( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy )
+Shader::Shader( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices )
 : symbols_()
 , constants_()
 , code_()
 , initialize_address_( 0 )
 , shade_address_( 0 )
 , maximum_vertices_( 0 )
+, overlap_rows_( 0 )
 , constant_memory_size_( 0 )
 , grid_memory_size_( 0 )
 , temporary_memory_size_( 0 )
 {
-    load_memory( start, finish, symbol_table, error_policy );
+    load_memory( start, finish, symbol_table, error_policy, maximum_vertices );
 }
 
 const Symbol* Shader::symbol( int index ) const
@@ -129,6 +134,11 @@ int Shader::maximum_vertices() const
     return maximum_vertices_;
 }
 
+int Shader::overlap_rows() const
+{
+    return overlap_rows_;
+}
+
 int Shader::constant_memory_size() const
 {
     return constant_memory_size_;
@@ -154,13 +164,13 @@ std::shared_ptr<Symbol> Shader::find_symbol( const std::string& identifier ) con
     return i != symbols_.end() ? *i : shared_ptr<Symbol>();
 }
 
-void Shader::load_file( const char* filename, ErrorPolicy& error_policy )
+void Shader::load_file( const char* filename, ErrorPolicy& error_policy, int maximum_vertices )
 {
     SymbolTable symbol_table;
-    load_file( filename, symbol_table, error_policy );
+    load_file( filename, symbol_table, error_policy, maximum_vertices );
 }
 
-void Shader::load_file( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy )
+void Shader::load_file( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices )
 {
     REYES_ASSERT( filename );
     REYES_ASSERT( symbol_table );
@@ -172,7 +182,7 @@ void Shader::load_file( const char* filename, SymbolTable& symbol_table, ErrorPo
     SemanticAnalyzer semantic_analyzer( &symbol_table, &error_policy );
     semantic_analyzer.analyze( syntax_node.get(), filename );
 
-    CodeGenerator code_generator( &error_policy );
+    CodeGenerator code_generator( &error_policy, maximum_vertices );
     code_generator.generate( syntax_node.get(), filename );
     
     constants_ = code_generator.constant_data();
@@ -182,18 +192,19 @@ void Shader::load_file( const char* filename, SymbolTable& symbol_table, ErrorPo
     initialize_address_ = code_generator.initialize_address();
     shade_address_ = code_generator.shade_address();
     maximum_vertices_ = code_generator.maximum_vertices();
+    overlap_rows_ = code_generator.overlap_rows();
     constant_memory_size_ = code_generator.constant_memory_size();
     grid_memory_size_ = code_generator.grid_memory_size();
     temporary_memory_size_ = code_generator.temporary_memory_size();
 }
 
-void Shader::load_memory( const char* start, const char* finish, ErrorPolicy& error_policy )
+void Shader::load_memory( const char* start, const char* finish, ErrorPolicy& error_policy, int maximum_vertices )
 {
     SymbolTable symbol_table;
-    load_memory( start, finish, symbol_table, error_policy );
+    load_memory( start, finish, symbol_table, error_policy, maximum_vertices );
 }
 
-void Shader::load_memory( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy )
+void Shader::load_memory( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices )
 {
     REYES_ASSERT( start );
     REYES_ASSERT( finish );
@@ -205,7 +216,7 @@ void Shader::load_memory( const char* start, const char* finish, SymbolTable& sy
     SemanticAnalyzer semantic_analyzer( &symbol_table, &error_policy );
     semantic_analyzer.analyze( syntax_node.get(), "from memory" );
 
-    CodeGenerator code_generator( &error_policy );
+    CodeGenerator code_generator( &error_policy, maximum_vertices );
     code_generator.generate( syntax_node.get(), "from memory" );
     
     constants_ = code_generator.constant_data();
@@ -214,6 +225,7 @@ void Shader::load_memory( const char* start, const char* finish, SymbolTable& sy
     initialize_address_ = code_generator.initialize_address();
     shade_address_ = code_generator.shade_address();
     maximum_vertices_ = code_generator.maximum_vertices();
+    overlap_rows_ = code_generator.overlap_rows();
     constant_memory_size_ = code_generator.constant_memory_size();
     grid_memory_size_ = code_generator.grid_memory_size();
     temporary_memory_size_ = code_generator.temporary_memory_size();
@@ -25,16 +25,17 @@ class Shader
     int initialize_address_; ///< The index of the start of the initialize code fragment.
     int shade_address_; ///< The index of the start of the shade code fragment.
     int maximum_vertices_; ///< The maximum number of values in a varying variable.
+    int overlap_rows_; ///< The number of neighbouring grid rows read by shading each vertex (INT_MAX if unbounded).
     int constant_memory_size_; ///< The size of constant memory used by this shader.
     int grid_memory_size_; ///< The size of grid memory used by this shader.
     int temporary_memory_size_; ///< The size of temporary memory used by this shader.
 
 public:
     Shader();
-    Shader( const char* filename, ErrorPolicy& error_policy );
-    Shader( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy );
-    Shader( const char* start, const char* finish, ErrorPolicy& error_policy );
-    Shader( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy );
+    Shader( const char* filename, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    Shader( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    Shader( const char* start, const char* finish, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    Shader( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
 
     const Symbol* symbol( int index ) const;
     const std::vector<std::shared_ptr<Symbol>>& symbols() const;
@@ -44,15 +45,16 @@ public:
     int shade_address() const;
     int end_address() const;
     int maximum_vertices() const;
+    int overlap_rows() const;
     int constant_memory_size() const;
     int grid_memory_size() const;
     int temporary_memory_size() const;
     std::shared_ptr<Symbol> find_symbol( const std::string& identitifer ) const;
 
-    void load_file( const char* filename, ErrorPolicy& error_policy );
-    void load_file( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy );
-    void load_memory( const char* start, const char* finish, ErrorPolicy& error_policy );
-    void load_memory( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy );
+    void load_file( const char* filename, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    void load_file( const char* filename, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    void load_memory( const char* start, const char* finish, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
+    void load_memory( const char* start, const char* finish, SymbolTable& symbol_table, ErrorPolicy& error_policy, int maximum_vertices = 64 * 64 );
 };
 
 }
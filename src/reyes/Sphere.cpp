@@ -5,6 +5,7 @@
 
 #include "Sphere.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -16,9 +17,7 @@
 
 using std::min;
 using std::max;
-using std::list;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -49,32 +48,32 @@ Sphere::Sphere( const Sphere& sphere, const math::vec2& u_range, const math::vec
 {   
 }
 
+Geometry* Sphere::clone() const
+{
+    return new Sphere( *this );
+}
+
 bool Sphere::boundable() const
 {
     return true;
 }
 
-void Sphere::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* grid ) const
+void Sphere::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
-    {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
-    }
+
+    const float PI = float(M_PI);    
+    const vec2& u_range = Geometry::u_range();
+    const vec2& v_range = Geometry::v_range();
+    float phimin = zmin_ > -radius_ ? asinf( zmin_ / radius_ ) : -PI / 2.0f;
+    float phimax = zmax_ < radius_ ? asinf( zmax_ / radius_ ) : PI / 2.0f;
+    float phi0 = phimin + v_range.x * (phimax - phimin);
+    float phi1 = phimin + v_range.y * (phimax - phimin);
+    vec2 c = cos_range( phi0, phi1 );
+    vec2 radius_range = ordered( radius_ * c.x, radius_ * c.y );
+    vec2 z_range = ordered( radius_ * sinf(phi0), radius_ * sinf(phi1) );
+    bound_revolution( transform, radius_range, vec2(u_range.x * thetamax_, u_range.y * thetamax_), z_range, minimum, maximum );
 }
 
 bool Sphere::splittable() const
@@ -82,9 +81,9 @@ bool Sphere::splittable() const
     return true;
 }
 
-void Sphere::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
+void Sphere::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -98,15 +97,10 @@ void Sphere::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> sphere;
-    sphere.reset( new Sphere(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( sphere );
-    sphere.reset( new Sphere(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( sphere );
-    sphere.reset( new Sphere(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( sphere );
-    sphere.reset( new Sphere(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( sphere );
+    split_stack->emplace<Sphere>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<Sphere>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<Sphere>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<Sphere>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool Sphere::diceable() const
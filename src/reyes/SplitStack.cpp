@@ -0,0 +1,116 @@
+//
+// SplitStack.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "SplitStack.hpp"
+#include "Geometry.hpp"
+#include "assert.hpp"
+#include <stdlib.h>
+
+using std::vector;
+using namespace reyes;
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+static const size_t ALIGNMENT = 16;
+
+SplitStack::SplitStack()
+: blocks_()
+, block_( 0 )
+, offset_( 0 )
+, geometries_()
+, constructed_()
+{
+    const unsigned int GEOMETRIES_RESERVE = 64;
+    geometries_.reserve( GEOMETRIES_RESERVE );
+    constructed_.reserve( GEOMETRIES_RESERVE );
+}
+
+SplitStack::~SplitStack()
+{
+    clear();
+    for ( vector<unsigned char*>::const_iterator i = blocks_.begin(); i != blocks_.end(); ++i )
+    {
+        free( *i );
+    }
+    blocks_.clear();
+}
+
+bool SplitStack::empty() const
+{
+    return geometries_.empty();
+}
+
+int SplitStack::size() const
+{
+    return int(geometries_.size());
+}
+
+const Geometry* SplitStack::top() const
+{
+    REYES_ASSERT( !geometries_.empty() );
+    return geometries_.back();
+}
+
+/**
+// Push geometry that isn't owned by this stack.
+//
+// @param geometry
+//  The geometry to push (assumed not null and to outlive this stack's use
+//  of it).
+*/
+void SplitStack::push( const Geometry* geometry )
+{
+    REYES_ASSERT( geometry );
+    geometries_.push_back( geometry );
+}
+
+/**
+// Pop the geometry on the top of this stack.
+//
+// Pieces constructed by this stack aren't destroyed until it is cleared.
+*/
+void SplitStack::pop()
+{
+    REYES_ASSERT( !geometries_.empty() );
+    geometries_.pop_back();
+}
+
+/**
+// Empty this stack and destroy every piece constructed in it.
+//
+// The blocks of memory that pieces were constructed in are kept and reused
+// for the pieces constructed after this call.
+*/
+void SplitStack::clear()
+{
+    for ( vector<Geometry*>::const_reverse_iterator i = constructed_.rbegin(); i != constructed_.rend(); ++i )
+    {
+        Geometry* geometry = *i;
+        geometry->~Geometry();
+    }
+    constructed_.clear();
+    geometries_.clear();
+    block_ = 0;
+    offset_ = 0;
+}
+
+void* SplitStack::allocate( size_t size )
+{
+    REYES_ASSERT( size <= BLOCK_SIZE );
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if ( block_ < int(blocks_.size()) && offset_ + size > BLOCK_SIZE )
+    {
+        ++block_;
+        offset_ = 0;
+    }
+    if ( block_ == int(blocks_.size()) )
+    {
+        unsigned char* block = reinterpret_cast<unsigned char*>( malloc(BLOCK_SIZE) );
+        REYES_ASSERT( block );
+        blocks_.push_back( block );
+    }
+    void* memory = blocks_[block_] + offset_;
+    offset_ += size;
+    return memory;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <stddef.h>
+
+namespace reyes
+{
+
+class Geometry;
+
+/**
+// A depth first stack of the geometry waiting to be split or diced.
+//
+// The pieces that geometry is split into are constructed in place in large
+// blocks of memory owned by the stack rather than allocated individually and
+// reference counted.  Pieces are popped in the reverse of the order that
+// they're pushed so that the most recently split geometry is finished before
+// its siblings are started.  Nothing is freed until the stack is cleared at
+// which point every piece is destroyed at once and the blocks are kept for
+// the next piece of geometry to be split.
+*/
+class SplitStack
+{
+    std::vector<unsigned char*> blocks_; ///< The blocks of memory that pieces are constructed in.
+    int block_; ///< The index of the block that pieces are being constructed in.
+    size_t offset_; ///< The offset of the first free byte in the current block.
+    std::vector<const Geometry*> geometries_; ///< The geometry waiting to be split or diced (the top at the back).
+    std::vector<Geometry*> constructed_; ///< The pieces constructed in blocks since the last clear.
+
+public:
+    SplitStack();
+    ~SplitStack();
+    bool empty() const;
+    int size() const;
+    const Geometry* top() const;
+    void push( const Geometry* geometry );
+    template <class Type, class... Arguments> void emplace( Arguments&&... arguments );
+    void pop();
+    void clear();
+
+private:
+    void* allocate( size_t size );
+    SplitStack( const SplitStack& ) = delete;
+    SplitStack& operator=( const SplitStack& ) = delete;
+};
+
+/**
+// Construct a piece of split geometry in this stack's memory and push it.
+//
+// The piece stays valid after it is popped until this stack is cleared so
+// that geometry popped to be split can still be read while its pieces are
+// being constructed.
+//
+// @param arguments
+//  The arguments to pass to the constructor of the piece.
+*/
+template <class Type, class... Arguments>
+void SplitStack::emplace( Arguments&&... arguments )
+{
+    Type* geometry = new (allocate(sizeof(Type))) Type( std::forward<Arguments>(arguments)... );
+    constructed_.push_back( geometry );
+    geometries_.push_back( geometry );
+}
+
+}
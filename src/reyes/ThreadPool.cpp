@@ -0,0 +1,236 @@
+//
+// ThreadPool.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+#include "assert.hpp"
+#include <algorithm>
+
+using std::max;
+using std::mutex;
+using std::thread;
+using std::function;
+using std::unique_lock;
+using std::lock_guard;
+using namespace reyes;
+
+/**
+// Constructor.
+//
+// @param threads
+//  The number of threads that take part in each loop including the thread
+//  that starts the loop (values less than 1 are treated as 1).
+*/
+ThreadPool::ThreadPool( int threads )
+: threads_()
+, queues_()
+, mutex_()
+, started_()
+, finished_()
+, function_( nullptr )
+, remaining_( 0 )
+, loop_( 0 )
+, active_( 0 )
+, done_( false )
+{
+    threads = max( 1, threads );
+    queues_.reserve( threads );
+    for ( int i = 0; i < threads; ++i )
+    {
+        queues_.push_back( std::unique_ptr<Queue>(new Queue) );
+    }
+
+    threads_.reserve( threads - 1 );
+    for ( int i = 1; i < threads; ++i )
+    {
+        threads_.push_back( thread(&ThreadPool::run, this, i) );
+    }
+}
+
+/**
+// Destructor.
+//
+// Waits for the background threads to exit.
+*/
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock( mutex_ );
+        done_ = true;
+    }
+    started_.notify_all();
+
+    for ( std::vector<thread>::iterator i = threads_.begin(); i != threads_.end(); ++i )
+    {
+        i->join();
+    }
+    threads_.clear();
+}
+
+/**
+// Get the number of threads in this pool.
+//
+// @return
+//  The number of threads including the thread that starts each loop.
+*/
+int ThreadPool::threads() const
+{
+    return int(queues_.size());
+}
+
+/**
+// Run the iterations [\e begin, \e end) of a loop across the threads in 
+// this pool.
+//
+// The iterations are shared out in contiguous runs so that neighbouring 
+// iterations start out on the same thread.  Iterations may complete in any 
+// order so \e function must produce the same result regardless of the order
+// that iterations are run in.
+//
+// @param begin
+//  The first iteration to run.
+//
+// @param end
+//  One past the last iteration to run.
+//
+// @param function
+//  The body of the loop called with the index of the thread running the
+//  iteration (in the range [0, threads())) and the iteration.
+*/
+void ThreadPool::parallel_for( int begin, int end, const std::function<void (int thread, int index)>& function )
+{
+    if ( begin >= end )
+    {
+        return;
+    }
+
+    const int threads = ThreadPool::threads();
+    const int iterations = end - begin;
+    for ( int i = 0; i < threads; ++i )
+    {
+        Queue& queue = *queues_[i];
+        lock_guard<mutex> lock( queue.mutex_ );
+        REYES_ASSERT( queue.indices_.empty() );
+        int first = begin + int(static_cast<long long>(iterations) * i / threads);
+        int last = begin + int(static_cast<long long>(iterations) * (i + 1) / threads);
+        for ( int index = first; index < last; ++index )
+        {
+            queue.indices_.push_back( index );
+        }
+    }
+
+    {
+        lock_guard<mutex> lock( mutex_ );
+        function_ = &function;
+        remaining_ = iterations;
+        ++loop_;
+    }
+    started_.notify_all();
+
+    work( 0, function );
+
+    unique_lock<mutex> lock( mutex_ );
+    while ( remaining_ > 0 || active_ > 0 )
+    {
+        finished_.wait( lock );
+    }
+    function_ = nullptr;
+}
+
+/**
+// The entry point for each background thread.
+//
+// @param thread
+//  The index of the thread.
+*/
+void ThreadPool::run( int thread )
+{
+    int loop = 0;
+    unique_lock<mutex> lock( mutex_ );
+    while ( !done_ )
+    {
+        if ( loop_ != loop && function_ )
+        {
+            loop = loop_;
+            const function<void (int, int)>& function = *function_;
+            ++active_;
+            lock.unlock();
+            work( thread, function );
+            lock.lock();
+            --active_;
+            finished_.notify_all();
+        }
+        else
+        {
+            started_.wait( lock );
+        }
+    }
+}
+
+/**
+// Run iterations of the current loop until there are none left to run.
+//
+// @param thread
+//  The index of the thread running iterations.
+//
+// @param function
+//  The body of the loop.
+*/
+void ThreadPool::work( int thread, const std::function<void (int, int)>& function )
+{
+    int index = 0;
+    while ( pop(thread, &index) )
+    {
+        function( thread, index );
+        if ( --remaining_ == 0 )
+        {
+            lock_guard<mutex> lock( mutex_ );
+            finished_.notify_all();
+        }
+    }
+}
+
+/**
+// Take the next iteration to run.
+//
+// @param thread
+//  The index of the thread taking the iteration.
+//
+// @param index
+//  A variable to receive the iteration to run (assumed not null).
+//
+// @return
+//  True if an iteration was taken from the front of this thread's queue or
+//  stolen from the back of another thread's queue otherwise false if there
+//  are no iterations left.
+*/
+bool ThreadPool::pop( int thread, int* index )
+{
+    REYES_ASSERT( index );
+
+    {
+        Queue& queue = *queues_[thread];
+        lock_guard<mutex> lock( queue.mutex_ );
+        if ( !queue.indices_.empty() )
+        {
+            *index = queue.indices_.front();
+            queue.indices_.pop_front();
+            return true;
+        }
+    }
+
+    const int threads = ThreadPool::threads();
+    for ( int i = 1; i < threads; ++i )
+    {
+        Queue& queue = *queues_[(thread + i) % threads];
+        lock_guard<mutex> lock( queue.mutex_ );
+        if ( !queue.indices_.empty() )
+        {
+            *index = queue.indices_.back();
+            queue.indices_.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+namespace reyes
+{
+
+/**
+// A pool of threads that run the iterations of a parallel loop with work
+// stealing.
+//
+// Each thread is given an equal share of the iterations in its own queue.
+// Threads take iterations from the front of their own queue and, once their
+// own queue is empty, steal iterations from the back of other threads' 
+// queues.  The thread that starts a loop takes part in it as thread 0 and
+// returns once every iteration has completed.
+*/
+class ThreadPool
+{
+    struct Queue
+    {
+        std::mutex mutex_; ///< Locks the indices in this queue.
+        std::deque<int> indices_; ///< The iterations still to run from this queue.
+    };
+
+    std::vector<std::thread> threads_; ///< The background threads (one less than the number of threads in the pool).
+    std::vector<std::unique_ptr<Queue>> queues_; ///< The queue of iterations for each thread.
+    std::mutex mutex_; ///< Locks the loop state shared with background threads.
+    std::condition_variable started_; ///< Signalled when a loop starts or the pool is destroyed.
+    std::condition_variable finished_; ///< Signalled when a background thread finishes its part of a loop.
+    const std::function<void (int, int)>* function_; ///< The body of the loop currently running.
+    std::atomic<int> remaining_; ///< The number of iterations in the current loop that haven't completed.
+    int loop_; ///< Incremented each time a loop is started.
+    int active_; ///< The number of background threads taking part in the current loop.
+    bool done_; ///< True when the pool is being destroyed.
+
+public:
+    ThreadPool( int threads );
+    ~ThreadPool();
+    int threads() const;
+    void parallel_for( int begin, int end, const std::function<void (int thread, int index)>& function );
+
+private:
+    void run( int thread );
+    void work( int thread, const std::function<void (int, int)>& function );
+    bool pop( int thread, int* index );
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+};
+
+}
@@ -5,6 +5,7 @@
 
 #include "Torus.hpp"
 #include "Grid.hpp"
+#include "SplitStack.hpp"
 #include <math/vec2.ipp>
 #include <math/vec3.ipp>
 #include <math/mat4x4.ipp>
@@ -16,9 +17,7 @@
 
 using std::min;
 using std::max;
-using std::list;
 using std::vector;
-using std::shared_ptr;
 using namespace math;
 using namespace reyes;
 
@@ -42,32 +41,30 @@ Torus::Torus( const Torus& torus, const math::vec2& u_range, const math::vec2& v
 {   
 }
 
+Geometry* Torus::clone() const
+{
+    return new Torus( *this );
+}
+
 bool Torus::boundable() const
 {
     return true;
 }
 
-void Torus::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* grid ) const
+void Torus::bound( const math::mat4x4& transform, vec3* minimum, vec3* maximum, Grid* /*grid*/ ) const
 {
     REYES_ASSERT( minimum );
     REYES_ASSERT( maximum );
-    REYES_ASSERT( grid );
-    
-    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
-    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
-    
-    dice( transform, 8, 8, grid );
-    const vec3* positions = grid->vec3_value( "P" );
-    const vec3* positions_end = positions + grid->size();
-    for ( const vec3* i = positions; i != positions_end; ++i )
-    {
-        minimum->x = min( minimum->x, i->x );
-        minimum->y = min( minimum->y, i->y );
-        minimum->z = min( minimum->z, i->z );        
-        maximum->x = max( maximum->x, i->x );
-        maximum->y = max( maximum->y, i->y );
-        maximum->z = max( maximum->z, i->z );
-    }
+
+    const vec2& u_range = Geometry::u_range();
+    const vec2& v_range = Geometry::v_range();
+    float phi0 = phimin_ + (phimax_ - phimin_) * v_range.x;
+    float phi1 = phimin_ + (phimax_ - phimin_) * v_range.y;
+    vec2 c = cos_range( phi0, phi1 );
+    vec2 s = sin_range( phi0, phi1 );
+    vec2 radius_range = ordered( rmajor_ + rminor_ * c.x, rmajor_ + rminor_ * c.y );
+    vec2 z_range = ordered( rminor_ * s.x, rminor_ * s.y );
+    bound_revolution( transform, radius_range, vec2(u_range.x * thetamax_, u_range.y * thetamax_), z_range, minimum, maximum );
 }
 
 bool Torus::splittable() const
@@ -75,9 +72,9 @@ bool Torus::splittable() const
     return true;
 }
 
-void Torus::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
+void Torus::split( SplitStack* split_stack ) const
 {
-    REYES_ASSERT( primitives );
+    REYES_ASSERT( split_stack );
     REYES_ASSERT( u_range().y >= u_range().x );
     REYES_ASSERT( v_range().y >= v_range().x );
 
@@ -91,15 +88,10 @@ void Torus::split( std::list<std::shared_ptr<Geometry>>* primitives ) const
     float v1 = (v_range.x + v_range.y) / 2.0f;
     float v2 = v_range.y;
 
-    shared_ptr<Geometry> torus;
-    torus.reset( new Torus(*this, vec2(u0, u1), vec2(v0, v1)) );
-    primitives->push_back( torus );
-    torus.reset( new Torus(*this, vec2(u0, u1), vec2(v1, v2)) );
-    primitives->push_back( torus );
-    torus.reset( new Torus(*this, vec2(u1, u2), vec2(v0, v1)) );
-    primitives->push_back( torus );
-    torus.reset( new Torus(*this, vec2(u1, u2), vec2(v1, v2)) );
-    primitives->push_back( torus );
+    split_stack->emplace<Torus>( *this, vec2(u0, u1), vec2(v0, v1) );
+    split_stack->emplace<Torus>( *this, vec2(u0, u1), vec2(v1, v2) );
+    split_stack->emplace<Torus>( *this, vec2(u1, u2), vec2(v0, v1) );
+    split_stack->emplace<Torus>( *this, vec2(u1, u2), vec2(v1, v2) );
 }
 
 bool Torus::diceable() const
@@ -12,6 +12,7 @@
 #include "Texture.hpp"
 #include "Grid.hpp"
 #include "Light.hpp"
+#include "ThreadPool.hpp"
 #include <reyes/reyes_virtual_machine/Instruction.hpp>
 #include <reyes/reyes_virtual_machine/color_functions.hpp>
 #include <reyes/reyes_virtual_machine/add.hpp>
@@ -52,6 +53,7 @@
 #include <limits.h>
 #include <string.h>
 
+using std::min;
 using std::max;
 using std::swap;
 using std::make_pair;
@@ -59,6 +61,7 @@ using std::map;
 using std::string;
 using std::vector;
 using std::shared_ptr;
+using std::make_shared;
 using namespace math;
 using namespace reyes;
 
@@ -79,6 +82,9 @@ VirtualMachine::VirtualMachine()
 , code_end_( nullptr )
 , masks_()
 , code_( nullptr )
+, thread_pool_( nullptr )
+, chunk_virtual_machines_()
+, chunk_grids_()
 {
     symbol_table_ = new SymbolTable;
 }
@@ -100,12 +106,17 @@ VirtualMachine::VirtualMachine( const Renderer& renderer )
 , code_end_( nullptr )
 , masks_()
 , code_( nullptr )
+, thread_pool_( nullptr )
+, chunk_virtual_machines_()
+, chunk_grids_()
 {
     symbol_table_ = new SymbolTable;
 }
 
 VirtualMachine::~VirtualMachine()
 {
+    set_thread_pool( nullptr );
+
     if ( temporary_memory_ )
     {
         free( temporary_memory_ );
@@ -128,6 +139,13 @@ void VirtualMachine::initialize( Grid& grid, Shader& shader )
 
 void VirtualMachine::shade( Grid& grid, Shader& shader )
 {   
+    int chunks = VirtualMachine::chunks( grid, shader );
+    if ( chunks > 1 )
+    {
+        shade_chunks( grid, shader, chunks );
+        return;
+    }
+
     grid_ = &grid;
     shader_ = &shader;
     construct( shader.shade_address(), shader.end_address() );
@@ -136,6 +154,93 @@ void VirtualMachine::shade( Grid& grid, Shader& shader )
     grid_ = nullptr;
 }
 
+void VirtualMachine::set_thread_pool( ThreadPool* thread_pool )
+{
+    thread_pool_ = thread_pool;
+    for ( VirtualMachine* virtual_machine : chunk_virtual_machines_ )
+    {
+        delete virtual_machine;
+    }
+    chunk_virtual_machines_.clear();
+    for ( Grid* grid : chunk_grids_ )
+    {
+        delete grid;
+    }
+    chunk_grids_.clear();
+}
+
+int VirtualMachine::chunks( const Grid& grid, const Shader& shader ) const
+{
+    const int MINIMUM_CHUNK_VERTICES = 1024;
+    const int MINIMUM_CHUNK_ROWS = 8;
+    const int MAXIMUM_OVERLAP_ROWS = 4;
+    if ( !thread_pool_ || grid.shader() != &shader || grid.size() < 2 * MINIMUM_CHUNK_VERTICES || shader.overlap_rows() > MAXIMUM_OVERLAP_ROWS )
+    {
+        return 1;
+    }
+    int chunks = min( grid.size() / MINIMUM_CHUNK_VERTICES, grid.height() / MINIMUM_CHUNK_ROWS );
+    return max( 1, min(chunks, thread_pool_->threads()) );
+}
+
+void VirtualMachine::shade_chunks( Grid& grid, Shader& shader, int chunks )
+{
+    REYES_ASSERT( thread_pool_ );
+    REYES_ASSERT( renderer_ );
+    REYES_ASSERT( chunks > 1 );
+
+    while ( int(chunk_virtual_machines_.size()) < chunks )
+    {
+        chunk_virtual_machines_.push_back( new VirtualMachine(*renderer_) );
+        chunk_grids_.push_back( new Grid );
+    }
+
+    // Each chunk shades a band of rows padded with the rows above and below 
+    // that neighbourhood functions (Du, Dv, area, etc) read.  All bands are 
+    // copied and shaded before any results are copied back so that no band
+    // reads shaded values from its neighbours.
+    const int width = grid.width();
+    const int height = grid.height();
+    const int overlap = shader.overlap_rows();
+    thread_pool_->parallel_for( 0, chunks, [&]( int /*thread*/, int chunk )
+    {
+        int first = height * chunk / chunks;
+        int last = height * (chunk + 1) / chunks;
+        int begin = max( 0, first - overlap );
+        int end = min( height, last + overlap );
+
+        Grid& band = *chunk_grids_[chunk];
+        if ( band.shader() != &shader )
+        {
+            band.set_shader( &shader );
+        }
+        band.resize( width, end - begin );
+        band.copy_uniforms( grid );
+        band.copy_rows( grid, begin, 0, end - begin );
+        band.clear_lights();
+        for ( const shared_ptr<Light>& light : grid.lights() )
+        {
+            band.add_light( make_shared<Light>(
+                light->type(),
+                light->color() + begin * width,
+                light->opacity() + begin * width,
+                light->position(),
+                light->axis(),
+                light->angle()
+            ) );
+        }
+        chunk_virtual_machines_[chunk]->shade( band, shader );
+    } );
+
+    thread_pool_->parallel_for( 0, chunks, [&]( int /*thread*/, int chunk )
+    {
+        int first = height * chunk / chunks;
+        int last = height * (chunk + 1) / chunks;
+        int begin = max( 0, first - overlap );
+        grid.copy_rows( *chunk_grids_[chunk], first - begin, first, last - first );
+    } );
+    grid.copy_uniforms( *chunk_grids_[0] );
+}
+
 void VirtualMachine::construct( int start, int finish )
 {
     REYES_ASSERT( grid_ );
@@ -16,6 +16,7 @@ class Grid;
 class Shader;
 class SymbolTable;
 class Renderer;
+class ThreadPool;
 
 /**
 // A virtual machine that interprets the code generated for shaders to execute
@@ -39,6 +40,9 @@ class VirtualMachine
     const unsigned char* code_end_; ///< The address one past the end of loaded code.
     const unsigned char* code_; ///< The currently executed instruction.
     std::vector<ConditionMask> masks_; ///< The stack of condition masks that specify which elements to use during assignment.
+    ThreadPool* thread_pool_; ///< The thread pool used to shade large grids in row bands (null to always shade serially).
+    std::vector<VirtualMachine*> chunk_virtual_machines_; ///< The virtual machines that shade each row band of a large grid.
+    std::vector<Grid*> chunk_grids_; ///< The grids that hold each row band of a large grid while it is shaded.
     
 public:
     VirtualMachine();
@@ -46,8 +50,11 @@ public:
     ~VirtualMachine();
     void initialize( Grid& grid, Shader& shader );
     void shade( Grid& grid, Shader& shader );
+    void set_thread_pool( ThreadPool* thread_pool );
     
 private:
+    int chunks( const Grid& grid, const Shader& shader ) const;
+    void shade_chunks( Grid& grid, Shader& shader, int chunks );
     void construct( int start, int finish );
     void execute();
     void jump_illuminance( int distance );
@@ -0,0 +1,274 @@
+//
+// VisiblePoints.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "VisiblePoints.hpp"
+#include <math/vec3.ipp>
+#include <math/vec4.ipp>
+#include "assert.hpp"
+#include <float.h>
+
+using namespace math;
+using namespace reyes;
+
+VisiblePoints::VisiblePoints( int maximum_points, float opacity_threshold )
+: width_( 0 )
+, height_( 0 )
+, maximum_points_( maximum_points )
+, opacity_threshold_( opacity_threshold )
+, firsts_()
+, points_()
+, free_( -1 )
+{
+    REYES_ASSERT( maximum_points_ > 0 );
+    REYES_ASSERT( opacity_threshold_ > 0.0f && opacity_threshold_ <= 1.0f );
+}
+
+int VisiblePoints::width() const
+{
+    return width_;
+}
+
+int VisiblePoints::height() const
+{
+    return height_;
+}
+
+int VisiblePoints::maximum_points() const
+{
+    return maximum_points_;
+}
+
+float VisiblePoints::opacity_threshold() const
+{
+    return opacity_threshold_;
+}
+
+/**
+// Are there no points at any sample?
+//
+// @return
+//  True if no points have been inserted since the last reset otherwise
+//  false.
+*/
+bool VisiblePoints::empty() const
+{
+    return points_.empty();
+}
+
+/**
+// Get the number of points allocated in the pool.
+//
+// @return
+//  The number of points allocated since the last reset including those
+//  that have since been freed and are waiting to be reused.
+*/
+int VisiblePoints::pool_size() const
+{
+    return int(points_.size());
+}
+
+/**
+// Resize to cover a \e width by \e height window of samples and remove
+// every point.
+//
+// @param width
+//  The number of samples across.
+//
+// @param height
+//  The number of samples down.
+*/
+void VisiblePoints::reset( int width, int height )
+{
+    REYES_ASSERT( width > 0 );
+    REYES_ASSERT( height > 0 );
+    width_ = width;
+    height_ = height;
+    firsts_.assign( width * height, -1 );
+    points_.clear();
+    free_ = -1;
+}
+
+/**
+// Insert a point into the list at a sample.
+//
+// Points beyond the opaque depth of the sample, points farther than
+// every point in a full list, and points behind the point at which the
+// list's accumulated opacity passes the threshold are discarded.
+//
+// @param x, y
+//  The coordinates of the sample relative to the window.
+//
+// @param depth
+//  The distance of the point from the near plane.
+//
+// @param color
+//  The color of the point (premultiplied by its opacity).
+//
+// @param opacity
+//  The opacity of the point.
+//
+// @param opaque_depth
+//  The depth of the nearest opaque surface at the sample.
+//
+// @return
+//  The depth at which the sample became opaque or FLT_MAX if its
+//  accumulated opacity is still below the threshold.
+*/
+float VisiblePoints::insert( int x, int y, float depth, const math::vec3& color, const math::vec3& opacity, float opaque_depth )
+{
+    REYES_ASSERT( x >= 0 && x < width_ );
+    REYES_ASSERT( y >= 0 && y < height_ );
+
+    if ( depth > opaque_depth )
+    {
+        return FLT_MAX;
+    }
+
+    const int sample = y * width_ + x;
+    int previous = -1;
+    int next = firsts_[sample];
+    int points = 0;
+    while ( next >= 0 && points_[next].depth_ <= depth )
+    {
+        previous = next;
+        next = points_[next].next_;
+        ++points;
+    }
+    if ( points >= maximum_points_ )
+    {
+        return FLT_MAX;
+    }
+
+    const int index = allocate();
+    VisiblePoint& inserted = points_[index];
+    inserted.depth_ = depth;
+    inserted.color_ = color;
+    inserted.opacity_ = opacity;
+    inserted.next_ = next;
+    if ( previous >= 0 )
+    {
+        points_[previous].next_ = index;
+    }
+    else
+    {
+        firsts_[sample] = index;
+    }
+
+    // Accumulate opacity front to back, dropping points behind the opaque
+    // depth, past the maximum number of points, or past the point at which
+    // the sample becomes opaque.
+    float transmittance_r = 1.0f;
+    float transmittance_g = 1.0f;
+    float transmittance_b = 1.0f;
+    const float transmittance_threshold = 1.0f - opacity_threshold_;
+    points = 0;
+    previous = -1;
+    next = firsts_[sample];
+    while ( next >= 0 )
+    {
+        VisiblePoint& point = points_[next];
+        if ( point.depth_ > opaque_depth || points == maximum_points_ )
+        {
+            break;
+        }
+        transmittance_r *= 1.0f - point.opacity_.x;
+        transmittance_g *= 1.0f - point.opacity_.y;
+        transmittance_b *= 1.0f - point.opacity_.z;
+        if ( transmittance_r <= transmittance_threshold && transmittance_g <= transmittance_threshold && transmittance_b <= transmittance_threshold )
+        {
+            release( point.next_ );
+            point.next_ = -1;
+            return point.depth_;
+        }
+        previous = next;
+        next = point.next_;
+        ++points;
+    }
+
+    if ( next >= 0 )
+    {
+        release( next );
+        if ( previous >= 0 )
+        {
+            points_[previous].next_ = -1;
+        }
+        else
+        {
+            firsts_[sample] = -1;
+        }
+    }
+    return FLT_MAX;
+}
+
+/**
+// Composite the points at a sample front to back over the opaque color at
+// that sample.
+//
+// @param x, y
+//  The coordinates of the sample relative to the window.
+//
+// @param opaque_depth
+//  The depth of the nearest opaque surface at the sample; points behind it
+//  are hidden.
+//
+// @param opaque_color
+//  The color and alpha of the nearest opaque surface at the sample.
+//
+// @return
+//  The composited color and alpha of the sample.
+*/
+math::vec4 VisiblePoints::composite( int x, int y, float opaque_depth, const math::vec4& opaque_color ) const
+{
+    REYES_ASSERT( x >= 0 && x < width_ );
+    REYES_ASSERT( y >= 0 && y < height_ );
+
+    float r = 0.0f;
+    float g = 0.0f;
+    float b = 0.0f;
+    float transmittance_r = 1.0f;
+    float transmittance_g = 1.0f;
+    float transmittance_b = 1.0f;
+    for ( int index = firsts_[y * width_ + x]; index >= 0 && points_[index].depth_ <= opaque_depth; index = points_[index].next_ )
+    {
+        const VisiblePoint& point = points_[index];
+        r += transmittance_r * point.color_.x;
+        g += transmittance_g * point.color_.y;
+        b += transmittance_b * point.color_.z;
+        transmittance_r *= 1.0f - point.opacity_.x;
+        transmittance_g *= 1.0f - point.opacity_.y;
+        transmittance_b *= 1.0f - point.opacity_.z;
+    }
+
+    const float transmittance = (transmittance_r + transmittance_g + transmittance_b) / 3.0f;
+    return vec4(
+        r + transmittance_r * opaque_color.x,
+        g + transmittance_g * opaque_color.y,
+        b + transmittance_b * opaque_color.z,
+        1.0f - transmittance * (1.0f - opaque_color.w)
+    );
+}
+
+int VisiblePoints::allocate()
+{
+    if ( free_ >= 0 )
+    {
+        const int index = free_;
+        free_ = points_[index].next_;
+        return index;
+    }
+    points_.push_back( VisiblePoint() );
+    return int(points_.size()) - 1;
+}
+
+void VisiblePoints::release( int index )
+{
+    while ( index >= 0 )
+    {
+        const int next = points_[index].next_;
+        points_[index].next_ = free_;
+        free_ = index;
+        index = next;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <math/vec3.hpp>
+#include <math/vec4.hpp>
+#include <vector>
+
+namespace reyes
+{
+
+/**
+// Depth sorted lists of the semi-transparent points visible at each sample
+// in a window of samples.
+//
+// The points for every sample are allocated from a single pool that is
+// emptied, but not freed, when the window is reset so that lists can grow
+// and shrink without allocating once the pool is large enough.  Each list
+// keeps at most a fixed number of the nearest points and is truncated at
+// the first point at which its accumulated opacity passes a threshold so
+// that the sample can be treated as opaque from there on.
+//
+// Points behind the nearest opaque surface at a sample are hidden by it but
+// points at its depth are kept; a list that becomes opaque makes the point
+// at which it did so the nearest opaque surface and that point must still
+// contribute.  Opacity is kept per channel but the alpha of a sample is its
+// coverage and is taken from the opacity averaged over the channels.
+*/
+class VisiblePoints
+{
+    struct VisiblePoint
+    {
+        float depth_; ///< The distance of this point from the near plane.
+        math::vec3 color_; ///< The color of this point (premultiplied by its opacity).
+        math::vec3 opacity_; ///< The opacity of this point.
+        int next_; ///< The index of the next farther point at the same sample or -1 for none.
+    };
+
+    int width_; ///< The number of samples across.
+    int height_; ///< The number of samples down.
+    int maximum_points_; ///< The maximum number of points kept for each sample.
+    float opacity_threshold_; ///< The accumulated opacity at which a sample is treated as opaque.
+    std::vector<int> firsts_; ///< The index of the nearest point at each sample or -1 for none.
+    std::vector<VisiblePoint> points_; ///< The pool that points are allocated from.
+    int free_; ///< The index of the first free point in the pool or -1 for none.
+
+public:
+    VisiblePoints( int maximum_points, float opacity_threshold );
+    int width() const;
+    int height() const;
+    int maximum_points() const;
+    float opacity_threshold() const;
+    bool empty() const;
+    int pool_size() const;
+    void reset( int width, int height );
+    float insert( int x, int y, float depth, const math::vec3& color, const math::vec3& opacity, float opaque_depth );
+    math::vec4 composite( int x, int y, float opaque_depth, const math::vec4& opaque_color ) const;
+
+private:
+    int allocate();
+    void release( int index );
+};
+
+}
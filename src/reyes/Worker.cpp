@@ -0,0 +1,182 @@
+//
+// Worker.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Worker.hpp"
+#include "Renderer.hpp"
+#include "Options.hpp"
+#include "Attributes.hpp"
+#include "VirtualMachine.hpp"
+#include "Sampler.hpp"
+#include "SampleBuffer.hpp"
+#include "SplitStack.hpp"
+#include "assert.hpp"
+#include <math/vec4.ipp>
+
+using std::map;
+using std::shared_ptr;
+using namespace math;
+using namespace reyes;
+
+static const int ATTRIBUTES_RESERVE = 4;
+
+/**
+// Constructor.
+//
+// @param renderer
+//  The renderer to render buckets for.
+//
+// @param options
+//  The options for the frame being rendered.
+*/
+Worker::Worker( const Renderer& renderer, const Options& options )
+: renderer_( &renderer )
+, virtual_machine_( nullptr )
+, sampler_( nullptr )
+, sample_buffer_( nullptr )
+, split_stack_( nullptr )
+, copies_()
+, attributes_()
+{
+    virtual_machine_ = new VirtualMachine( renderer );
+    sample_buffer_ = new SampleBuffer( options.horizontal_resolution(), options.vertical_resolution(), options.horizontal_sampling_rate(), options.vertical_sampling_rate(), options.filter_width(), options.filter_height(), options.bucket_width(), options.bucket_height(), options.sample_pattern(), options.opacity_threshold(), options.maximum_visible_points(), options.output_elements() );
+    sample_buffer_->set_filter( options.filter_function(), options.separable_filter() );
+    sampler_ = new Sampler( float(sample_buffer_->width() - 1), float(sample_buffer_->height() - 1), options.crop_window(), options.maximum_vertices(), options.lens_radius(), options.focal_distance(), options.micropolygon_shape() );
+    for ( int i = 0; i < options.output_variables(); ++i )
+    {
+        sampler_->add_output( options.output_variable(i), options.output_variable_elements(i) );
+    }
+    split_stack_ = new SplitStack();
+    attributes_.reserve( ATTRIBUTES_RESERVE );
+}
+
+/**
+// Destructor.
+*/
+Worker::~Worker()
+{
+    clear();
+
+    delete split_stack_;
+    split_stack_ = nullptr;
+
+    delete sampler_;
+    sampler_ = nullptr;
+
+    delete sample_buffer_;
+    sample_buffer_ = nullptr;
+
+    delete virtual_machine_;
+    virtual_machine_ = nullptr;
+}
+
+/**
+// Get the renderer that this worker renders buckets for.
+//
+// @return
+//  The renderer.
+*/
+const Renderer* Worker::renderer() const
+{
+    return renderer_;
+}
+
+/**
+// Get the virtual machine used to execute shaders for this worker.
+//
+// @return
+//  The virtual machine.
+*/
+VirtualMachine* Worker::virtual_machine() const
+{
+    return virtual_machine_;
+}
+
+/**
+// Get the sampler that this worker samples grids with.
+//
+// @return
+//  The sampler.
+*/
+Sampler* Worker::sampler() const
+{
+    return sampler_;
+}
+
+/**
+// Get the sample buffer that this worker samples grids into.
+//
+// @return
+//  The sample buffer.
+*/
+SampleBuffer* Worker::sample_buffer() const
+{
+    return sample_buffer_;
+}
+
+/**
+// Get the split stack that this worker splits geometry on.
+//
+// @return
+//  The split stack.
+*/
+SplitStack* Worker::split_stack() const
+{
+    return split_stack_;
+}
+
+/**
+// Get the current attributes for this worker.
+//
+// @return
+//  The attributes at the top of this worker's attribute stack.
+*/
+Attributes& Worker::attributes() const
+{
+    REYES_ASSERT( !attributes_.empty() );
+    return *attributes_.back();
+}
+
+/**
+// Push this worker's copy of recorded attributes onto its attribute stack.
+//
+// The first time that attributes are pushed they're copied along with the
+// grids for their shaders and any light shaders.  The copy executes shaders
+// on this worker's virtual machine.  Later pushes of the same attributes 
+// reuse the copy.
+//
+// @param attributes
+//  The attributes recorded with a primitive (assumed not null and not
+//  changed while buckets are being rendered).
+*/
+void Worker::push_attributes( const std::shared_ptr<Attributes>& attributes )
+{
+    REYES_ASSERT( attributes );
+    shared_ptr<Attributes>& copy = copies_[attributes.get()];
+    if ( !copy )
+    {
+        copy.reset( new Attributes(*attributes) );
+        copy->set_virtual_machine( virtual_machine_ );
+        copy->detach_light_shaders();
+    }
+    attributes_.push_back( copy );
+}
+
+/**
+// Pop the current attributes from this worker's attribute stack.
+*/
+void Worker::pop_attributes()
+{
+    REYES_ASSERT( !attributes_.empty() );
+    attributes_.pop_back();
+}
+
+/**
+// Release this worker's copies of recorded attributes.
+*/
+void Worker::clear()
+{
+    attributes_.clear();
+    copies_.clear();
+}
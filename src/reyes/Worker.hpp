@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace reyes
+{
+
+class Renderer;
+class Options;
+class Attributes;
+class VirtualMachine;
+class Sampler;
+class SampleBuffer;
+class SplitStack;
+
+/**
+// The state used by one thread to render buckets concurrently with other
+// threads.
+//
+// Each worker has its own virtual machine, sampler, sample buffer, and split
+// stack and makes its own copy of the attributes recorded with primitives so
+// that the geometry split and the grids diced into, shaded, and sampled by 
+// one worker aren't touched by any other worker.
+*/
+class Worker
+{
+    const Renderer* renderer_; ///< The renderer that this worker renders buckets for.
+    VirtualMachine* virtual_machine_; ///< The virtual machine used to execute shaders.
+    Sampler* sampler_; ///< The sampler that samples grids into the sample buffer.
+    SampleBuffer* sample_buffer_; ///< The sample buffer for the bucket being rendered.
+    SplitStack* split_stack_; ///< The geometry waiting to be split or diced.
+    std::map<const Attributes*, std::shared_ptr<Attributes>> copies_; ///< The copies of recorded attributes made by this worker.
+    std::vector<std::shared_ptr<Attributes>> attributes_; ///< The attributes stack.
+
+public:
+    Worker( const Renderer& renderer, const Options& options );
+    ~Worker();
+    const Renderer* renderer() const;
+    VirtualMachine* virtual_machine() const;
+    Sampler* sampler() const;
+    SampleBuffer* sample_buffer() const;
+    SplitStack* split_stack() const;
+    Attributes& attributes() const;
+    void push_attributes( const std::shared_ptr<Attributes>& attributes );
+    void pop_attributes();
+    void clear();
+
+private:
+    Worker( const Worker& ) = delete;
+    Worker& operator=( const Worker& ) = delete;
+};
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+namespace reyes
+{
+
+/**
+// Hash an integer so that nearby values give unrelated results.
+//
+// Used to seed and scramble the sample patterns and to place the initial
+// points of the blue noise pattern reproducibly on every platform.
+//
+// @param value
+//  The value to hash.
+//
+// @return
+//  The hashed value.
+*/
+inline unsigned int hash( unsigned int value )
+{
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+}
+
+}
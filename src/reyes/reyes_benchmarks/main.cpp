@@ -0,0 +1,14 @@
+
+int main()
+{   
+    extern void run_threads_benchmark();
+    run_threads_benchmark();
+
+    extern void run_bounds_benchmark();
+    run_bounds_benchmark();
+
+    extern void run_grid_size_benchmark();
+    run_grid_size_benchmark();
+
+    return 0;
+}
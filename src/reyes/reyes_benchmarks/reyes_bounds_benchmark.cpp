@@ -0,0 +1,159 @@
+
+#include <reyes/Grid.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/Attributes.hpp>
+#include <reyes/Geometry.hpp>
+#include <reyes/Sphere.hpp>
+#include <reyes/Cone.hpp>
+#include <reyes/Cylinder.hpp>
+#include <reyes/Disk.hpp>
+#include <reyes/Hyperboloid.hpp>
+#include <reyes/Paraboloid.hpp>
+#include <reyes/Torus.hpp>
+#include <reyes/CubicPatch.hpp>
+#include <reyes/LinearPatch.hpp>
+#include <reyes/SplitStack.hpp>
+#include <math/vec2.ipp>
+#include <math/vec3.ipp>
+#include <math/vec4.ipp>
+#include <math/mat4x4.ipp>
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <stdio.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using std::min;
+using std::max;
+using namespace math;
+using namespace reyes;
+
+static const int SPLITS = 5;
+static const int REPEATS = 20;
+
+static void bound_by_dicing( const Geometry& geometry, const mat4x4& transform, Grid* grid, vec3* minimum, vec3* maximum )
+{
+    *minimum = vec3( FLT_MAX, FLT_MAX, FLT_MAX );
+    *maximum = vec3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    geometry.dice( transform, 8, 8, grid );
+    const vec3* positions = grid->vec3_value( "P" );
+    const vec3* positions_end = positions + grid->size();
+    for ( const vec3* i = positions; i != positions_end; ++i )
+    {
+        minimum->x = min( minimum->x, i->x );
+        minimum->y = min( minimum->y, i->y );
+        minimum->z = min( minimum->z, i->z );
+        maximum->x = max( maximum->x, i->x );
+        maximum->y = max( maximum->y, i->y );
+        maximum->z = max( maximum->z, i->z );
+    }
+}
+
+static double split_loop( const Geometry& geometry, const mat4x4& transform, Grid* grid, bool dicing, float* volume )
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    *volume = 0.0f;
+    SplitStack stacks [2];
+    for ( int repeat = 0; repeat < REPEATS; ++repeat )
+    {
+        int current = 0;
+        stacks[current].push( &geometry );
+        for ( int level = 0; level <= SPLITS; ++level )
+        {
+            SplitStack& pieces = stacks[current];
+            SplitStack& splits = stacks[1 - current];
+            while ( !pieces.empty() )
+            {
+                const Geometry* piece = pieces.top();
+                pieces.pop();
+                vec3 minimum;
+                vec3 maximum;
+                if ( dicing )
+                {
+                    bound_by_dicing( *piece, transform, grid, &minimum, &maximum );
+                }
+                else
+                {
+                    piece->bound( transform, &minimum, &maximum, grid );
+                }
+                if ( level == SPLITS && repeat == 0 )
+                {
+                    vec3 extent = maximum - minimum;
+                    *volume += extent.x * extent.y * extent.z;
+                }
+                if ( level < SPLITS )
+                {
+                    piece->split( &splits );
+                }
+            }
+            pieces.clear();
+            current = 1 - current;
+        }
+        stacks[current].clear();
+    }
+    std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>( finish - start ).count();
+}
+
+static void benchmark( const char* name, const Geometry& geometry, const mat4x4& transform, Grid* grid )
+{
+    float diced_volume = 0.0f;
+    float analytic_volume = 0.0f;
+    double diced_seconds = split_loop( geometry, transform, grid, true, &diced_volume );
+    double analytic_seconds = split_loop( geometry, transform, grid, false, &analytic_volume );
+    printf( "%-12s %10.3f %10.3f %10.2f %10.2f\n", name, diced_seconds * 1000.0, analytic_seconds * 1000.0, diced_seconds / analytic_seconds, analytic_volume / diced_volume );
+}
+
+void run_bounds_benchmark()
+{
+    static const vec4 BEZIER_BASIS [4] =
+    {
+        vec4( -1.0f, 3.0f, -3.0f, 1.0f ),
+        vec4( 3.0f, -6.0f, 3.0f, 0.0f ),
+        vec4( -3.0f, 3.0f, 0.0f, 0.0f ),
+        vec4( 1.0f, 0.0f, 0.0f, 0.0f )
+    };
+
+    vec3 control_points [16];
+    for ( int i = 0; i < 16; ++i )
+    {
+        float x = float(i % 4);
+        float y = float(i / 4);
+        control_points[i] = vec3( x, y, sinf(x) * cosf(y) );
+    }
+
+    const vec3 positions [4] = { vec3(-1.0f, -1.0f, 0.0f), vec3(1.0f, -1.0f, 0.5f), vec3(-1.0f, 1.0f, 0.5f), vec3(1.0f, 1.0f, 0.0f) };
+    const vec3 normals [4] = { vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f) };
+    const vec2 texture_coordinates [4] = { vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(0.0f, 1.0f), vec2(1.0f, 1.0f) };
+
+    Options options;
+    options.set_resolution( 640, 480, 1.0f );
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.25f * float(M_PI) );
+    renderer.projection();
+    renderer.begin_world();
+    renderer.surface_shader( SHADERS_PATH "plastic.sl" );
+    renderer.translate( 0.0f, 0.0f, 8.0f );
+    renderer.rotate( 0.3f, 1.0f, 1.0f, 0.0f );
+    const mat4x4 transform = renderer.current_transform();
+    Grid& grid = renderer.attributes().surface_parameters();
+
+    printf( "bounds       diced (ms) analytic (ms) speedup  volume\n" );
+    benchmark( "sphere", Sphere(2.0f), transform, &grid );
+    benchmark( "cone", Cone(2.0f, 1.0f, 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "cylinder", Cylinder(1.0f, -1.0f, 1.0f, 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "disk", Disk(0.0f, 1.0f, 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "hyperboloid", Hyperboloid(vec3(1.0f, 0.5f, -1.0f), vec3(0.5f, 1.0f, 1.0f), 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "paraboloid", Paraboloid(1.0f, 0.0f, 2.0f, 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "torus", Torus(2.0f, 0.5f, 0.0f, 2.0f * float(M_PI), 2.0f * float(M_PI)), transform, &grid );
+    benchmark( "cubic patch", CubicPatch(control_points, BEZIER_BASIS, BEZIER_BASIS), transform, &grid );
+    benchmark( "linear patch", LinearPatch(positions, normals, texture_coordinates), transform, &grid );
+
+    renderer.end_world();
+    renderer.end();
+}
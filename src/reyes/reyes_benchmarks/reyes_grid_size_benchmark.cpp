@@ -0,0 +1,92 @@
+
+#include <reyes/Grid.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <math/vec3.ipp>
+#include <chrono>
+#include <stdio.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using namespace math;
+using namespace reyes;
+
+static double render_spheres( int maximum_vertices, int* splits, int* shaded_grids, long long* shaded_vertices )
+{
+    Options options;
+    options.set_gamma( 1.0f / 2.2f );
+    options.set_resolution( 640, 480, 1.0f );
+    options.set_dither( 0.0f );
+    options.set_filter( &Options::gaussian_filter, 2.0f, 2.0f );
+    options.set_maximum_vertices( maximum_vertices );
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.25f * float(M_PI) );
+    renderer.projection();
+    renderer.translate( 0.0f, 0.0f, 24.0f );
+    renderer.begin_world();
+
+    Grid& ambientlight = renderer.light_shader( SHADERS_PATH "ambientlight.sl" );
+    ambientlight["intensity"] = 0.2f;
+    ambientlight["lightcolor"] = vec3( 1.0f, 1.0f, 1.0f );
+
+    Grid& pointlight = renderer.light_shader( SHADERS_PATH "pointlight.sl" );
+    pointlight["intensity"] = 4096.0f;
+    pointlight["lightcolor"] = vec3( 1.0f, 1.0f, 1.0f );
+    pointlight["from"] = vec3( 25.0f, 25.0f, -50.0f );
+
+    Grid& wavy = renderer.displacement_shader( SHADERS_PATH "wavy.sl" );
+    wavy["Km"] = 0.2f;
+    wavy["sfreq"] = 24.0f;
+    wavy["tfreq"] = 32.0f;
+
+    Grid& plastic = renderer.surface_shader( SHADERS_PATH "plastic.sl" );
+    plastic["Ka"] = 0.2f;
+    plastic["Kd"] = 0.4f;
+    plastic["Ks"] = 0.4f;
+    plastic["roughness"] = 0.05f;
+
+    const int ACROSS = 6;
+    const int DOWN = 4;
+    for ( int y = 0; y < DOWN; ++y )
+    {
+        for ( int x = 0; x < ACROSS; ++x )
+        {
+            renderer.identity();
+            renderer.translate( vec3(-12.5f + 5.0f * float(x), -7.5f + 5.0f * float(y), 0.0f) );
+            renderer.rotate( 0.5f * float(M_PI), 1.0f, 0.0f, 0.0f );
+            renderer.two_sided( true );
+            renderer.color( vec3(0.3f, 0.55f, 0.75f) );
+            renderer.sphere( 2.25f );
+        }
+    }
+
+    renderer.end_world();
+    renderer.end();
+
+    std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+    *splits = renderer.splits();
+    *shaded_grids = renderer.shaded_grids();
+    *shaded_vertices = renderer.shaded_vertices();
+    return std::chrono::duration<double>( finish - start ).count();
+}
+
+void run_grid_size_benchmark()
+{
+    const int SIZES [] = { 8, 16, 24, 32, 48, 64, 96, 128 };
+
+    printf( "grid size    seconds     splits      grids     vertices\n" );
+    for ( int size : SIZES )
+    {
+        int splits = 0;
+        int shaded_grids = 0;
+        long long shaded_vertices = 0;
+        double seconds = render_spheres( size * size, &splits, &shaded_grids, &shaded_vertices );
+        printf( "%4dx%-4d %10.3f %10d %10d %12lld\n", size, size, seconds, splits, shaded_grids, shaded_vertices );
+    }
+}
@@ -0,0 +1,112 @@
+
+#include <reyes/Grid.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/ImageBuffer.hpp>
+#include <math/vec3.ipp>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using namespace math;
+using namespace reyes;
+
+// The number of vertices shaded rendering this scene on one thread when 
+// Renderer::split() diced every piece into a square, power-of-two grid 
+// sized from the area of its raster bound, recorded so that the reduction
+// from dicing along u and v independently stays visible.
+static const long long SQUARE_DICING_SHADED_VERTICES = 7512064;
+
+static double render_spheres( int threads, ImageBuffer* image_buffer, long long* shaded_vertices )
+{
+    Options options;
+    options.set_gamma( 1.0f / 2.2f );
+    options.set_resolution( 640, 480, 1.0f );
+    options.set_dither( 0.0f );
+    options.set_filter( &Options::gaussian_filter, 2.0f, 2.0f );
+    options.set_bucket_size( 32, 32 );
+    options.set_threads( threads );
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.25f * float(M_PI) );
+    renderer.projection();
+    renderer.translate( 0.0f, 0.0f, 24.0f );
+    renderer.begin_world();
+
+    Grid& ambientlight = renderer.light_shader( SHADERS_PATH "ambientlight.sl" );
+    ambientlight["intensity"] = 0.2f;
+    ambientlight["lightcolor"] = vec3( 1.0f, 1.0f, 1.0f );
+
+    Grid& pointlight = renderer.light_shader( SHADERS_PATH "pointlight.sl" );
+    pointlight["intensity"] = 4096.0f;
+    pointlight["lightcolor"] = vec3( 1.0f, 1.0f, 1.0f );
+    pointlight["from"] = vec3( 25.0f, 25.0f, -50.0f );
+
+    Grid& wavy = renderer.displacement_shader( SHADERS_PATH "wavy.sl" );
+    wavy["Km"] = 0.2f;
+    wavy["sfreq"] = 24.0f;
+    wavy["tfreq"] = 32.0f;
+    
+    Grid& plastic = renderer.surface_shader( SHADERS_PATH "plastic.sl" );
+    plastic["Ka"] = 0.2f;
+    plastic["Kd"] = 0.4f;
+    plastic["Ks"] = 0.4f;
+    plastic["roughness"] = 0.05f;
+
+    const int ACROSS = 6;
+    const int DOWN = 4;
+    for ( int y = 0; y < DOWN; ++y )
+    {
+        for ( int x = 0; x < ACROSS; ++x )
+        {
+            renderer.identity();
+            renderer.translate( vec3(-12.5f + 5.0f * float(x), -7.5f + 5.0f * float(y), 0.0f) );
+            renderer.rotate( 0.5f * float(M_PI), 1.0f, 0.0f, 0.0f );
+            renderer.two_sided( true );
+            renderer.color( vec3(0.3f, 0.55f, 0.75f) );
+            renderer.sphere( 2.25f );
+        }
+    }
+
+    renderer.end_world();
+    renderer.end();
+
+    std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+    *shaded_vertices = renderer.shaded_vertices();
+    const ImageBuffer& image = renderer.image_buffer();
+    image_buffer->reset( image.width(), image.height(), image.elements(), image.format(), image.u8_data() );
+    return std::chrono::duration<double>( finish - start ).count();
+}
+
+void run_threads_benchmark()
+{
+    const int hardware_threads = std::max( 1, int(std::thread::hardware_concurrency()) );
+
+    ImageBuffer reference;
+    long long shaded_vertices = 0;
+    double reference_seconds = render_spheres( 1, &reference, &shaded_vertices );
+    printf( "shaded vertices %lld (%lld with square power-of-two dicing, %.2fx fewer)\n", shaded_vertices, SQUARE_DICING_SHADED_VERTICES, double(SQUARE_DICING_SHADED_VERTICES) / double(std::max(shaded_vertices, 1LL)) );
+    printf( "threads    seconds    speedup    identical\n" );
+    printf( "%7d %10.3f %10.2f %12s\n", 1, reference_seconds, 1.0, "yes" );
+
+    for ( int threads = 2; threads <= hardware_threads; threads *= 2 )
+    {
+        ImageBuffer image;
+        double seconds = render_spheres( threads, &image, &shaded_vertices );
+        bool identical = 
+            image.width() == reference.width() && 
+            image.height() == reference.height() && 
+            memcmp( image.u8_data(), reference.u8_data(), image.width() * image.height() * image.pixel_size() ) == 0
+        ;
+        printf( "%7d %10.3f %10.2f %12s\n", threads, seconds, reference_seconds / seconds, identical ? "yes" : "no" );
+    }
+}
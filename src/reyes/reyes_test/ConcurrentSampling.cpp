@@ -0,0 +1,64 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/Options.hpp>
+#include "SphereScene.hpp"
+#include <vector>
+
+using std::vector;
+using namespace reyes;
+
+static void render_spheres_in_parallel( int threads, int bucket_size, float dither, vector<unsigned char>* pixels )
+{
+    Options options;
+    options.set_resolution( 160, 120, 1.0f );
+    options.set_horizontal_sampling_rate( 4.0f );
+    options.set_vertical_sampling_rate( 4.0f );
+    options.set_dither( dither );
+    options.set_bucket_size( bucket_size, bucket_size );
+    options.set_threads( threads );
+    render_spheres( options, pixels );
+}
+
+SUITE( ConcurrentSampling )
+{
+    TEST( sampling_in_bands_on_many_threads_matches_one_thread )
+    {
+        vector<unsigned char> expected;
+        render_spheres_in_parallel( 1, 0, 0.0f, &expected );
+
+        const int REPEATS = 8;
+        for ( int i = 0; i < REPEATS; ++i )
+        {
+            vector<unsigned char> pixels;
+            render_spheres_in_parallel( 4, 0, 0.0f, &pixels );
+            CHECK( pixels == expected );
+        }
+    }
+
+    TEST( sampling_in_buckets_on_many_threads_matches_one_thread )
+    {
+        vector<unsigned char> expected;
+        render_spheres_in_parallel( 1, 16, 0.0f, &expected );
+
+        const int REPEATS = 8;
+        for ( int i = 0; i < REPEATS; ++i )
+        {
+            vector<unsigned char> pixels;
+            render_spheres_in_parallel( 4, 16, 0.0f, &pixels );
+            CHECK( pixels == expected );
+        }
+    }
+
+    TEST( dithering_on_many_threads_matches_one_thread )
+    {
+        vector<unsigned char> expected;
+        render_spheres_in_parallel( 1, 0, 0.5f, &expected );
+
+        const int REPEATS = 8;
+        for ( int i = 0; i < REPEATS; ++i )
+        {
+            vector<unsigned char> pixels;
+            render_spheres_in_parallel( 4, 0, 0.5f, &pixels );
+            CHECK( pixels == expected );
+        }
+    }
+}
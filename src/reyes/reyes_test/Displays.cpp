@@ -0,0 +1,111 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/PngDisplay.hpp>
+#include <reyes/RawDisplay.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/ErrorPolicy.hpp>
+#include <math/vec3.ipp>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using math::vec3;
+using std::vector;
+using namespace reyes;
+
+static const char* STREAMED_PNG = "reyes_test_streamed.png";
+static const char* SAVED_PNG = "reyes_test_saved.png";
+static const char* STREAMED_RAW = "reyes_test_streamed.raw";
+static const char* SAVED_RAW = "reyes_test_saved.raw";
+
+static void read_file( const char* filename, vector<unsigned char>* data )
+{
+    data->clear();
+    FILE* file = fopen( filename, "rb" );
+    if ( file )
+    {
+        unsigned char buffer [4096];
+        size_t read = 0;
+        while ( (read = fread(buffer, 1, sizeof(buffer), file)) > 0 )
+        {
+            data->insert( data->end(), buffer, buffer + read );
+        }
+        fclose( file );
+    }
+}
+
+// Render spheres in small buckets across several threads so that rows are
+// completed out of order while they are streamed to a PNG and a raw 
+// display then check that the streamed files hold the same pixels as the
+// image buffer saved once the frame has finished.
+SUITE( Displays )
+{
+    TEST( streamed_rows_match_saved_image )
+    {
+        Options options;
+        options.set_resolution( 160, 120, 1.0f );
+        options.set_bucket_size( 16, 16 );
+        options.set_threads( 4 );
+
+        PngDisplay png_display( STREAMED_PNG );
+        RawDisplay raw_display( STREAMED_RAW );
+        Renderer renderer;
+        renderer.set_options( options );
+        renderer.add_display( &png_display );
+        renderer.add_display( &raw_display );
+        renderer.begin();
+        renderer.perspective( 0.25f * float(M_PI) );
+        renderer.projection();
+        renderer.translate( 0.0f, 0.0f, 24.0f );
+        renderer.begin_world();
+        renderer.surface_shader( SHADERS_PATH "constant.sl" );
+
+        const int SPHERES = 8;
+        for ( int i = 0; i < SPHERES; ++i )
+        {
+            const float angle = 2.0f * float(M_PI) * float(i) / float(SPHERES);
+            renderer.identity();
+            renderer.translate( 5.0f * cosf(angle), 5.0f * sinf(angle), float(i % 3) * 4.0f - 6.0f );
+            renderer.color( vec3(float(i % 2), float(i % 3) / 2.0f, float(i % 4) / 3.0f) );
+            renderer.sphere( 2.0f + float(i % 3) );
+        }
+
+        renderer.end_world();
+        renderer.end();
+        renderer.clear_displays();
+        CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+
+        const ImageBuffer& image_buffer = renderer.image_buffer();
+        image_buffer.save_png( SAVED_PNG, &renderer.error_policy() );
+        image_buffer.save( SAVED_RAW, &renderer.error_policy() );
+
+        vector<unsigned char> streamed;
+        vector<unsigned char> saved;
+        read_file( STREAMED_RAW, &streamed );
+        read_file( SAVED_RAW, &saved );
+        CHECK( !saved.empty() );
+        CHECK( streamed == saved );
+
+        ImageBuffer streamed_png;
+        ImageBuffer saved_png;
+        streamed_png.load_png( STREAMED_PNG, &renderer.error_policy() );
+        saved_png.load_png( SAVED_PNG, &renderer.error_policy() );
+        CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+        CHECK_EQUAL( image_buffer.width(), streamed_png.width() );
+        CHECK_EQUAL( image_buffer.height(), streamed_png.height() );
+        CHECK_EQUAL( saved_png.pixel_size(), streamed_png.pixel_size() );
+        if ( streamed_png.width() == saved_png.width() && streamed_png.height() == saved_png.height() && streamed_png.pixel_size() == saved_png.pixel_size() )
+        {
+            const size_t size = streamed_png.width() * streamed_png.height() * streamed_png.pixel_size();
+            CHECK( memcmp(streamed_png.u8_data(), saved_png.u8_data(), size) == 0 );
+        }
+
+        remove( STREAMED_PNG );
+        remove( SAVED_PNG );
+        remove( STREAMED_RAW );
+        remove( SAVED_RAW );
+    }
+}
@@ -0,0 +1,55 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/Exposure.hpp>
+#include <math/vec4.ipp>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+using math::vec4;
+using std::vector;
+using namespace reyes;
+
+// Quantize values spread from below zero to past one, including values 
+// below and above the range covered by the gamma table, and check that 
+// each matches rounding the exposed value given by powf() directly.  The
+// count of pixels isn't a multiple of four so that both the vectorized 
+// and the scalar paths are checked.  The table only differs from powf() 
+// in its last few bits so quantized values may only differ where powf() 
+// lands within a hair of halfway between two values.
+static void check_gamma_matches_powf( float gain, float gamma )
+{
+    const int PIXELS = 1001;
+    vector<vec4> pixels( PIXELS );
+    float* elements = &pixels[0].x;
+    for ( int i = 0; i < PIXELS * 4; ++i )
+    {
+        const float t = float(i) / float(PIXELS * 4 - 1);
+        elements[i] = i % 7 == 0 ? powf( 2.0f, -24.0f * t ) : 1.2f * t - 0.1f;
+    }
+
+    const Exposure exposure( gain, gamma, 255.0f, 0, 255, 0.0f );
+    vector<unsigned char> quantized( PIXELS * 4 );
+    exposure.quantize( &pixels[0], 0, 0, PIXELS, &quantized[0] );
+
+    int differences = 0;
+    for ( int i = 0; i < PIXELS * 4; ++i )
+    {
+        const float exposed = powf( std::max(elements[i] * gain, 0.0f), gamma );
+        const int expected = std::min( std::max(int(floorf(255.0f * exposed + 0.5f)), 0), 255 );
+        CHECK( abs(expected - int(quantized[i])) <= 1 );
+        differences += expected != int(quantized[i]) ? 1 : 0;
+    }
+    CHECK( differences <= 4 );
+}
+
+SUITE( Exposure )
+{
+    TEST( gamma_table_matches_powf )
+    {
+        check_gamma_matches_powf( 1.0f, 1.0f / 2.2f );
+        check_gamma_matches_powf( 1.0f, 2.2f );
+        check_gamma_matches_powf( 4.0f, 0.5f );
+        check_gamma_matches_powf( 0.25f, 1.0f );
+    }
+}
@@ -0,0 +1,75 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/GridCache.hpp>
+#include <reyes/Grid.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Shader.hpp>
+#include <reyes/SymbolTable.hpp>
+#include <reyes/ErrorPolicy.hpp>
+#include "SphereScene.hpp"
+#include <math/vec2.ipp>
+#include <vector>
+#include <string.h>
+
+using math::vec2;
+using std::vector;
+using std::shared_ptr;
+using namespace reyes;
+
+static void render_spheres_across_buckets( int threads, bool grid_cache, vector<unsigned char>* pixels )
+{
+    Options options;
+    options.set_resolution( 160, 120, 1.0f );
+    options.set_horizontal_sampling_rate( 2.0f );
+    options.set_vertical_sampling_rate( 2.0f );
+    options.set_bucket_size( 16, 16 );
+    options.set_threads( threads );
+    options.set_occlusion_culling( true );
+    options.set_grid_cache( grid_cache );
+    render_spheres( options, pixels );
+}
+
+SUITE( GridCache )
+{
+    TEST( rendering_buckets_with_grid_cache_matches_without )
+    {
+        vector<unsigned char> expected;
+        render_spheres_across_buckets( 1, false, &expected );
+
+        vector<unsigned char> pixels;
+        render_spheres_across_buckets( 1, true, &pixels );
+        CHECK( pixels == expected );
+
+        render_spheres_across_buckets( 4, true, &pixels );
+        CHECK( pixels == expected );
+    }
+
+    TEST( grids_are_released_once_their_last_bucket_finishes )
+    {
+        SymbolTable symbol_table;
+        symbol_table.add_symbols()
+            ( "P", TYPE_POINT )
+            ( "Ci", TYPE_COLOR )
+            ( "Oi", TYPE_COLOR )
+        ;
+        const char* source = "surface test() { Ci = color(1.0, 0.0, 0.0); Oi = color(1.0, 1.0, 1.0); }";
+        ErrorPolicy error_policy;
+        Shader shader( source, source + strlen(source), symbol_table, error_policy );
+
+        Grid grid;
+        grid.set_shader( &shader );
+        grid.resize( 2, 2 );
+        grid.zero();
+
+        const vec2 u_range( 0.0f, 1.0f );
+        const vec2 v_range( 0.0f, 1.0f );
+        GridCache grid_cache;
+        grid_cache.insert( 0, u_range, v_range, grid, vector<float>(), 3, 2 );
+
+        grid_cache.finish_bucket( 0 );
+        grid_cache.finish_bucket( 2 );
+        CHECK( grid_cache.acquire(0, u_range, v_range) != nullptr );
+
+        grid_cache.finish_bucket( 1 );
+        CHECK( grid_cache.acquire(0, u_range, v_range) == nullptr );
+    }
+}
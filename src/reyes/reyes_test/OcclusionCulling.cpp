@@ -0,0 +1,138 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <math/vec2.ipp>
+#include <math/vec3.ipp>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using math::vec2;
+using math::vec3;
+using std::vector;
+using namespace reyes;
+
+// Translate to _position_ or, when _moving_ is true, move from one unit 
+// left of _position_ at shutter open to one unit right of it at shutter
+// close.
+static void translate( Renderer* renderer, const vec3& position, bool moving )
+{
+    if ( moving )
+    {
+        renderer->motion_begin();
+        renderer->translate( position + vec3(-1.0f, 0.0f, 0.0f) );
+        renderer->translate( position + vec3(1.0f, 0.0f, 0.0f) );
+        renderer->motion_end();
+    }
+    else
+    {
+        renderer->translate( position );
+    }
+}
+
+// Render an opaque square wall, a transparent sphere in front of it, and 
+// then a ring of spheres behind it with the given opacity.  The inner 
+// spheres of the ring are hidden by the wall and the outer spheres are 
+// partly hidden.
+// Every sphere moves across the frame while the shutter is open when 
+// _moving_ is true.
+static void render_behind_wall( bool occlusion_culling, int bucket_size, const vec3& opacity, bool moving, vector<unsigned char>* pixels, long long* shaded_vertices )
+{
+    Options options;
+    options.set_resolution( 160, 120, 1.0f );
+    options.set_horizontal_sampling_rate( 2.0f );
+    options.set_vertical_sampling_rate( 2.0f );
+    options.set_bucket_size( bucket_size, bucket_size );
+    options.set_threads( bucket_size > 0 ? 4 : 1 );
+    options.set_occlusion_culling( occlusion_culling );
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.25f * float(M_PI) );
+    renderer.projection();
+    renderer.translate( 0.0f, 0.0f, 24.0f );
+    renderer.begin_world();
+    renderer.surface_shader( SHADERS_PATH "constant.sl" );
+
+    // The wall is flat so that none of it is hidden by itself and any 
+    // reduction in shading comes from culling the geometry behind it.
+    renderer.push_attributes();
+    renderer.translate( 0.0f, 0.0f, -8.0f );
+    renderer.color( vec3(0.2f, 0.4f, 0.8f) );
+    renderer.two_sided( true );
+    const vec3 positions [] = { vec3(-5.0f, -5.0f, 0.0f), vec3(5.0f, -5.0f, 0.0f), vec3(5.0f, 5.0f, 0.0f), vec3(-5.0f, 5.0f, 0.0f) };
+    const vec3 normals [] = { vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f) };
+    const vec2 texture_coordinates [] = { vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f) };
+    renderer.linear_patch( positions, normals, texture_coordinates );
+    renderer.pop_attributes();
+
+    renderer.push_attributes();
+    translate( &renderer, vec3(-2.0f, 1.0f, -14.0f), moving );
+    renderer.color( vec3(1.0f, 1.0f, 0.0f) );
+    renderer.opacity( vec3(0.5f, 0.5f, 0.5f) );
+    renderer.sphere( 1.5f );
+    renderer.pop_attributes();
+
+    const int SPHERES = 12;
+    for ( int i = 0; i < SPHERES; ++i )
+    {
+        const float angle = 2.0f * float(M_PI) * float(i) / float(SPHERES);
+        const float radius = i % 2 == 0 ? 3.0f : 9.0f;
+        renderer.push_attributes();
+        translate( &renderer, vec3(radius * cosf(angle), radius * sinf(angle), 6.0f), moving );
+        renderer.color( vec3(float(i % 3) / 2.0f, float(i % 4) / 3.0f, 1.0f) );
+        renderer.opacity( opacity );
+        renderer.sphere( 1.5f );
+        renderer.pop_attributes();
+    }
+
+    renderer.end_world();
+    renderer.end();
+
+    const ImageBuffer& image_buffer = renderer.image_buffer();
+    const unsigned char* data = image_buffer.u8_data();
+    pixels->assign( data, data + image_buffer.width() * image_buffer.height() * image_buffer.pixel_size() );
+    *shaded_vertices = renderer.shaded_vertices();
+}
+
+// Check that culling hidden geometry leaves the image unchanged and shades
+// fewer vertices when rendering the whole frame at once and in buckets.
+static void check_occlusion_culling( const vec3& opacity, bool moving )
+{
+    const int bucket_sizes [] = { 0, 16 };
+    for ( int bucket_size : bucket_sizes )
+    {
+        vector<unsigned char> expected;
+        long long expected_shaded_vertices = 0;
+        render_behind_wall( false, bucket_size, opacity, moving, &expected, &expected_shaded_vertices );
+
+        vector<unsigned char> pixels;
+        long long shaded_vertices = 0;
+        render_behind_wall( true, bucket_size, opacity, moving, &pixels, &shaded_vertices );
+        CHECK( pixels == expected );
+        CHECK( shaded_vertices < expected_shaded_vertices );
+    }
+}
+
+SUITE( OcclusionCulling )
+{
+    TEST( culling_opaque_geometry_leaves_image_unchanged )
+    {
+        check_occlusion_culling( vec3(1.0f, 1.0f, 1.0f), false );
+    }
+
+    TEST( culling_transparent_geometry_leaves_image_unchanged )
+    {
+        check_occlusion_culling( vec3(0.5f, 0.5f, 0.5f), false );
+    }
+
+    TEST( culling_moving_geometry_leaves_image_unchanged )
+    {
+        // Moving grids are always shaded so only culling their bounds against
+        // the depth pyramid before dicing reduces the vertices shaded.
+        check_occlusion_culling( vec3(1.0f, 1.0f, 1.0f), true );
+        check_occlusion_culling( vec3(0.5f, 0.5f, 0.5f), true );
+    }
+}
@@ -0,0 +1,70 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/ValueType.hpp>
+#include "SphereScene.hpp"
+#include <string.h>
+
+using namespace reyes;
+
+static void render_spheres_with_outputs( int threads, int bucket_size, bool grid_cache, Renderer* renderer )
+{
+    Options options;
+    options.set_resolution( 80, 60, 1.0f );
+    options.set_horizontal_sampling_rate( 2.0f );
+    options.set_vertical_sampling_rate( 2.0f );
+    options.set_bucket_size( bucket_size, bucket_size );
+    options.set_threads( threads );
+    options.set_grid_cache( grid_cache );
+    options.add_output_variable( "Ci", TYPE_COLOR );
+    options.add_output_variable( "undefined", TYPE_FLOAT );
+    render_spheres( options, renderer );
+}
+
+static void check_outputs_match_colors( const ImageBuffer& output_buffer )
+{
+    CHECK_EQUAL( 8, output_buffer.elements() );
+    for ( int y = 0; y < output_buffer.height(); ++y )
+    {
+        for ( int x = 0; x < output_buffer.width(); ++x )
+        {
+            const float* pixel = output_buffer.f32_data( x, y );
+            CHECK_CLOSE( pixel[0], pixel[4], 0.0001f );
+            CHECK_CLOSE( pixel[1], pixel[5], 0.0001f );
+            CHECK_CLOSE( pixel[2], pixel[6], 0.0001f );
+            CHECK_EQUAL( 0.0f, pixel[7] );
+        }
+    }
+}
+
+SUITE( OutputVariables )
+{
+    TEST( opaque_output_variables_filter_like_colors )
+    {
+        Renderer renderer;
+        render_spheres_with_outputs( 1, 0, true, &renderer );
+        check_outputs_match_colors( renderer.output_buffer() );
+    }
+
+    TEST( opaque_output_variables_filter_like_colors_in_buckets_on_many_threads )
+    {
+        Renderer renderer;
+        render_spheres_with_outputs( 4, 16, true, &renderer );
+        check_outputs_match_colors( renderer.output_buffer() );
+    }
+
+    TEST( output_variables_sampled_from_cached_grids_match_shaded_grids )
+    {
+        Renderer uncached_renderer;
+        render_spheres_with_outputs( 1, 16, false, &uncached_renderer );
+        Renderer renderer;
+        render_spheres_with_outputs( 1, 16, true, &renderer );
+
+        const ImageBuffer& expected = uncached_renderer.output_buffer();
+        const ImageBuffer& output_buffer = renderer.output_buffer();
+        const int size = output_buffer.width() * output_buffer.height() * output_buffer.elements();
+        CHECK_EQUAL( expected.width() * expected.height() * expected.elements(), size );
+        CHECK( memcmp(expected.f32_data(), output_buffer.f32_data(), sizeof(float) * size) == 0 );
+    }
+}
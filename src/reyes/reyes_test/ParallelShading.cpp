@@ -0,0 +1,115 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/Renderer.hpp>
+#include <reyes/ErrorPolicy.hpp>
+#include <reyes/SymbolTable.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Shader.hpp>
+#include <reyes/Grid.hpp>
+#include <math/vec3.ipp>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+
+using std::vector;
+using namespace math;
+using namespace reyes;
+
+// Surface shade a 64x64 grid of a rippled sheet with a renderer using 
+// _threads_ threads to render the whole frame at once, which shades grids 
+// this large in row bands on its thread pool when it has more than one 
+// thread, and copy out the shaded values.
+static void shade_large_grid( int threads, vector<vec3>* values )
+{
+    const int WIDTH = 64;
+    const int HEIGHT = 64;
+
+    Options options;
+    options.set_threads( threads );
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( float(M_PI) / 2.0f );
+    renderer.projection();
+    renderer.begin_world();
+
+    SymbolTable symbol_table;
+    symbol_table.add_symbols()
+        ( "a", TYPE_VECTOR )
+        ( "b", TYPE_VECTOR )
+        ( "n", TYPE_NORMAL )
+    ;
+
+    // Du, Dv, and calculatenormal read the rows above and below each vertex
+    // so bands must be padded with their neighbours' rows to match.
+    const char* source = 
+        "surface large_grid_test() { \n"
+        "    a = Du(P); \n"
+        "    b = Dv(P); \n"
+        "    n = calculatenormal(P); \n"
+        "    if ( xcomp(P) > 0.0 ) { \n"
+        "        n = normalize(n) + a; \n"
+        "    } \n"
+        "}"
+    ;
+    Shader shader;
+    shader.load_memory( source, source + strlen(source), symbol_table, renderer.error_policy() );
+
+    Grid& grid = renderer.surface_shader( &shader );
+    grid.resize( WIDTH, HEIGHT );
+    grid.set_du( 1.0f / float(WIDTH - 1) );
+    grid.set_dv( 1.0f / float(HEIGHT - 1) );
+
+    vec3* positions = grid.vec3_value( "P" );
+    CHECK( positions != nullptr );
+    if ( positions )
+    {
+        for ( int y = 0; y < HEIGHT; ++y )
+        {
+            for ( int x = 0; x < WIDTH; ++x )
+            {
+                const float u = float(x) / float(WIDTH - 1);
+                const float v = float(y) / float(HEIGHT - 1);
+                positions[y * WIDTH + x] = vec3( 2.0f * u - 1.0f, 2.0f * v - 1.0f, 4.0f + 0.5f * sinf(7.0f * u) * cosf(5.0f * v) );
+            }
+        }
+        renderer.surface_shade( grid );
+    }
+
+    values->clear();
+    const char* identifiers [] = { "a", "b", "n" };
+    for ( const char* identifier : identifiers )
+    {
+        const vec3* shaded_values = grid.vec3_value( identifier );
+        CHECK( shaded_values != nullptr );
+        if ( shaded_values )
+        {
+            values->insert( values->end(), shaded_values, shaded_values + grid.size() );
+        }
+    }
+    CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+}
+
+SUITE( ParallelShading )
+{
+    TEST( shading_large_grids_in_bands_matches_serial_shading )
+    {
+        vector<vec3> expected;
+        shade_large_grid( 1, &expected );
+
+        // The sheet is 2 units across in x and y so Du(P) and Dv(P) have 
+        // those components everywhere, edges included.
+        const int VERTICES = int(expected.size() / 3);
+        for ( int i = 0; i < VERTICES; ++i )
+        {
+            CHECK_CLOSE( 2.0f, expected[i].x, 0.001f );
+            CHECK_CLOSE( 2.0f, expected[VERTICES + i].y, 0.001f );
+        }
+
+        vector<vec3> values;
+        shade_large_grid( 4, &values );
+        CHECK( values.size() == expected.size() );
+        CHECK( !values.empty() && memcmp(&values[0], &expected[0], sizeof(vec3) * expected.size()) == 0 );
+    }
+}
@@ -0,0 +1,354 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/MicropolygonShape.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/SamplePattern.hpp>
+#include <reyes/Shader.hpp>
+#include <reyes/ErrorPolicy.hpp>
+#include "SphereScene.hpp"
+#include <math/vec2.ipp>
+#include <math/vec3.ipp>
+#include <vector>
+#include <algorithm>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+using math::vec2;
+using math::vec3;
+using std::vector;
+using namespace reyes;
+
+// Render a red square covering the middle half of a 32x32 image as a single 
+// micropolygon that covers many more samples than there are vertices in a 
+// grid and check that it covers every pixel inside the square and none 
+// outside of it.  Samples are jittered so that none lie exactly on the
+// diagonal shared by the square's two triangles.
+static void check_large_micropolygon_coverage( MicropolygonShape micropolygon_shape, bool moving )
+{
+    Options options;
+    options.set_resolution( 32, 32, 1.0f );
+    options.set_horizontal_sampling_rate( 4.0f );
+    options.set_vertical_sampling_rate( 4.0f );
+    options.set_sample_pattern( SAMPLE_PATTERN_MULTI_JITTERED );
+    options.set_filter( &Options::box_filter, 1.0f, 1.0f );
+    options.set_dither( 0.0f );
+    options.set_maximum_vertices( 16 );
+    options.set_micropolygon_shape( micropolygon_shape );
+
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.5f * float(M_PI) );
+    renderer.projection();
+    renderer.translate( 0.0f, 0.0f, 2.0f );
+    renderer.begin_world();
+    renderer.surface_shader( SHADERS_PATH "constant.sl" );
+    renderer.shading_rate( 1000000.0f );
+    renderer.two_sided( true );
+    renderer.color( vec3(1.0f, 0.0f, 0.0f) );
+    if ( moving )
+    {
+        renderer.motion_begin();
+        renderer.translate( -0.01f, 0.0f, 0.0f );
+        renderer.translate( 0.01f, 0.0f, 0.0f );
+        renderer.motion_end();
+    }
+
+    const vec3 positions [] = { vec3(-1.0f, -1.0f, 0.0f), vec3(1.0f, -1.0f, 0.0f), vec3(1.0f, 1.0f, 0.0f), vec3(-1.0f, 1.0f, 0.0f) };
+    const vec3 normals [] = { vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f) };
+    const vec2 texture_coordinates [] = { vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f) };
+    renderer.linear_patch( positions, normals, texture_coordinates );
+
+    renderer.end_world();
+    renderer.end();
+
+    const ImageBuffer& image_buffer = renderer.image_buffer();
+    for ( int y = 0; y < image_buffer.height(); ++y )
+    {
+        for ( int x = 0; x < image_buffer.width(); ++x )
+        {
+            const unsigned char* pixel = image_buffer.u8_data( x, y );
+            if ( x >= 10 && x < 22 && y >= 10 && y < 22 )
+            {
+                CHECK_EQUAL( 255, int(pixel[0]) );
+            }
+            else if ( x < 6 || x >= 26 || y < 6 || y >= 26 )
+            {
+                CHECK_EQUAL( 0, int(pixel[0]) );
+            }
+            CHECK_EQUAL( 0, int(pixel[1]) );
+            CHECK_EQUAL( 0, int(pixel[2]) );
+        }
+    }
+}
+
+// Render a red square of side \e size centred on \e open_position at 
+// shutter open and on \e close_position at shutter close in front of a 
+// camera with a 90 degree field of view two units from the origin and 
+// return the red channel of each pixel from 0 to 1.  At a depth of two a
+// unit in x or y covers eight pixels of a 32x32 image.
+static void render_square( const Options& options, float size, const vec3& open_position, const vec3& close_position, vector<float>* reds )
+{
+    Renderer renderer;
+    renderer.set_options( options );
+    renderer.begin();
+    renderer.perspective( 0.5f * float(M_PI) );
+    renderer.projection();
+    renderer.translate( 0.0f, 0.0f, 2.0f );
+    renderer.begin_world();
+    renderer.surface_shader( SHADERS_PATH "constant.sl" );
+    renderer.two_sided( true );
+    renderer.color( vec3(1.0f, 0.0f, 0.0f) );
+    renderer.motion_begin();
+    renderer.translate( open_position );
+    renderer.translate( close_position );
+    renderer.motion_end();
+
+    const float s = 0.5f * size;
+    const vec3 positions [] = { vec3(-s, -s, 0.0f), vec3(s, -s, 0.0f), vec3(s, s, 0.0f), vec3(-s, s, 0.0f) };
+    const vec3 normals [] = { vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f) };
+    const vec2 texture_coordinates [] = { vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f) };
+    renderer.linear_patch( positions, normals, texture_coordinates );
+
+    renderer.end_world();
+    renderer.end();
+
+    const ImageBuffer& image_buffer = renderer.image_buffer();
+    reds->resize( image_buffer.width() * image_buffer.height() );
+    for ( int y = 0; y < image_buffer.height(); ++y )
+    {
+        for ( int x = 0; x < image_buffer.width(); ++x )
+        {
+            (*reds)[y * image_buffer.width() + x] = float(image_buffer.u8_data(x, y)[0]) / 255.0f;
+        }
+    }
+}
+
+// Options for rendering a 32x32 image with 8x8 jittered samples per pixel,
+// a box filter, and no dithering so that coverage can be checked directly.
+static Options coverage_options()
+{
+    Options options;
+    options.set_resolution( 32, 32, 1.0f );
+    options.set_horizontal_sampling_rate( 8.0f );
+    options.set_vertical_sampling_rate( 8.0f );
+    options.set_sample_pattern( SAMPLE_PATTERN_MULTI_JITTERED );
+    options.set_filter( &Options::box_filter, 1.0f, 1.0f );
+    options.set_dither( 0.0f );
+    return options;
+}
+
+// Calculate the total coverage in \e reds and its second moment about 
+// its centroid; the mean squared distance of coverage from its centre.
+static float coverage_spread( const vector<float>& reds, float* total )
+{
+    float sum = 0.0f;
+    float sum_x = 0.0f;
+    float sum_y = 0.0f;
+    for ( int y = 0; y < 32; ++y )
+    {
+        for ( int x = 0; x < 32; ++x )
+        {
+            const float red = reds[y * 32 + x];
+            sum += red;
+            sum_x += red * float(x);
+            sum_y += red * float(y);
+        }
+    }
+
+    const float center_x = sum_x / sum;
+    const float center_y = sum_y / sum;
+    float spread = 0.0f;
+    for ( int y = 0; y < 32; ++y )
+    {
+        for ( int x = 0; x < 32; ++x )
+        {
+            const float dx = float(x) - center_x;
+            const float dy = float(y) - center_y;
+            spread += reds[y * 32 + x] * (dx * dx + dy * dy);
+        }
+    }
+    *total = sum;
+    return spread / sum;
+}
+
+SUITE( Sampling )
+{
+    TEST( triangles_covering_more_samples_than_grid_vertices )
+    {
+        check_large_micropolygon_coverage( MICROPOLYGON_SHAPE_TRIANGLES, false );
+    }
+
+    TEST( quads_covering_more_samples_than_grid_vertices )
+    {
+        check_large_micropolygon_coverage( MICROPOLYGON_SHAPE_QUADS, false );
+    }
+
+    TEST( moving_triangles_covering_more_samples_than_grid_vertices )
+    {
+        check_large_micropolygon_coverage( MICROPOLYGON_SHAPE_TRIANGLES, true );
+    }
+
+    TEST( quads_interpolate_color_bilinearly )
+    {
+        // Shading the square once at its corners with s in red, t in green,
+        // and s * t in blue leaves bilinear interpolation across the single
+        // micropolygon to fill in the pixels between.  Only bilinear 
+        // interpolation keeps blue the product of red and green everywhere;
+        // the two triangles of a quad disagree along their diagonal.
+        const char* source = 
+            "surface st() {"
+            "    Oi = Os;"
+            "    Ci = color(1.0, 0.0, 0.0) * color(s) + color(0.0, 1.0, 0.0) * color(t) + color(0.0, 0.0, 1.0) * color(s * t);"
+            "}"
+        ;
+
+        Options options = coverage_options();
+        options.set_micropolygon_shape( MICROPOLYGON_SHAPE_QUADS );
+
+        Renderer renderer;
+        renderer.set_options( options );
+        Shader shader( source, source + strlen(source), renderer.error_policy() );
+        renderer.begin();
+        renderer.perspective( 0.5f * float(M_PI) );
+        renderer.projection();
+        renderer.translate( 0.0f, 0.0f, 2.0f );
+        renderer.begin_world();
+        renderer.surface_shader( &shader );
+        renderer.shading_rate( 1000000.0f );
+        renderer.two_sided( true );
+
+        const vec3 positions [] = { vec3(-1.0f, -1.0f, 0.0f), vec3(1.0f, -1.0f, 0.0f), vec3(1.0f, 1.0f, 0.0f), vec3(-1.0f, 1.0f, 0.0f) };
+        const vec3 normals [] = { vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 0.0f, -1.0f) };
+        const vec2 texture_coordinates [] = { vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f) };
+        renderer.linear_patch( positions, normals, texture_coordinates );
+
+        renderer.end_world();
+        renderer.end();
+        CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+
+        const ImageBuffer& image_buffer = renderer.image_buffer();
+        for ( int y = 10; y < 22; ++y )
+        {
+            for ( int x = 10; x < 22; ++x )
+            {
+                const unsigned char* pixel = image_buffer.u8_data( x, y );
+                const float s = float(pixel[0]) / 255.0f;
+                const float t = float(pixel[1]) / 255.0f;
+                CHECK_CLOSE( s * t, float(pixel[2]) / 255.0f, 0.02f );
+            }
+        }
+        CHECK( image_buffer.u8_data(21, 16)[0] - image_buffer.u8_data(10, 16)[0] > 128 );
+        CHECK( abs(image_buffer.u8_data(16, 21)[1] - image_buffer.u8_data(16, 10)[1]) > 128 );
+    }
+
+    TEST( moving_square_is_blurred_across_its_path )
+    {
+        // A square eight pixels across moving eight pixels to the right
+        // covers each column in its path for the fraction of the shutter 
+        // that the column lies inside it; a triangle rising from zero at 
+        // column 8 to one at column 16 and falling back to zero at column 24.
+        // Blurring spreads the square's coverage without changing its total.
+        vector<float> reds;
+        render_square( coverage_options(), 1.0f, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f), &reds );
+        float still_total = 0.0f;
+        for ( float red : reds )
+        {
+            still_total += red;
+        }
+
+        render_square( coverage_options(), 1.0f, vec3(-0.5f, 0.0f, 0.0f), vec3(0.5f, 0.0f, 0.0f), &reds );
+        float total = 0.0f;
+        for ( int x = 0; x < 32; ++x )
+        {
+            float column = 0.0f;
+            for ( int y = 0; y < 32; ++y )
+            {
+                const float red = reds[y * 32 + x];
+                if ( y < 11 || y >= 22 )
+                {
+                    CHECK_EQUAL( 0.0f, red );
+                }
+                column += red;
+            }
+            const float expected = std::max( 0.0f, 1.0f - fabsf(float(x) - 16.0f) / 8.0f );
+            CHECK_CLOSE( expected, column / 8.0f, 0.1f );
+            total += column;
+        }
+        CHECK_CLOSE( still_total, total, 0.02f * still_total );
+    }
+
+    TEST( out_of_focus_square_is_spread_over_circle_of_confusion )
+    {
+        // A square four pixels across at a depth of two seen through a lens
+        // focused at a depth of one moves across by the lens position times
+        // the lens radius times (2 / 1 - 1); eight pixels for every unit of 
+        // lens radius.  Spreading over a uniform disk of radius r adds r^2/2
+        // to the second moment of the square's coverage.
+        vector<float> pinhole;
+        render_square( coverage_options(), 0.5f, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f), &pinhole );
+        float pinhole_total = 0.0f;
+        const float pinhole_spread = coverage_spread( pinhole, &pinhole_total );
+
+        Options options = coverage_options();
+        options.set_focal_length( 1.0f );
+        options.set_focal_distance( 2.0f );
+        options.set_f_stop( 0.5f );
+        vector<float> reds;
+        render_square( options, 0.5f, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f), &reds );
+        CHECK( reds == pinhole );
+
+        options.set_focal_distance( 1.0f );
+        const float f_stops [] = { 1.0f, 0.5f };
+        for ( float f_stop : f_stops )
+        {
+            options.set_f_stop( f_stop );
+            render_square( options, 0.5f, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f), &reds );
+            float total = 0.0f;
+            const float spread = coverage_spread( reds, &total );
+            const float radius = 8.0f * options.lens_radius();
+            CHECK_CLOSE( radius, sqrtf(2.0f * (spread - pinhole_spread)), 0.1f * radius );
+            CHECK_CLOSE( pinhole_total, total, 0.03f * pinhole_total );
+
+            for ( int y = 0; y < 32; ++y )
+            {
+                for ( int x = 0; x < 32; ++x )
+                {
+                    const float dx = float(x) - 16.0f;
+                    const float dy = float(y) - 16.0f;
+                    if ( sqrtf(dx * dx + dy * dy) > radius + 4.0f )
+                    {
+                        CHECK_EQUAL( 0.0f, reds[y * 32 + x] );
+                    }
+                }
+            }
+        }
+    }
+
+    TEST( sampling_in_buckets_matches_sampling_whole_frame_for_every_pattern )
+    {
+        // Jittered samples sit up to half a sample from their integer 
+        // positions so geometry whose bound ends just short of a bucket's
+        // first sample can still cover it and must not be culled.  A filter
+        // wider than a pixel gives each bucket an overlap of samples from
+        // its neighbors for that geometry to fall in.
+        for ( int sample_pattern = 0; sample_pattern < SAMPLE_PATTERN_COUNT; ++sample_pattern )
+        {
+            Options options;
+            options.set_resolution( 160, 120, 1.0f );
+            options.set_sample_pattern( SamplePattern(sample_pattern) );
+            options.set_filter( &Options::gaussian_filter, 2.0f, 2.0f );
+            options.set_dither( 0.0f );
+            vector<unsigned char> expected;
+            render_spheres( options, &expected );
+
+            options.set_bucket_size( 8, 8 );
+            vector<unsigned char> pixels;
+            render_spheres( options, &pixels );
+            CHECK( pixels == expected );
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/Sampler.hpp>
+#include <reyes/SampleBuffer.hpp>
+#include <reyes/SamplePattern.hpp>
+#include <math/vec3.ipp>
+#include <math/vec4.ipp>
+#include <math/mat4x4.ipp>
+#include <vector>
+#include <math.h>
+#include <string.h>
+
+using math::vec3;
+using math::vec4;
+using math::mat4x4;
+using std::vector;
+using namespace reyes;
+
+static const int WIDTH = 33;
+static const int HEIGHT = 33;
+
+// Dice a rippled sheet that folds back over itself so that its 
+// micropolygons cover samples at many depths, cross tile boundaries at
+// every offset, and range from much smaller to much larger than a sample.
+static void dice_sheet( float opacity, vector<vec3>* positions, vector<vec3>* colors, vector<vec3>* opacities )
+{
+    positions->clear();
+    colors->clear();
+    opacities->clear();
+    for ( int y = 0; y < HEIGHT; ++y )
+    {
+        for ( int x = 0; x < WIDTH; ++x )
+        {
+            const float u = float(x) / float(WIDTH - 1);
+            const float v = float(y) / float(HEIGHT - 1);
+            const float z = 3.0f + sinf( 9.0f * u ) * cosf( 7.0f * v );
+            positions->push_back( vec3((2.4f * u - 1.2f + 0.3f * sinf(11.0f * v)) * z, (1.8f * v - 0.9f) * z, z) );
+            colors->push_back( vec3(u, v, u * v) );
+            opacities->push_back( vec3(opacity, opacity, opacity) );
+        }
+    }
+}
+
+// Sample the sheet into a fresh 40x30 sample buffer with the sampler 
+// testing _simd_lanes_ samples at a time and copy out the sample colors 
+// and depths.
+static void sample_sheet( int simd_lanes, SamplePattern sample_pattern, float opacity, vector<float>* samples )
+{
+    SampleBuffer sample_buffer( 40, 30, 2, 2, 1.0f, 1.0f, 0, 0, sample_pattern );
+    sample_buffer.set_bucket( 0, 0, 40, 30 );
+
+    Sampler sampler( float(sample_buffer.width() - 1), float(sample_buffer.height() - 1), vec4(0.0f, 1.0f, 0.0f, 1.0f), WIDTH * HEIGHT );
+    sampler.set_simd_lanes( simd_lanes );
+
+    vector<vec3> positions;
+    vector<vec3> colors;
+    vector<vec3> opacities;
+    dice_sheet( opacity, &positions, &colors, &opacities );
+    const mat4x4 screen_transform = math::renderman_perspective( -1.0f, 1.0f, -0.75f, 0.75f, 1.0f, 100.0f );
+    sampler.sample( screen_transform, WIDTH, HEIGHT, &positions[0], &colors[0], &opacities[0], nullptr, false, true, false, &sample_buffer );
+    sample_buffer.composite();
+
+    samples->clear();
+    for ( int y = sample_buffer.y0(); y < sample_buffer.y1(); ++y )
+    {
+        for ( int x = sample_buffer.x0(); x < sample_buffer.x1(); ++x )
+        {
+            const float* color = sample_buffer.color( x, y );
+            samples->insert( samples->end(), color, color + 4 );
+            samples->push_back( *sample_buffer.depth(x, y) );
+        }
+    }
+}
+
+static void check_simd_sampling_matches_scalar( SamplePattern sample_pattern, float opacity )
+{
+    vector<float> expected;
+    sample_sheet( 1, sample_pattern, opacity, &expected );
+    int covered = 0;
+    for ( size_t i = 0; i < expected.size(); i += 5 )
+    {
+        covered += expected[i + 3] > 0.0f ? 1 : 0;
+    }
+    CHECK( covered > int(expected.size() / 5) / 2 );
+
+    const int lanes [] = { 4, 8 };
+    for ( int simd_lanes : lanes )
+    {
+        vector<float> samples;
+        sample_sheet( simd_lanes, sample_pattern, opacity, &samples );
+        CHECK( samples.size() == expected.size() );
+        CHECK( memcmp(&samples[0], &expected[0], sizeof(float) * expected.size()) == 0 );
+    }
+}
+
+SUITE( SamplingPaths )
+{
+    TEST( simd_lanes_are_limited_to_those_supported )
+    {
+        Sampler sampler( 63.0f, 47.0f, vec4(0.0f, 1.0f, 0.0f, 1.0f), 16 );
+        const int supported = sampler.simd_lanes();
+        CHECK( supported == 1 || supported == 4 || supported == 8 );
+        sampler.set_simd_lanes( 1 );
+        CHECK_EQUAL( 1, sampler.simd_lanes() );
+        sampler.set_simd_lanes( 8 );
+        CHECK_EQUAL( supported, sampler.simd_lanes() );
+    }
+
+    TEST( opaque_simd_sampling_matches_scalar_sampling )
+    {
+        check_simd_sampling_matches_scalar( SAMPLE_PATTERN_REGULAR, 1.0f );
+        check_simd_sampling_matches_scalar( SAMPLE_PATTERN_MULTI_JITTERED, 1.0f );
+    }
+
+    TEST( transparent_simd_sampling_matches_scalar_sampling )
+    {
+        check_simd_sampling_matches_scalar( SAMPLE_PATTERN_REGULAR, 0.4f );
+        check_simd_sampling_matches_scalar( SAMPLE_PATTERN_MULTI_JITTERED, 0.4f );
+    }
+}
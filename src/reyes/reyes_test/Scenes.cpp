@@ -0,0 +1,92 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/ErrorCode.hpp>
+#include <reyes/ErrorPolicy.hpp>
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/Scene.hpp>
+#include <math/vec3.ipp>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using math::vec3;
+using std::vector;
+using namespace reyes;
+
+// Render a frame with the given maximum grid size that renders \e scene, 
+// recording a sphere into it first if \e record is true, or that renders a
+// sphere directly if \e scene is null.
+static void render_frame( Renderer* renderer, Scene* scene, bool record, int maximum_vertices, vector<unsigned char>* pixels )
+{
+    Options options;
+    options.set_resolution( 64, 48, 1.0f );
+    options.set_dither( 0.0f );
+    options.set_maximum_vertices( maximum_vertices );
+
+    renderer->set_options( options );
+    renderer->begin();
+    renderer->perspective( 0.25f * float(M_PI) );
+    renderer->projection();
+    renderer->translate( 0.0f, 0.0f, 16.0f );
+    renderer->begin_world();
+    if ( !scene || record )
+    {
+        if ( scene )
+        {
+            renderer->begin_scene( scene );
+        }
+        renderer->surface_shader( SHADERS_PATH "constant.sl" );
+        renderer->color( vec3(0.25f, 0.5f, 1.0f) );
+        renderer->sphere( 4.0f );
+        if ( scene )
+        {
+            renderer->end_scene();
+        }
+    }
+    if ( scene )
+    {
+        renderer->render_scene( *scene );
+    }
+    renderer->end_world();
+    renderer->end();
+
+    const ImageBuffer& image_buffer = renderer->image_buffer();
+    const unsigned char* data = image_buffer.u8_data();
+    pixels->assign( data, data + image_buffer.width() * image_buffer.height() * image_buffer.pixel_size() );
+}
+
+SUITE( Scenes )
+{
+    TEST( scene_renders_after_frames_with_another_grid_size )
+    {
+        Renderer renderer;
+        Scene scene;
+        vector<unsigned char> expected;
+        render_frame( &renderer, &scene, true, 256, &expected );
+        CHECK( scene.primitives() > 0 );
+        CHECK_EQUAL( 256, scene.maximum_vertices() );
+
+        vector<unsigned char> pixels;
+        render_frame( &renderer, nullptr, false, 1024, &pixels );
+        render_frame( &renderer, &scene, false, 256, &pixels );
+        CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+        CHECK( pixels == expected );
+    }
+
+    TEST( scene_rendered_with_another_grid_size_is_an_error )
+    {
+        Renderer renderer;
+        Scene scene;
+        vector<unsigned char> pixels;
+        render_frame( &renderer, &scene, true, 256, &pixels );
+        CHECK_EQUAL( 0, renderer.error_policy().total_errors() );
+
+        render_frame( &renderer, &scene, false, 1024, &pixels );
+        CHECK_EQUAL( 1, renderer.error_policy().total_errors() );
+        for ( size_t i = 0; i < pixels.size(); i += 4 )
+        {
+            CHECK( pixels[i + 0] == 0 && pixels[i + 1] == 0 && pixels[i + 2] == 0 );
+        }
+    }
+}
@@ -0,0 +1,86 @@
+//
+// SphereScene.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "SphereScene.hpp"
+#include <reyes/ImageBuffer.hpp>
+#include <reyes/Options.hpp>
+#include <reyes/Renderer.hpp>
+#include <reyes/assert.hpp>
+#include <math/vec3.ipp>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using math::vec3;
+using std::vector;
+
+namespace reyes
+{
+
+/**
+// Render a large sphere behind a ring of smaller spheres at different 
+// depths that overlap it and each other.
+//
+// The spheres cover most of the image so that they cross many buckets and
+// bands, hide each other, and are each split into many grids.
+//
+// @param options
+//  The options to render with.
+//
+// @param renderer
+//  The renderer to render with (assumed not null).
+*/
+void render_spheres( const Options& options, Renderer* renderer )
+{
+    REYES_ASSERT( renderer );
+
+    renderer->set_options( options );
+    renderer->begin();
+    renderer->perspective( 0.25f * float(M_PI) );
+    renderer->projection();
+    renderer->translate( 0.0f, 0.0f, 24.0f );
+    renderer->begin_world();
+    renderer->surface_shader( SHADERS_PATH "constant.sl" );
+
+    renderer->identity();
+    renderer->color( vec3(0.2f, 0.4f, 0.8f) );
+    renderer->sphere( 6.0f );
+
+    const int SPHERES = 8;
+    for ( int i = 0; i < SPHERES; ++i )
+    {
+        const float angle = 2.0f * float(M_PI) * float(i) / float(SPHERES);
+        renderer->identity();
+        renderer->translate( 5.0f * cosf(angle), 5.0f * sinf(angle), float(i % 3) * 4.0f - 6.0f );
+        renderer->color( vec3(float(i % 2), float(i % 3) / 2.0f, float(i % 4) / 3.0f) );
+        renderer->sphere( 2.0f + float(i % 3) );
+    }
+
+    renderer->end_world();
+    renderer->end();
+}
+
+/**
+// Render the spheres drawn by render_spheres() and copy out the quantized
+// pixels.
+//
+// @param options
+//  The options to render with.
+//
+// @param pixels
+//  The vector to copy the pixels of the final image into (assumed not null).
+*/
+void render_spheres( const Options& options, vector<unsigned char>* pixels )
+{
+    REYES_ASSERT( pixels );
+
+    Renderer renderer;
+    render_spheres( options, &renderer );
+
+    const ImageBuffer& image_buffer = renderer.image_buffer();
+    const unsigned char* data = image_buffer.u8_data();
+    pixels->assign( data, data + image_buffer.width() * image_buffer.height() * image_buffer.pixel_size() );
+}
+
+}
@@ -0,0 +1,17 @@
+#ifndef REYES_SPHERESCENE_HPP_INCLUDED
+#define REYES_SPHERESCENE_HPP_INCLUDED
+
+#include <vector>
+
+namespace reyes
+{
+
+class Options;
+class Renderer;
+
+void render_spheres( const Options& options, Renderer* renderer );
+void render_spheres( const Options& options, std::vector<unsigned char>* pixels );
+
+}
+
+#endif
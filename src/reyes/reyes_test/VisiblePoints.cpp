@@ -0,0 +1,101 @@
+#include <UnitTest++/UnitTest++.h>
+#include <reyes/VisiblePoints.hpp>
+#include <math/vec3.ipp>
+#include <math/vec4.ipp>
+#include <float.h>
+
+using math::vec3;
+using math::vec4;
+using namespace reyes;
+
+static void check_color( const vec4& expected, const vec4& color )
+{
+    const float TOLERANCE = 0.0001f;
+    CHECK_CLOSE( expected.x, color.x, TOLERANCE );
+    CHECK_CLOSE( expected.y, color.y, TOLERANCE );
+    CHECK_CLOSE( expected.z, color.z, TOLERANCE );
+    CHECK_CLOSE( expected.w, color.w, TOLERANCE );
+}
+
+SUITE( VisiblePoints )
+{
+    TEST( points_are_composited_front_to_back_in_depth_order )
+    {
+        VisiblePoints visible_points( 8, 1.0f );
+        visible_points.reset( 1, 1 );
+        visible_points.insert( 0, 0, 3.0f, vec3(0.0f, 0.0f, 0.5f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        visible_points.insert( 0, 0, 1.0f, vec3(0.5f, 0.0f, 0.0f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        visible_points.insert( 0, 0, 2.0f, vec3(0.0f, 0.5f, 0.0f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        check_color( vec4(0.5f, 0.25f, 0.125f, 0.875f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+    }
+
+    TEST( points_behind_the_opaque_depth_are_hidden )
+    {
+        VisiblePoints visible_points( 8, 1.0f );
+        visible_points.reset( 1, 1 );
+        CHECK_EQUAL( FLT_MAX, visible_points.insert(0, 0, 2.5f, vec3(0.5f, 0.5f, 0.5f), vec3(0.5f, 0.5f, 0.5f), 2.0f) );
+        CHECK( visible_points.empty() );
+
+        visible_points.insert( 0, 0, 1.0f, vec3(0.5f, 0.0f, 0.0f), vec3(0.5f, 0.5f, 0.5f), 2.0f );
+        visible_points.insert( 0, 0, 2.0f, vec3(0.0f, 0.5f, 0.0f), vec3(0.5f, 0.5f, 0.5f), 2.0f );
+        visible_points.insert( 0, 0, 3.0f, vec3(0.0f, 0.0f, 0.5f), vec3(0.5f, 0.5f, 0.5f), 2.0f );
+        CHECK_EQUAL( 2, visible_points.pool_size() );
+        check_color( vec4(0.75f, 0.5f, 0.25f, 1.0f), visible_points.composite(0, 0, 2.0f, vec4(1.0f, 1.0f, 1.0f, 1.0f)) );
+    }
+
+    TEST( alpha_is_averaged_over_opacity_channels )
+    {
+        VisiblePoints visible_points( 8, 1.0f );
+        visible_points.reset( 1, 1 );
+        visible_points.insert( 0, 0, 1.0f, vec3(0.6f, 0.3f, 0.0f), vec3(0.6f, 0.3f, 0.0f), FLT_MAX );
+        check_color( vec4(0.6f, 0.3f, 0.0f, 0.3f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+    }
+
+    TEST( list_is_truncated_where_opacity_passes_threshold )
+    {
+        VisiblePoints visible_points( 8, 0.9f );
+        visible_points.reset( 1, 1 );
+        CHECK_EQUAL( FLT_MAX, visible_points.insert(0, 0, 1.0f, vec3(0.7f, 0.0f, 0.0f), vec3(0.7f, 0.7f, 0.7f), FLT_MAX) );
+        CHECK_EQUAL( 3.0f, visible_points.insert(0, 0, 3.0f, vec3(0.0f, 0.0f, 0.7f), vec3(0.7f, 0.7f, 0.7f), FLT_MAX) );
+        CHECK_EQUAL( 2.0f, visible_points.insert(0, 0, 2.0f, vec3(0.0f, 0.7f, 0.0f), vec3(0.7f, 0.7f, 0.7f), 3.0f) );
+        check_color( vec4(0.7f, 0.21f, 0.0f, 0.91f), visible_points.composite(0, 0, 2.0f, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+        check_color( vec4(0.7f, 0.21f, 0.0f, 0.91f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+    }
+
+    TEST( points_per_sample_are_capped_at_maximum_points )
+    {
+        VisiblePoints visible_points( 2, 1.0f );
+        visible_points.reset( 1, 1 );
+        visible_points.insert( 0, 0, 1.0f, vec3(0.5f, 0.0f, 0.0f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        visible_points.insert( 0, 0, 2.0f, vec3(0.0f, 0.5f, 0.0f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        visible_points.insert( 0, 0, 3.0f, vec3(0.0f, 0.0f, 0.5f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        CHECK_EQUAL( 2, visible_points.pool_size() );
+        check_color( vec4(0.5f, 0.25f, 0.0f, 0.75f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+
+        visible_points.insert( 0, 0, 0.5f, vec3(0.0f, 0.0f, 0.5f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        check_color( vec4(0.25f, 0.0f, 0.5f, 0.75f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+    }
+
+    TEST( freed_points_are_reused_and_reset_empties_every_list )
+    {
+        VisiblePoints visible_points( 8, 0.9f );
+        visible_points.reset( 2, 1 );
+        visible_points.insert( 0, 0, 1.0f, vec3(0.7f, 0.0f, 0.0f), vec3(0.7f, 0.7f, 0.7f), FLT_MAX );
+        visible_points.insert( 0, 0, 2.0f, vec3(0.0f, 0.7f, 0.0f), vec3(0.7f, 0.7f, 0.7f), FLT_MAX );
+        CHECK_EQUAL( 1.5f, visible_points.insert(0, 0, 1.5f, vec3(0.0f, 0.0f, 0.7f), vec3(0.7f, 0.7f, 0.7f), 2.0f) );
+        CHECK_EQUAL( 3, visible_points.pool_size() );
+
+        visible_points.insert( 1, 0, 1.0f, vec3(0.0f, 0.5f, 0.0f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        CHECK_EQUAL( 3, visible_points.pool_size() );
+        check_color( vec4(0.7f, 0.0f, 0.21f, 0.91f), visible_points.composite(0, 0, 1.5f, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+        check_color( vec4(0.0f, 0.5f, 0.0f, 0.5f), visible_points.composite(1, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+
+        visible_points.reset( 2, 1 );
+        CHECK( visible_points.empty() );
+        CHECK_EQUAL( 0, visible_points.pool_size() );
+        visible_points.insert( 0, 0, 5.0f, vec3(0.0f, 0.0f, 0.5f), vec3(0.5f, 0.5f, 0.5f), FLT_MAX );
+        CHECK_EQUAL( 1, visible_points.pool_size() );
+        check_color( vec4(0.0f, 0.0f, 0.5f, 0.5f), visible_points.composite(0, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+        check_color( vec4(0.0f, 0.0f, 0.0f, 0.0f), visible_points.composite(1, 0, FLT_MAX, vec4(0.0f, 0.0f, 0.0f, 0.0f)) );
+    }
+}
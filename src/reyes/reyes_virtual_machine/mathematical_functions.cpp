@@ -324,12 +324,12 @@ void du_float( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
         {
             int i0 = i + x - 1;
             int i2 = i + x + 1;
-            result[i0] = (v[i2] - v[i0]) / (2.0f * du);
+            result[i + x] = (v[i2] - v[i0]) / (2.0f * du);
         }
 
         i0 = i + width - 2;
         i1 = i + width - 1;
-        result[i0] = (v[i1] - v[i0]) / du;
+        result[i1] = (v[i1] - v[i0]) / du;
 
         i += width;
     }
@@ -355,12 +355,12 @@ void du_vec3( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
         {
             int i0 = i + x - 1;
             int i2 = i + x + 1;
-            result[i0] = (v[i2] - v[i0]) / (2.0f * du);
+            result[i + x] = (v[i2] - v[i0]) / (2.0f * du);
         }
 
         i0 = i + width - 2;
         i1 = i + width - 1;
-        result[i0] = (v[i1] - v[i0]) / du;
+        result[i1] = (v[i1] - v[i0]) / du;
 
         i += width;
     }
@@ -389,7 +389,7 @@ void dv_float( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
         {
             int i0 = i + x;
             int i2 = i + width * 2 + x;
-            result[i0] = (v[i2] - v[i0]) / (2.0f * dv);
+            result[i + width + x] = (v[i2] - v[i0]) / (2.0f * dv);
         }                               
         i += width;
     }
@@ -398,7 +398,7 @@ void dv_float( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
     {
         int i0 = i + x;
         int i1 = i + width + x;
-        result[i0] = (v[i1] - v[i0]) / dv;
+        result[i1] = (v[i1] - v[i0]) / dv;
     }                            
 }
 
@@ -425,7 +425,7 @@ void dv_vec3( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
         {
             int i0 = i + x;
             int i2 = i + width * 2 + x;
-            result[i0] = (v[i2] - v[i0]) / (2.0f * dv);
+            result[i + width + x] = (v[i2] - v[i0]) / (2.0f * dv);
         }                               
         i += width;
     }
@@ -434,7 +434,7 @@ void dv_vec3( const Renderer& /*renderer*/, const Grid& grid, int /*dispatch*/,
     {
         int i0 = i + x;
         int i1 = i + width + x;
-        result[i0] = (v[i1] - v[i0]) / dv;
+        result[i1] = (v[i1] - v[i0]) / dv;
     }                            
 }
 